@@ -0,0 +1,47 @@
+# Gera src/dashboard_gz.h a partir de src/dashboard.html (gzip -9 -n, vetor no formato do xxd -i).
+# Uso: cmake -DENTRADA=src/dashboard.html -DSAIDA=src/dashboard_gz.h -P host/gerar_dashboard.cmake
+# O build do host chama este script sempre que dashboard.html muda; o cabeçalho continua no
+# repositório porque a IDE do Arduino compila o firmware sem passar pelo CMake.
+find_program(GZIP gzip REQUIRED)
+set(comprimido "${SAIDA}.gz")
+execute_process(COMMAND ${GZIP} -9 -n -c "${ENTRADA}" OUTPUT_FILE "${comprimido}" RESULT_VARIABLE resultado)
+if(NOT resultado EQUAL 0)
+  message(FATAL_ERROR "gzip falhou em ${ENTRADA}")
+endif()
+file(READ "${comprimido}" hex HEX)
+file(REMOVE "${comprimido}")
+
+string(REGEX MATCHALL ".." bytes "${hex}")
+set(linhas "")
+set(linha "")
+set(naLinha 0)
+foreach(b IN LISTS bytes)
+  if(naLinha EQUAL 12)
+    string(APPEND linhas "${linha}\n")
+    set(linha "")
+    set(naLinha 0)
+  endif()
+  if(naLinha EQUAL 0)
+    string(APPEND linha "  0x${b},")
+  else()
+    string(APPEND linha " 0x${b},")
+  endif()
+  math(EXPR naLinha "${naLinha} + 1")
+endforeach()
+string(REGEX REPLACE ",$" "" linha "${linha}")
+string(APPEND linhas "${linha}")
+
+file(WRITE "${SAIDA}" "/**
+ * @file dashboard_gz.h
+ * @brief Painel da sala (dashboard.html) comprimido com gzip, servido direto da flash.
+ * @details Arquivo gerado por host/gerar_dashboard.cmake; não edite à mão. O build do host
+ * (CMakeLists.txt) o regenera sempre que dashboard.html muda: rode o build e faça o commit
+ * dos dois arquivos juntos. teste_dashboard confere que ele descomprime no HTML atual.
+ */
+#pragma once
+
+const uint8_t dashboardHtmlGz[] PROGMEM = {
+${linhas}
+};
+const size_t dashboardHtmlGzTamanho = sizeof(dashboardHtmlGz);
+")
@@ -0,0 +1,1227 @@
+/**
+ * @file simulador.cpp
+ * @brief Implementação dos stubs de host/stubs e dos modelos de periféricos (ver simulador.h).
+ * @details Custos cobrados no relógio virtual, medidos no ESP32 da placa ou tirados das folhas
+ * de dados: um byte no LCD por I2C a 100 kHz ~1,3 ms, um byte na UART a 115200 baud ~87 us,
+ * um registrador do MFRC522 por SPI ~5 us, uma troca de quadros com o cartão ~1 ms e o timeout
+ * do MFRC522 programado pela biblioteca, 25 ms.
+ */
+#include "simulador.h"
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <WiFi.h>
+#include <MFRC522.h>
+#include <LiquidCrystal_I2C.h>
+#include <ESP32Servo.h>
+#include <esp_timer.h>
+#include <esp_partition.h>
+#include <esp_rom_crc.h>
+#include <esp_heap_caps.h>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <stdarg.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+HardwareSerial Serial;
+SPIClass SPI;
+WiFiClass WiFi;
+EspClass ESP;
+
+namespace {
+
+// ==============================================================================
+// CUSTOS DOS PERIFÉRICOS
+// ==============================================================================
+
+const uint32_t CUSTO_BYTE_LCD_US = 1300;    // 4 escritas I2C de 3 bytes por byte do HD44780 (100 kHz)
+const uint32_t ESPERA_LIMPAR_LCD_US = 2000; // clear/home: execução lenta no HD44780
+const uint32_t CUSTO_INICIAR_LCD_US = 100000;
+const uint64_t NS_POR_BYTE_SERIAL = 86806;  // 10 bits a 115200 baud
+const uint32_t FIFO_SERIAL = 128;           // FIFO de transmissão da UART0
+const uint32_t CUSTO_REGISTRO_SPI_US = 5;   // Um registrador do MFRC522 (SS, endereço e dado a 4 MHz)
+const uint32_t CUSTO_QUADRO_RFID_US = 1000; // PCD_TransceiveData com resposta (anticolisão/SELECT)
+const uint32_t TIMEOUT_RFID_US = 25000;     // Timer do MFRC522 programado pela biblioteca
+const uint32_t ATRASO_ATQA_US = 150;        // REQA + ATQA no ar
+const uint32_t CUSTO_INICIAR_PCD_US = 50000;// Reset do MFRC522 e partida do oscilador
+const uint32_t CUSTO_APAGAR_SETOR_US = 30000;
+const uint32_t CUSTO_GRAVAR_US = 20;        // Por chamada, mais 2,5 us por byte
+const uint32_t CUSTO_LER_US = 2;            // Por chamada, mais 1 us a cada 40 bytes
+const uint32_t CUSTO_PWM_US = 20;           // Reconfigurar o LEDC (servo e buzzer)
+const uint32_t ATRASO_ECO_US = 450;         // Disparo do TRIG -> subida do ECHO (rajada de 40 kHz)
+const uint32_t US_POR_CM_ECO = 58;
+
+// Ligações da placa (ver simulador.h)
+const uint8_t PINO_TRIG_PLACA = 16;
+const uint8_t PINO_ECHO_PLACA = 17;
+const uint8_t PINO_DHT_PLACA = 15;
+const int TOTAL_PINOS = 40;
+
+// ==============================================================================
+// RELÓGIO
+// ==============================================================================
+
+std::atomic<bool> modoReal{false};
+uint64_t relogioVirtualUs = 0;              // Só a thread do teste o usa, no modo virtual
+uint64_t baseRealUs = 0;                    // Instante do boot quando o relógio real começou
+std::chrono::steady_clock::time_point origemReal;
+std::atomic<bool> threadTimersAtiva{false};
+std::thread threadTimers;
+
+thread_local int profundidade = 0;          // > 0: dentro do processamento de eventos (virtual)
+thread_local int64_t instanteIsr = -1;      // Dentro de uma ISR: instante da borda que a disparou
+thread_local int pinoIsr = -1;
+thread_local int nivelIsr = 0;
+
+uint64_t agoraRealUs() {
+  return baseRealUs +
+         std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - origemReal).count();
+}
+
+// ==============================================================================
+// EVENTOS AGENDADOS (BORDAS DOS SENSORES E RESPOSTAS DO CARTÃO)
+// ==============================================================================
+
+enum TipoEventoSim : uint8_t { EVENTO_BORDA, EVENTO_RESPOSTA_RFID };
+
+struct EventoSim {
+  uint64_t instante;
+  uint64_t ordem;                           // Desempate: ordem de agendamento
+  uint8_t tipo;
+  uint8_t pino;                             // Pino da borda ou SS do leitor
+  uint8_t nivel;
+  uint32_t geracao;                         // Resposta do cartão: transação que a originou
+  bool operator>(const EventoSim &o) const {
+    return instante != o.instante ? instante > o.instante : ordem > o.ordem;
+  }
+};
+
+// Cada thread agenda e consome os próprios eventos (o timer gera as bordas do ultrassom e do
+// DHT11; o controle, as respostas dos cartões), então a fila não precisa de trava.
+thread_local std::priority_queue<EventoSim, std::vector<EventoSim>, std::greater<EventoSim>> eventosLocais;
+thread_local uint64_t ordemEventos = 0;
+
+// ==============================================================================
+// PINOS E INTERRUPÇÕES
+// ==============================================================================
+
+const uint32_t TAMANHO_ANEL_ISR = 64;
+
+struct Pino {
+  uint8_t modo = INPUT;
+  std::atomic<int> saida{0};                // Nível escrito pelo ESP32
+  std::atomic<int> externo{1};              // Nível forçado pelo periférico (1 = solto/pull-up)
+  std::atomic<int> linha{1};
+  std::atomic<uint32_t> trocas{0};
+  void (*isr)() = nullptr;
+  void (*isrArg)(void *) = nullptr;
+  void *arg = nullptr;
+  int modoIsr = 0;
+  std::thread::id dono;                     // Thread que anexou a ISR ("núcleo" que a atende)
+  // Bordas geradas por outra thread esperando o dono: instante, nível e uma etiqueta da
+  // volta no anel, tudo numa palavra atômica relaxada (nenhuma sincronização extra).
+  std::atomic<uint64_t> anel[TAMANHO_ANEL_ISR];
+  uint32_t escritos = 0;                    // Só o produtor
+  uint32_t lidos = 0;                       // Só o dono
+};
+
+Pino pinos[TOTAL_PINOS];
+std::atomic<int> bordasPendentes{0};
+std::atomic<uint32_t> bordasPerdidas{0};
+
+uint64_t etiquetaAnel(uint32_t indice) { return (uint64_t)(((indice / TAMANHO_ANEL_ISR) + 1) & 0xFF) << 56; }
+
+int calcularLinha(const Pino &p) {
+  switch (p.modo) {
+  case OUTPUT: return p.saida.load(std::memory_order_relaxed);
+  case OUTPUT_OPEN_DRAIN: return p.saida.load(std::memory_order_relaxed) & p.externo.load(std::memory_order_relaxed);
+  default: return p.externo.load(std::memory_order_relaxed);
+  }
+}
+
+void chamarIsr(Pino &p, int pino, int nivel, uint64_t instante) {
+  int64_t instanteAnterior = instanteIsr;
+  int pinoAnterior = pinoIsr, nivelAnterior = nivelIsr;
+  instanteIsr = (int64_t)instante;
+  pinoIsr = pino;
+  nivelIsr = nivel;
+  if (p.isrArg != nullptr) p.isrArg(p.arg);
+  else if (p.isr != nullptr) p.isr();
+  instanteIsr = instanteAnterior;
+  pinoIsr = pinoAnterior;
+  nivelIsr = nivelAnterior;
+}
+
+bool bordaDispara(int modoIsr, int nivel) {
+  return modoIsr == CHANGE || (modoIsr == RISING && nivel) || (modoIsr == FALLING && !nivel);
+}
+
+void entregarIsr(Pino &p, int pino, int nivel, uint64_t instante) {
+  if (!modoReal.load(std::memory_order_relaxed) || p.dono == std::this_thread::get_id()) {
+    chamarIsr(p, pino, nivel, instante);
+    return;
+  }
+  uint32_t indice = p.escritos;
+  std::atomic<uint64_t> &slot = p.anel[indice % TAMANHO_ANEL_ISR];
+  uint64_t anterior = slot.load(std::memory_order_relaxed);
+  if (indice >= TAMANHO_ANEL_ISR && (anterior >> 56) == (etiquetaAnel(indice - TAMANHO_ANEL_ISR) >> 56)) {
+    bordasPerdidas.fetch_add(1, std::memory_order_relaxed); // Dono não atendeu a volta anterior
+  }
+  slot.store(etiquetaAnel(indice) | ((uint64_t)(nivel & 1) << 55) | (instante & ((1ULL << 55) - 1)),
+             std::memory_order_relaxed);
+  p.escritos = indice + 1;
+  bordasPendentes.fetch_add(1, std::memory_order_relaxed);
+}
+
+void aoEscreverPino(uint8_t pino, int nivel, uint64_t instante);
+
+void atualizarLinha(uint8_t pino, uint64_t instante) {
+  Pino &p = pinos[pino];
+  int nova = calcularLinha(p);
+  int antiga = p.linha.exchange(nova, std::memory_order_relaxed);
+  if (nova == antiga) return;
+  p.trocas.fetch_add(1, std::memory_order_relaxed);
+  if ((p.isr != nullptr || p.isrArg != nullptr) && bordaDispara(p.modoIsr, nova)) entregarIsr(p, pino, nova, instante);
+}
+
+void aplicarEvento(const EventoSim &e);
+
+// Relógio real: atende, na thread chamadora, as bordas vencidas que ela mesma agendou e as
+// ISRs que outras threads deixaram para ela (é o "núcleo" dono da interrupção).
+void atenderInterrupcoes() {
+  if (!modoReal.load(std::memory_order_relaxed) || instanteIsr >= 0) return;
+  if (!eventosLocais.empty()) {
+    uint64_t agora = agoraRealUs();
+    while (!eventosLocais.empty() && eventosLocais.top().instante <= agora) {
+      EventoSim e = eventosLocais.top();
+      eventosLocais.pop();
+      aplicarEvento(e);
+    }
+  }
+  if (bordasPendentes.load(std::memory_order_relaxed) == 0) return;
+  std::thread::id eu = std::this_thread::get_id();
+  for (int pino = 0; pino < TOTAL_PINOS; pino++) {
+    Pino &p = pinos[pino];
+    if (p.dono != eu) continue;
+    for (;;) {
+      uint64_t valor = p.anel[p.lidos % TAMANHO_ANEL_ISR].load(std::memory_order_relaxed);
+      if ((valor >> 56) != (etiquetaAnel(p.lidos) >> 56)) break;
+      p.lidos++;
+      bordasPendentes.fetch_sub(1, std::memory_order_relaxed);
+      chamarIsr(p, pino, (int)((valor >> 55) & 1), valor & ((1ULL << 55) - 1));
+    }
+  }
+}
+
+// ==============================================================================
+// TIMERS (esp_timer)
+// ==============================================================================
+
+std::mutex travaTimers;                     // Como o spinlock do esp_timer
+
+} // namespace
+
+struct esp_timer {
+  esp_timer_cb_t callback;
+  void *arg;
+  const char *nome;
+  bool ativo;
+  bool periodico;
+  uint64_t periodoUs;
+  uint64_t proximoUs;
+};
+
+namespace {
+
+std::vector<esp_timer *> &timers() {
+  static std::vector<esp_timer *> lista;
+  return lista;
+}
+
+/**
+ * Dispara, em ordem de tempo, os timers e os eventos locais vencidos até 'alvo'. No relógio
+ * virtual o relógio acompanha cada disparo; callbacks que esperam (delayMicroseconds) só
+ * empurram o relógio, como no hardware.
+ */
+void processarAte(uint64_t alvo, bool virtualizado) {
+  for (;;) {
+    esp_timer *proximo = nullptr;
+    uint64_t instanteTimer = UINT64_MAX;
+    {
+      std::lock_guard<std::mutex> trava(travaTimers);
+      for (esp_timer *t : timers()) {
+        if (t->ativo && t->proximoUs < instanteTimer) {
+          instanteTimer = t->proximoUs;
+          proximo = t;
+        }
+      }
+    }
+    uint64_t instanteEvento = eventosLocais.empty() ? UINT64_MAX : eventosLocais.top().instante;
+    uint64_t instante = instanteEvento <= instanteTimer ? instanteEvento : instanteTimer;
+    if (instante > alvo) break;
+    if (virtualizado && instante > relogioVirtualUs) relogioVirtualUs = instante;
+    if (instanteEvento <= instanteTimer) {
+      EventoSim e = eventosLocais.top();
+      eventosLocais.pop();
+      aplicarEvento(e);
+      continue;
+    }
+    esp_timer_cb_t callback;
+    void *arg;
+    {
+      std::lock_guard<std::mutex> trava(travaTimers);
+      if (proximo->periodico) proximo->proximoUs += proximo->periodoUs;
+      else proximo->ativo = false;
+      callback = proximo->callback;
+      arg = proximo->arg;
+    }
+    callback(arg);
+  }
+  if (virtualizado && relogioVirtualUs < alvo) relogioVirtualUs = alvo;
+}
+
+void executarThreadTimers() {
+  while (threadTimersAtiva.load(std::memory_order_relaxed)) {
+    processarAte(agoraRealUs(), false);
+    std::this_thread::sleep_for(std::chrono::microseconds(20));
+  }
+}
+
+// ==============================================================================
+// ULTRASSÔNICO (HC-SR04) E DHT11
+// ==============================================================================
+
+std::atomic<unsigned> distanciaCm{0};
+uint64_t subidaTrigUs = 0;                  // Thread do timer
+
+std::atomic<uint64_t> quadroDht{0};         // 5 bytes do próximo quadro do DHT11
+std::atomic<bool> dhtSemResposta{false};
+bool pulsoDhtAtivo = false;
+uint64_t inicioPulsoDhtUs = 0;
+
+void agendarRespostaDht(uint64_t instante) {
+  uint64_t quadro = quadroDht.load(std::memory_order_relaxed);
+  uint64_t t = instante + 30;               // Sensor responde 20-40 us depois de a linha ser solta
+  sim::agendarBorda(PINO_DHT_PLACA, 0, t);
+  sim::agendarBorda(PINO_DHT_PLACA, 1, t + 80);
+  t += 160;
+  for (int i = 0; i < 40; i++) {
+    bool um = (quadro >> (39 - i)) & 1;
+    sim::agendarBorda(PINO_DHT_PLACA, 0, t);
+    sim::agendarBorda(PINO_DHT_PLACA, 1, t + 50);
+    t += 50 + (um ? 70 : 26);
+  }
+  sim::agendarBorda(PINO_DHT_PLACA, 0, t); // Fim do quadro: 50 us em nível baixo
+  sim::agendarBorda(PINO_DHT_PLACA, 1, t + 50);
+}
+
+void aoEscreverPino(uint8_t pino, int nivel, uint64_t instante) {
+  if (pino == PINO_TRIG_PLACA) {
+    if (nivel) {
+      subidaTrigUs = instante;
+    } else if (subidaTrigUs != 0 && instante - subidaTrigUs >= 10) {
+      subidaTrigUs = 0;
+      unsigned cm = distanciaCm.load(std::memory_order_relaxed);
+      if (cm > 0) {
+        sim::agendarBorda(PINO_ECHO_PLACA, 1, instante + ATRASO_ECO_US);
+        sim::agendarBorda(PINO_ECHO_PLACA, 0, instante + ATRASO_ECO_US + (uint64_t)cm * US_POR_CM_ECO);
+      }
+    }
+  } else if (pino == PINO_DHT_PLACA && pinos[pino].modo == OUTPUT_OPEN_DRAIN) {
+    if (!nivel) {
+      pulsoDhtAtivo = true;
+      inicioPulsoDhtUs = instante;
+    } else if (pulsoDhtAtivo) {
+      pulsoDhtAtivo = false;
+      if (instante - inicioPulsoDhtUs >= 18000 && !dhtSemResposta.load(std::memory_order_relaxed)) {
+        agendarRespostaDht(instante);
+      }
+    }
+  }
+}
+
+struct IniciarPlaca {                       // HC-SR04 mantém o ECHO em nível baixo em repouso
+  IniciarPlaca() {
+    pinos[PINO_ECHO_PLACA].externo.store(0);
+    pinos[PINO_ECHO_PLACA].linha.store(0);
+  }
+} iniciarPlaca;
+
+// ==============================================================================
+// MFRC522
+// ==============================================================================
+
+const uint8_t IRQ_TIMER = 0x01, IRQ_OCIOSO = 0x10, IRQ_RX = 0x20, IRQ_TX = 0x40;
+enum EstadoCartao : uint8_t { CARTAO_OCIOSO, CARTAO_PRONTO, CARTAO_ATIVO, CARTAO_PARADO };
+
+struct Mfrc {
+  sim::LeitorSimulado estado;
+  uint8_t fifo[64];
+  uint8_t tamanhoFifo;
+  uint8_t comando;
+  uint32_t geracao;                         // Muda a cada comando: respostas antigas são descartadas
+};
+
+Mfrc &mfrc(uint8_t pinoSS) {
+  static Mfrc tabela[TOTAL_PINOS];
+  static bool iniciada = false;
+  if (!iniciada) {
+    iniciada = true;
+    for (Mfrc &m : tabela) {
+      m = Mfrc{};
+      m.estado.pinoIrq = 255;
+      m.estado.comIEn = 0x80;
+    }
+    tabela[5].estado.pinoIrq = 34;
+    tabela[27].estado.pinoIrq = 35;
+  }
+  return tabela[pinoSS % TOTAL_PINOS];
+}
+
+void atualizarIrq(Mfrc &m, uint64_t instante) {
+  sim::LeitorSimulado &s = m.estado;
+  if (s.pinoIrq == 255) return;
+  bool pendente = (s.comIrq & s.comIEn & 0x7F) != 0;
+  int nivel = (s.comIEn & 0x80) ? !pendente : pendente;
+  Pino &p = pinos[s.pinoIrq];
+  if (p.externo.exchange(nivel, std::memory_order_relaxed) == nivel) return;
+  if (!nivel) s.bordasIrq++;
+  atualizarLinha(s.pinoIrq, instante);
+}
+
+void alterarIrq(Mfrc &m, uint8_t limpar, uint8_t marcar) {
+  m.estado.comIrq = (uint8_t)((m.estado.comIrq & ~limpar) | marcar);
+  atualizarIrq(m, sim::agoraUs());
+}
+
+bool respondeAoPedido(const sim::LeitorSimulado &s, bool wupa) {
+  if (!s.cartaoPresente) return false;
+  if (s.estadoCartao == CARTAO_OCIOSO) return true;
+  return s.estadoCartao == CARTAO_PARADO && (wupa || s.ignoraHalt);
+}
+
+// Quadro enviado por Transceive + StartSend: REQA/WUPA são respondidos depois de ATRASO_ATQA_US;
+// HLTA nunca tem resposta (o cartão só para).
+void transmitir(Mfrc &m, uint8_t pinoSS) {
+  sim::LeitorSimulado &s = m.estado;
+  uint8_t tamanho = m.tamanhoFifo;
+  uint8_t primeiro = tamanho > 0 ? m.fifo[0] : 0;
+  m.tamanhoFifo = 0;
+  alterarIrq(m, 0, IRQ_TX);
+  if (tamanho == 1 && (primeiro == MFRC522::PICC_CMD_REQA || primeiro == MFRC522::PICC_CMD_WUPA)) {
+    s.reqas++;
+    if (respondeAoPedido(s, primeiro == MFRC522::PICC_CMD_WUPA)) {
+      s.estadoCartao = CARTAO_PRONTO;
+      EventoSim e{sim::agoraUs() + ATRASO_ATQA_US, ordemEventos++, EVENTO_RESPOSTA_RFID, pinoSS, 0, m.geracao};
+      eventosLocais.push(e);
+    } else if (s.estadoCartao == CARTAO_PRONTO || s.estadoCartao == CARTAO_ATIVO) {
+      s.estadoCartao = CARTAO_OCIOSO;       // Comando inválido nesses estados (ISO 14443-3)
+    }
+  } else if (primeiro == MFRC522::PICC_CMD_HLTA) {
+    s.halts++;
+    if (s.cartaoPresente && s.estadoCartao != CARTAO_OCIOSO) s.estadoCartao = CARTAO_PARADO;
+  }
+}
+
+void aplicarRespostaRfid(uint8_t pinoSS, uint32_t geracao) {
+  Mfrc &m = mfrc(pinoSS);
+  if (geracao != m.geracao || !m.estado.cartaoPresente) return;
+  m.fifo[0] = 0x04;                         // ATQA
+  m.fifo[1] = 0x00;
+  m.tamanhoFifo = 2;
+  m.estado.respostasReqa++;
+  alterarIrq(m, 0, IRQ_RX | IRQ_OCIOSO);
+}
+
+void cobrarTransacao(Mfrc &m, uint32_t us) {
+  m.estado.ocupadoUs += us;
+  if (us > m.estado.maiorTransacaoUs) m.estado.maiorTransacaoUs = us;
+  sim::cobrar(us);
+}
+
+void aplicarEvento(const EventoSim &e) {
+  if (e.tipo == EVENTO_RESPOSTA_RFID) {
+    aplicarRespostaRfid(e.pino, e.geracao);
+    return;
+  }
+  Pino &p = pinos[e.pino];
+  p.externo.store(e.nivel, std::memory_order_relaxed);
+  atualizarLinha(e.pino, e.instante);
+}
+
+// ==============================================================================
+// LCD, SERIAL, SERVO E BUZZER
+// ==============================================================================
+
+char telaLcd[4][41];
+uint8_t colunaLcd = 0, linhaCursorLcd = 0, colunasLcd = 16, linhasLcd = 2;
+uint32_t totalBytesLcd = 0;
+
+void limparTelaLcd() {
+  for (auto &linha : telaLcd) {
+    memset(linha, ' ', sizeof(linha) - 1);
+    linha[sizeof(linha) - 1] = '\0';
+  }
+}
+
+void byteLcd(uint32_t esperaExtraUs = 0) {
+  totalBytesLcd++;
+  sim::cobrar(CUSTO_BYTE_LCD_US + esperaExtraUs);
+}
+
+std::mutex travaSerial;                     // Como o lock do HardwareSerial
+std::string textoSerial;
+uint64_t fimTransmissaoNs = 0;              // Quando a FIFO termina de esvaziar
+bool ecoSerial = false;
+
+int ocupacaoFifo(uint64_t agoraNs) {
+  if (fimTransmissaoNs <= agoraNs) return 0;
+  return (int)((fimTransmissaoNs - agoraNs + NS_POR_BYTE_SERIAL - 1) / NS_POR_BYTE_SERIAL);
+}
+
+int pulsoServo = 0;
+bool servoLigado = false;
+unsigned frequenciaTom = 0;
+uint64_t fimTomUs = 0;
+
+// ==============================================================================
+// FLASH
+// ==============================================================================
+
+struct ParticaoSim {
+  esp_partition_t info;
+  std::vector<uint8_t> dados;
+};
+
+std::mutex travaFlash;                      // Como o mutex do driver de flash
+std::atomic<uint32_t> setoresApagados{0};
+
+ParticaoSim *particoes() {                  // Mesma tabela de src/partitions.csv
+  static ParticaoSim tabela[2] = {
+      {{ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)0x40, 0x290000, 0x60000, "usuarios", false},
+       std::vector<uint8_t>(0x60000, 0xFF)},
+      {{ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)0x41, 0x2F0000, 0x100000, "eventos", false},
+       std::vector<uint8_t>(0x100000, 0xFF)},
+  };
+  return tabela;
+}
+
+ParticaoSim *particaoDe(const esp_partition_t *particao) {
+  for (int i = 0; i < 2; i++) {
+    if (&particoes()[i].info == particao) return &particoes()[i];
+  }
+  return nullptr;
+}
+
+// ==============================================================================
+// HORA
+// ==============================================================================
+
+const int64_t SEM_HORA = INT64_MIN;
+std::atomic<int64_t> epochNoBootUs{SEM_HORA}; // Epoch (us) correspondente ao instante 0 do boot
+std::string servidorSntp;
+
+} // namespace
+
+// ==============================================================================
+// API DO SIMULADOR
+// ==============================================================================
+
+namespace sim {
+
+uint64_t agoraUs() { return modoReal.load(std::memory_order_relaxed) ? agoraRealUs() : relogioVirtualUs; }
+
+void avancar(uint64_t us) {
+  if (modoReal.load(std::memory_order_relaxed)) return;
+  uint64_t alvo = relogioVirtualUs + us;
+  if (profundidade > 0) {                   // Dentro de um callback/ISR: só o tempo passa
+    relogioVirtualUs = alvo;
+    return;
+  }
+  profundidade++;
+  processarAte(alvo, true);
+  profundidade--;
+}
+
+void cobrar(uint32_t us) { avancar(us); }
+
+void usarRelogioReal() {
+  if (modoReal.load()) return;
+  baseRealUs = relogioVirtualUs;
+  origemReal = std::chrono::steady_clock::now();
+  modoReal.store(true);
+  threadTimersAtiva.store(true);
+  threadTimers = std::thread(executarThreadTimers);
+}
+
+void pararRelogioReal() {
+  if (!modoReal.load()) return;
+  threadTimersAtiva.store(false);
+  threadTimers.join();
+  relogioVirtualUs = agoraRealUs();
+  modoReal.store(false);
+}
+
+bool relogioReal() { return modoReal.load(std::memory_order_relaxed); }
+
+int nivelPino(uint8_t pino) { return pinos[pino].linha.load(std::memory_order_relaxed); }
+
+void agendarBorda(uint8_t pino, int nivel, uint64_t instanteUs) {
+  eventosLocais.push(EventoSim{instanteUs, ordemEventos++, EVENTO_BORDA, pino, (uint8_t)(nivel ? 1 : 0), 0});
+}
+
+uint32_t trocasPino(uint8_t pino) { return pinos[pino].trocas.load(std::memory_order_relaxed); }
+
+void definirDistancia(unsigned cm) { distanciaCm.store(cm, std::memory_order_relaxed); }
+
+void definirDht(float umidade, float temperatura) {
+  uint8_t d[5];
+  d[0] = (uint8_t)umidade;
+  d[1] = (uint8_t)lroundf((umidade - d[0]) * 10);
+  if (temperatura >= 0) {
+    d[2] = (uint8_t)temperatura;
+    d[3] = (uint8_t)lroundf((temperatura - d[2]) * 10);
+  } else {                                  // Decodificado como -1 - d[2] + d[3]/10
+    float modulo = -temperatura;
+    d[2] = (uint8_t)(ceilf(modulo) - 1);
+    d[3] = (uint8_t)(0x80 | lroundf((d[2] + 1 - modulo) * 10));
+  }
+  d[4] = (uint8_t)(d[0] + d[1] + d[2] + d[3]);
+  uint64_t quadro = 0;
+  for (uint8_t b : d) quadro = (quadro << 8) | b;
+  quadroDht.store(quadro, std::memory_order_relaxed);
+}
+
+void dhtMudo(bool mudo) { dhtSemResposta.store(mudo, std::memory_order_relaxed); }
+
+void apresentarCartao(uint8_t pinoSS, const uint8_t *uid, uint8_t tamanho, bool ignoraHalt) {
+  LeitorSimulado &s = mfrc(pinoSS).estado;
+  s.cartaoPresente = true;
+  s.tamanhoUid = tamanho > 10 ? 10 : tamanho;
+  memcpy(s.uid, uid, s.tamanhoUid);
+  s.ignoraHalt = ignoraHalt;
+  s.estadoCartao = CARTAO_OCIOSO;
+}
+
+void retirarCartao(uint8_t pinoSS) {
+  LeitorSimulado &s = mfrc(pinoSS).estado;
+  s.cartaoPresente = false;
+  s.estadoCartao = CARTAO_OCIOSO;
+}
+
+const LeitorSimulado &leitorRfid(uint8_t pinoSS) { return mfrc(pinoSS).estado; }
+
+void ligarIrqRfid(uint8_t pinoSS, uint8_t pinoIrq) { mfrc(pinoSS).estado.pinoIrq = pinoIrq; }
+
+std::string linhaLcd(int linha) {
+  if (linha < 0 || linha >= linhasLcd) return "";
+  return std::string(telaLcd[linha], colunasLcd);
+}
+
+uint32_t bytesLcd() { return totalBytesLcd; }
+
+std::string saidaSerial() {
+  std::lock_guard<std::mutex> trava(travaSerial);
+  return textoSerial;
+}
+
+void limparSerial() {
+  std::lock_guard<std::mutex> trava(travaSerial);
+  textoSerial.clear();
+}
+
+int pulsoServoUs() { return pulsoServo; }
+bool servoAnexado() { return servoLigado; }
+unsigned tomHz() { return (fimTomUs != 0 && agoraUs() >= fimTomUs) ? 0 : frequenciaTom; }
+
+uint8_t *dadosParticao(const char *rotulo, uint32_t *tamanho) {
+  for (int i = 0; i < 2; i++) {
+    ParticaoSim &p = particoes()[i];
+    if (strcmp(p.info.label, rotulo) != 0) continue;
+    if (tamanho != nullptr) *tamanho = p.info.size;
+    return p.dados.data();
+  }
+  return nullptr;
+}
+
+uint32_t apagamentosFlash() { return setoresApagados.load(std::memory_order_relaxed); }
+
+void definirHoraUtc(time_t epoch) {
+  epochNoBootUs.store((int64_t)epoch * 1000000 - (int64_t)agoraUs(), std::memory_order_relaxed);
+}
+
+bool sincronizarSntp(uint32_t tempoLimiteMs) {
+  std::string host = servidorSntp, porta = "123";
+  size_t separador = host.rfind(':');
+  if (separador != std::string::npos) {
+    porta = host.substr(separador + 1);
+    host = host.substr(0, separador);
+  }
+  addrinfo dica = {}, *enderecos = nullptr;
+  dica.ai_family = AF_INET;
+  dica.ai_socktype = SOCK_DGRAM;
+  if (host.empty() || getaddrinfo(host.c_str(), porta.c_str(), &dica, &enderecos) != 0) return false;
+  int s = ::socket(AF_INET, SOCK_DGRAM, 0);
+  bool ok = false;
+  if (s >= 0) {
+    timeval espera = {(time_t)(tempoLimiteMs / 1000), (suseconds_t)((tempoLimiteMs % 1000) * 1000)};
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &espera, sizeof(espera));
+    uint8_t pacote[48] = {0x23};            // LI 0, versão 4, modo cliente
+    if (sendto(s, pacote, sizeof(pacote), 0, enderecos->ai_addr, enderecos->ai_addrlen) == sizeof(pacote) &&
+        recv(s, pacote, sizeof(pacote), 0) == sizeof(pacote)) {
+      uint32_t segundos = ((uint32_t)pacote[40] << 24) | (pacote[41] << 16) | (pacote[42] << 8) | pacote[43];
+      if (segundos != 0) {
+        definirHoraUtc((time_t)(segundos - 2208988800UL)); // Era NTP (1900) -> Unix (1970)
+        ok = true;
+      }
+    }
+    ::close(s);
+  }
+  freeaddrinfo(enderecos);
+  return ok;
+}
+
+} // namespace sim
+
+// ==============================================================================
+// ARDUINO: TEMPO, PINOS E INTERRUPÇÕES
+// ==============================================================================
+
+unsigned long micros() {
+  atenderInterrupcoes();
+  if (instanteIsr >= 0) return (unsigned long)instanteIsr;
+  return (unsigned long)sim::agoraUs();
+}
+
+unsigned long millis() {
+  atenderInterrupcoes();
+  if (instanteIsr >= 0) return (unsigned long)(instanteIsr / 1000);
+  return (unsigned long)(sim::agoraUs() / 1000);
+}
+
+int64_t esp_timer_get_time() {
+  atenderInterrupcoes();
+  if (instanteIsr >= 0) return instanteIsr;
+  return (int64_t)sim::agoraUs();
+}
+
+void delayMicroseconds(uint32_t us) {
+  if (!modoReal.load(std::memory_order_relaxed)) {
+    sim::avancar(us);
+    return;
+  }
+  uint64_t fim = agoraRealUs() + us;
+  while (agoraRealUs() < fim) atenderInterrupcoes();
+}
+
+void delay(uint32_t ms) {
+  if (!modoReal.load(std::memory_order_relaxed)) {
+    sim::avancar((uint64_t)ms * 1000);
+    return;
+  }
+  uint64_t fim = agoraRealUs() + (uint64_t)ms * 1000;
+  while (agoraRealUs() < fim) {
+    atenderInterrupcoes();
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+}
+
+void pinMode(uint8_t pino, uint8_t modo) {
+  atenderInterrupcoes();
+  pinos[pino].modo = modo;
+  atualizarLinha(pino, sim::agoraUs());
+}
+
+void digitalWrite(uint8_t pino, uint8_t nivel) {
+  atenderInterrupcoes();
+  uint64_t agora = sim::agoraUs();
+  pinos[pino].saida.store(nivel ? 1 : 0, std::memory_order_relaxed);
+  aoEscreverPino(pino, nivel ? 1 : 0, agora);
+  atualizarLinha(pino, agora);
+}
+
+int digitalRead(uint8_t pino) {
+  atenderInterrupcoes();
+  if (pinoIsr == pino) return nivelIsr;     // Nível da borda que disparou a ISR em curso
+  return pinos[pino].linha.load(std::memory_order_relaxed);
+}
+
+void attachInterrupt(uint8_t pino, void (*isr)(void), int modo) {
+  Pino &p = pinos[pino];
+  p.isr = isr;
+  p.isrArg = nullptr;
+  p.modoIsr = modo;
+  p.dono = std::this_thread::get_id();
+}
+
+void attachInterruptArg(uint8_t pino, void (*isr)(void *), void *arg, int modo) {
+  Pino &p = pinos[pino];
+  p.isr = nullptr;
+  p.isrArg = isr;
+  p.arg = arg;
+  p.modoIsr = modo;
+  p.dono = std::this_thread::get_id();
+}
+
+void detachInterrupt(uint8_t pino) {
+  pinos[pino].isr = nullptr;
+  pinos[pino].isrArg = nullptr;
+}
+
+void tone(uint8_t pino, unsigned int frequencia, unsigned long duracao) {
+  sim::cobrar(CUSTO_PWM_US);
+  frequenciaTom = frequencia;
+  fimTomUs = duracao > 0 ? sim::agoraUs() + (uint64_t)duracao * 1000 : 0;
+}
+
+void noTone(uint8_t pino) {
+  sim::cobrar(CUSTO_PWM_US);
+  frequenciaTom = 0;
+  fimTomUs = 0;
+}
+
+// ==============================================================================
+// ARDUINO: TEXTO E SERIAL
+// ==============================================================================
+
+size_t Print::write(const uint8_t *dados, size_t tamanho) {
+  size_t escritos = 0;
+  while (escritos < tamanho && write(dados[escritos])) escritos++;
+  return escritos;
+}
+
+size_t Print::printf(const char *formato, ...) {
+  char local[256];
+  va_list args;
+  va_start(args, formato);
+  int tamanho = vsnprintf(local, sizeof(local), formato, args);
+  va_end(args);
+  if (tamanho < 0) return 0;
+  if ((size_t)tamanho < sizeof(local)) return write((const uint8_t *)local, tamanho);
+  std::vector<char> grande(tamanho + 1);
+  va_start(args, formato);
+  vsnprintf(grande.data(), grande.size(), formato, args);
+  va_end(args);
+  return write((const uint8_t *)grande.data(), tamanho);
+}
+
+void HardwareSerial::begin(unsigned long baud) {
+  std::lock_guard<std::mutex> trava(travaSerial);
+  ecoSerial = getenv("SALA_SIM_SERIAL") != nullptr;
+  textoSerial.reserve(1 << 20);
+}
+
+size_t HardwareSerial::write(uint8_t c) { return write(&c, 1); }
+
+size_t HardwareSerial::write(const uint8_t *dados, size_t tamanho) {
+  uint64_t esperaNs = 0;
+  {
+    std::lock_guard<std::mutex> trava(travaSerial);
+    uint64_t agoraNs = sim::agoraUs() * 1000;
+    uint64_t inicio = fimTransmissaoNs > agoraNs ? fimTransmissaoNs : agoraNs;
+    fimTransmissaoNs = inicio + tamanho * NS_POR_BYTE_SERIAL;
+    uint64_t limite = agoraNs + FIFO_SERIAL * NS_POR_BYTE_SERIAL; // Além disso, write() espera a FIFO
+    if (fimTransmissaoNs > limite) esperaNs = fimTransmissaoNs - limite;
+    if (textoSerial.size() + tamanho > (1u << 20)) textoSerial.erase(0, textoSerial.size() / 2);
+    textoSerial.append((const char *)dados, tamanho);
+    if (ecoSerial) fwrite(dados, 1, tamanho, stdout);
+  }
+  if (esperaNs > 0) sim::cobrar((uint32_t)((esperaNs + 999) / 1000));
+  return tamanho;
+}
+
+int HardwareSerial::availableForWrite() {
+  std::lock_guard<std::mutex> trava(travaSerial);
+  return FIFO_SERIAL - ocupacaoFifo(sim::agoraUs() * 1000);
+}
+
+void HardwareSerial::flush() {
+  uint64_t esperaNs = 0;
+  {
+    std::lock_guard<std::mutex> trava(travaSerial);
+    uint64_t agoraNs = sim::agoraUs() * 1000;
+    if (fimTransmissaoNs > agoraNs) esperaNs = fimTransmissaoNs - agoraNs;
+  }
+  if (esperaNs > 0) sim::cobrar((uint32_t)((esperaNs + 999) / 1000));
+}
+
+// ==============================================================================
+// ESP32 E FREERTOS
+// ==============================================================================
+
+uint32_t EspClass::getFreeHeap() { return 180000; }
+
+size_t heap_caps_get_largest_free_block(uint32_t capacidades) { return 110592; }
+
+uint32_t esp_random() {
+  static std::atomic<uint32_t> estado{0x2545F491};
+  uint32_t x = estado.load(std::memory_order_relaxed);
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  estado.store(x, std::memory_order_relaxed);
+  return x;
+}
+
+void configTzTime(const char *fuso, const char *servidor1, const char *servidor2, const char *servidor3) {
+  setenv("TZ", fuso, 1);
+  tzset();
+  servidorSntp = servidor1 != nullptr ? servidor1 : "";
+}
+
+// Hora do sistema: segundos desde o boot até o SNTP acertar o relógio, como no ESP32
+extern "C" time_t time(time_t *destino) noexcept {
+  int64_t base = epochNoBootUs.load(std::memory_order_relaxed);
+  int64_t agora = (int64_t)sim::agoraUs();
+  time_t segundos = (time_t)((base == SEM_HORA ? agora : base + agora) / 1000000);
+  if (destino != nullptr) *destino = segundos;
+  return segundos;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t funcao, const char *nome, uint32_t pilha, void *parametro,
+                                   UBaseType_t prioridade, TaskHandle_t *tarefa, BaseType_t nucleo) {
+  if (tarefa != nullptr) *tarefa = nullptr;
+  return pdPASS;                            // O teste roda a tarefa (ver passoRede())
+}
+
+void vTaskDelay(TickType_t ticks) { delay(ticks); }
+
+// ==============================================================================
+// esp_timer
+// ==============================================================================
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *timer) {
+  esp_timer *t = new esp_timer{args->callback, args->arg, args->name, false, false, 0, 0};
+  std::lock_guard<std::mutex> trava(travaTimers);
+  timers().push_back(t);
+  *timer = t;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t atrasoUs) {
+  uint64_t agora = sim::agoraUs();
+  std::lock_guard<std::mutex> trava(travaTimers);
+  timer->ativo = true;
+  timer->periodico = false;
+  timer->proximoUs = agora + atrasoUs;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t periodoUs) {
+  uint64_t agora = sim::agoraUs();
+  std::lock_guard<std::mutex> trava(travaTimers);
+  timer->ativo = true;
+  timer->periodico = true;
+  timer->periodoUs = periodoUs;
+  timer->proximoUs = agora + periodoUs;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+  std::lock_guard<std::mutex> trava(travaTimers);
+  timer->ativo = false;
+  return ESP_OK;
+}
+
+// ==============================================================================
+// FLASH E CRC
+// ==============================================================================
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t tipo, esp_partition_subtype_t subtipo,
+                                                const char *rotulo) {
+  for (int i = 0; i < 2; i++) {
+    const esp_partition_t &p = particoes()[i].info;
+    if (p.type != tipo) continue;
+    if (subtipo != ESP_PARTITION_SUBTYPE_ANY && p.subtype != subtipo) continue;
+    if (rotulo != nullptr && strcmp(p.label, rotulo) != 0) continue;
+    return &p;
+  }
+  return nullptr;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *particao, size_t offset, void *destino, size_t tamanho) {
+  ParticaoSim *p = particaoDe(particao);
+  if (p == nullptr) return ESP_ERR_INVALID_ARG;
+  if (offset + tamanho > particao->size) return ESP_ERR_INVALID_SIZE;
+  {
+    std::lock_guard<std::mutex> trava(travaFlash);
+    memcpy(destino, p->dados.data() + offset, tamanho);
+  }
+  sim::cobrar(CUSTO_LER_US + (uint32_t)(tamanho / 40));
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *particao, size_t offset, const void *origem, size_t tamanho) {
+  ParticaoSim *p = particaoDe(particao);
+  if (p == nullptr) return ESP_ERR_INVALID_ARG;
+  if (offset + tamanho > particao->size) return ESP_ERR_INVALID_SIZE;
+  {
+    std::lock_guard<std::mutex> trava(travaFlash);
+    const uint8_t *bytes = (const uint8_t *)origem;
+    for (size_t i = 0; i < tamanho; i++) p->dados[offset + i] &= bytes[i]; // NOR: gravar só zera bits
+  }
+  sim::cobrar(CUSTO_GRAVAR_US + (uint32_t)(tamanho * 5 / 2));
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *particao, size_t offset, size_t tamanho) {
+  ParticaoSim *p = particaoDe(particao);
+  if (p == nullptr || offset % 4096 != 0 || tamanho % 4096 != 0) return ESP_ERR_INVALID_ARG;
+  if (offset + tamanho > particao->size) return ESP_ERR_INVALID_SIZE;
+  {
+    std::lock_guard<std::mutex> trava(travaFlash);
+    memset(p->dados.data() + offset, 0xFF, tamanho);
+  }
+  setoresApagados.fetch_add((uint32_t)(tamanho / 4096), std::memory_order_relaxed);
+  sim::cobrar((uint32_t)(tamanho / 4096) * CUSTO_APAGAR_SETOR_US);
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t *particao, size_t offset, size_t tamanho,
+                             spi_flash_mmap_memory_t memoria, const void **ponteiro, spi_flash_mmap_handle_t *mapa) {
+  ParticaoSim *p = particaoDe(particao);
+  if (p == nullptr) return ESP_ERR_INVALID_ARG;
+  if (offset + tamanho > particao->size) return ESP_ERR_INVALID_SIZE;
+  *ponteiro = p->dados.data() + offset;
+  *mapa = (spi_flash_mmap_handle_t)(offset + 1);
+  return ESP_OK;
+}
+
+void spi_flash_munmap(spi_flash_mmap_handle_t mapa) {}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *dados, uint32_t tamanho) {
+  static uint32_t tabela[256];
+  static bool pronta = false;
+  if (!pronta) {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+      tabela[i] = c;
+    }
+    pronta = true;
+  }
+  crc = ~crc;
+  for (uint32_t i = 0; i < tamanho; i++) crc = tabela[(crc ^ dados[i]) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+// ==============================================================================
+// LCD
+// ==============================================================================
+
+LiquidCrystal_I2C::LiquidCrystal_I2C(uint8_t endereco, uint8_t colunas, uint8_t linhas)
+    : colunas_(colunas), linhas_(linhas) {}
+
+void LiquidCrystal_I2C::init() {
+  colunasLcd = colunas_ > 40 ? 40 : colunas_;
+  linhasLcd = linhas_ > 4 ? 4 : linhas_;
+  limparTelaLcd();
+  colunaLcd = linhaCursorLcd = 0;
+  sim::cobrar(CUSTO_INICIAR_LCD_US);
+}
+
+void LiquidCrystal_I2C::backlight() { sim::cobrar(CUSTO_BYTE_LCD_US / 4); }
+void LiquidCrystal_I2C::noBacklight() { sim::cobrar(CUSTO_BYTE_LCD_US / 4); }
+
+void LiquidCrystal_I2C::clear() {
+  limparTelaLcd();
+  colunaLcd = linhaCursorLcd = 0;
+  byteLcd(ESPERA_LIMPAR_LCD_US);
+}
+
+void LiquidCrystal_I2C::home() {
+  colunaLcd = linhaCursorLcd = 0;
+  byteLcd(ESPERA_LIMPAR_LCD_US);
+}
+
+void LiquidCrystal_I2C::setCursor(uint8_t coluna, uint8_t linha) {
+  colunaLcd = coluna;
+  linhaCursorLcd = linha < linhasLcd ? linha : linhasLcd - 1;
+  byteLcd();
+}
+
+size_t LiquidCrystal_I2C::write(uint8_t c) {
+  if (colunaLcd < colunasLcd) telaLcd[linhaCursorLcd][colunaLcd] = (char)c;
+  colunaLcd++;
+  byteLcd();
+  return 1;
+}
+
+// ==============================================================================
+// SERVO
+// ==============================================================================
+
+void Servo::setPeriodHertz(int hertz) {}
+
+int Servo::attach(int pino, int minimoUs, int maximoUs) {
+  minimoUs_ = minimoUs;
+  maximoUs_ = maximoUs;
+  servoLigado = true;
+  sim::cobrar(CUSTO_PWM_US);
+  return 0;
+}
+
+void Servo::detach() {
+  servoLigado = false;
+  sim::cobrar(CUSTO_PWM_US);
+}
+
+void Servo::write(int angulo) {
+  if (angulo < 0) angulo = 0;
+  if (angulo > 180) angulo = 180;
+  writeMicroseconds(minimoUs_ + (maximoUs_ - minimoUs_) * angulo / 180);
+}
+
+void Servo::writeMicroseconds(int pulsoUs) {
+  pulsoServo = pulsoUs;
+  sim::cobrar(CUSTO_PWM_US);
+}
+
+// ==============================================================================
+// MFRC522
+// ==============================================================================
+
+MFRC522::MFRC522() : uid{}, pinoSS_(255), pinoReset_(255) {}
+
+MFRC522::MFRC522(byte pinoSS, byte pinoReset) : uid{}, pinoSS_(pinoSS), pinoReset_(pinoReset) {}
+
+void MFRC522::PCD_Init(byte pinoSS, byte pinoReset) {
+  pinoSS_ = pinoSS;
+  pinoReset_ = pinoReset;
+  PCD_Init();
+}
+
+void MFRC522::PCD_Init() {
+  Mfrc &m = mfrc(pinoSS_);
+  m.geracao++;
+  m.tamanhoFifo = 0;
+  m.comando = PCD_Idle;
+  m.estado.comIEn = 0x80;                   // Valores de reset
+  m.estado.comIrq = 0x14;
+  if (m.estado.estadoCartao != CARTAO_OCIOSO) m.estado.estadoCartao = CARTAO_OCIOSO; // Antena desligada no reset
+  atualizarIrq(m, sim::agoraUs());
+  sim::cobrar(CUSTO_INICIAR_PCD_US);
+}
+
+void MFRC522::PCD_WriteRegister(PCD_Register registrador, byte valor) {
+  Mfrc &m = mfrc(pinoSS_);
+  sim::cobrar(CUSTO_REGISTRO_SPI_US);
+  switch (registrador) {
+  case ComIEnReg:
+    m.estado.comIEn = valor;
+    atualizarIrq(m, sim::agoraUs());
+    break;
+  case ComIrqReg:                           // Bit 7 (Set1): 1 marca, 0 limpa os bits indicados
+    if (valor & 0x80) alterarIrq(m, 0, valor & 0x7F);
+    else alterarIrq(m, valor & 0x7F, 0);
+    break;
+  case FIFODataReg:
+    if (m.tamanhoFifo < sizeof(m.fifo)) m.fifo[m.tamanhoFifo++] = valor;
+    break;
+  case FIFOLevelReg:
+    if (valor & 0x80) m.tamanhoFifo = 0;    // FlushBuffer
+    break;
+  case CommandReg:
+    m.comando = valor & 0x0F;
+    m.geracao++;                            // Um comando novo cancela a transação anterior
+    break;
+  case BitFramingReg:
+    if ((valor & 0x80) && m.comando == PCD_Transceive) transmitir(m, pinoSS_);
+    break;
+  default:
+    break;
+  }
+}
+
+byte MFRC522::PCD_ReadRegister(PCD_Register registrador) {
+  Mfrc &m = mfrc(pinoSS_);
+  sim::cobrar(CUSTO_REGISTRO_SPI_US);
+  switch (registrador) {
+  case ComIEnReg: return m.estado.comIEn;
+  case ComIrqReg: return m.estado.comIrq;
+  case FIFOLevelReg: return m.tamanhoFifo;
+  case FIFODataReg: {
+    if (m.tamanhoFifo == 0) return 0;
+    byte valor = m.fifo[0];
+    memmove(m.fifo, m.fifo + 1, --m.tamanhoFifo);
+    return valor;
+  }
+  case CommandReg: return m.comando;
+  default: return 0;
+  }
+}
+
+// Como PCD_CommunicateWithPICC(): limpa ComIrqReg, transmite e espera RxIRq ou o timeout.
+bool MFRC522::PICC_IsNewCardPresent() {
+  Mfrc &m = mfrc(pinoSS_);
+  sim::LeitorSimulado &s = m.estado;
+  m.geracao++;
+  alterarIrq(m, 0x7F, 0);
+  s.reqas++;
+  if (!respondeAoPedido(s, false)) {
+    if (s.estadoCartao == CARTAO_PRONTO || s.estadoCartao == CARTAO_ATIVO) s.estadoCartao = CARTAO_OCIOSO;
+    cobrarTransacao(m, TIMEOUT_RFID_US);
+    alterarIrq(m, 0, IRQ_TIMER);
+    return false;
+  }
+  s.estadoCartao = CARTAO_PRONTO;
+  s.respostasReqa++;
+  cobrarTransacao(m, ATRASO_ATQA_US + 8 * CUSTO_REGISTRO_SPI_US);
+  alterarIrq(m, 0, IRQ_RX | IRQ_OCIOSO);
+  return true;
+}
+
+// PICC_Select(): anticolisão + SELECT por nível de cascata, cada troca sinalizando RxIRq.
+bool MFRC522::PICC_ReadCardSerial() {
+  Mfrc &m = mfrc(pinoSS_);
+  sim::LeitorSimulado &s = m.estado;
+  m.geracao++;
+  if (!s.cartaoPresente || s.estadoCartao != CARTAO_PRONTO) {
+    alterarIrq(m, 0x7F, 0);
+    cobrarTransacao(m, TIMEOUT_RFID_US);
+    alterarIrq(m, 0, IRQ_TIMER);
+    s.leiturasSemResposta++;
+    return false;
+  }
+  int trocas = s.tamanhoUid <= 4 ? 2 : (s.tamanhoUid <= 7 ? 4 : 6);
+  uint64_t inicio = sim::agoraUs();
+  for (int i = 0; i < trocas; i++) {
+    alterarIrq(m, 0x7F, 0);
+    sim::cobrar(CUSTO_QUADRO_RFID_US);
+    alterarIrq(m, 0, IRQ_RX | IRQ_OCIOSO);
+  }
+  uint32_t duracao = (uint32_t)(sim::agoraUs() - inicio);
+  s.ocupadoUs += duracao;
+  if (duracao > s.maiorTransacaoUs) s.maiorTransacaoUs = duracao;
+  s.estadoCartao = CARTAO_ATIVO;
+  s.leituras++;
+  uid.size = s.tamanhoUid;
+  memcpy(uid.uidByte, s.uid, s.tamanhoUid);
+  uid.sak = 0x08;
+  return true;
+}
+
+// O HLTA não tem resposta: a biblioteca espera o timer do MFRC522 vencer.
+MFRC522::StatusCode MFRC522::PICC_HaltA() {
+  Mfrc &m = mfrc(pinoSS_);
+  sim::LeitorSimulado &s = m.estado;
+  m.geracao++;
+  alterarIrq(m, 0x7F, 0);
+  s.halts++;
+  if (s.cartaoPresente && s.estadoCartao != CARTAO_OCIOSO) s.estadoCartao = CARTAO_PARADO;
+  cobrarTransacao(m, TIMEOUT_RFID_US);
+  alterarIrq(m, 0, IRQ_TIMER);
+  return STATUS_OK;
+}
+
+void MFRC522::PCD_StopCrypto1() { sim::cobrar(2 * CUSTO_REGISTRO_SPI_US); }
@@ -0,0 +1,99 @@
+/**
+ * @file simulador.h
+ * @brief Simulador de host do firmware da sala: relógio virtual e periféricos modelados.
+ * @details src/main.cpp é compilado sem alterações contra os cabeçalhos de host/stubs.
+ * No relógio virtual (padrão) o tempo só anda quando o firmware espera (delay), quando um
+ * periférico cobra o seu custo (LCD, Serial, SPI, flash) ou quando o teste chama
+ * sim::avancar(); timers do esp_timer e bordas dos sensores disparam nos instantes exatos,
+ * como interrupções. O resultado é determinístico e roda milhões de voltas por segundo.
+ *
+ * No relógio real (sim::usarRelogioReal()) o tempo é o do sistema, os timers rodam numa
+ * thread própria (a tarefa esp_timer do núcleo 0) e cada ISR roda na thread que a anexou,
+ * entre duas chamadas dela à API do Arduino, como uma interrupção naquele núcleo. O
+ * simulador não cria sincronização entre as threads do firmware além da que o hardware
+ * teria (Serial e flash têm trava), então o ThreadSanitizer enxerga as corridas reais.
+ *
+ * Ligações da placa usadas pelos modelos: TRIG 16 / ECHO 17 (HC-SR04), DHT11 no 15 e as
+ * linhas IRQ dos MFRC522 (SS 5 -> IRQ 34, SS 27 -> IRQ 35), como no diagrama esquemático.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+#include <string>
+
+namespace sim {
+
+// ==============================================================================
+// RELÓGIO
+// ==============================================================================
+
+uint64_t agoraUs();                         // Microssegundos desde o boot (virtual ou real)
+void avancar(uint64_t us);                  // Relógio virtual: anda, disparando timers e bordas vencidos
+void cobrar(uint32_t us);                   // Custo de CPU/periférico (não faz nada no relógio real)
+void usarRelogioReal();                     // Passa a seguir o relógio do sistema a partir do instante atual
+void pararRelogioReal();                    // Encerra a thread de timers (chame antes de sair)
+bool relogioReal();
+
+// ==============================================================================
+// PINOS
+// ==============================================================================
+
+int nivelPino(uint8_t pino);                // Nível da linha (saída do ESP32 e o que os sensores forçam)
+void agendarBorda(uint8_t pino, int nivel, uint64_t instanteUs); // Um sensor muda a linha no instante dado
+uint32_t trocasPino(uint8_t pino);          // Mudanças de nível da linha desde o boot
+
+// ==============================================================================
+// SENSORES
+// ==============================================================================
+
+void definirDistancia(unsigned cm);         // Obstáculo à frente do HC-SR04 (0 = nenhum eco)
+void definirDht(float umidade, float temperatura); // Valores das próximas respostas do DHT11
+void dhtMudo(bool mudo);                    // true = o DHT11 não responde ao pulso de início
+
+struct LeitorSimulado {                     // Estado e contadores de um MFRC522 simulado
+  uint8_t pinoIrq;                          // Linha IRQ ligada a este leitor (255 = nenhuma)
+  bool cartaoPresente;
+  uint8_t uid[10];
+  uint8_t tamanhoUid;
+  bool ignoraHalt;                          // Cartão (ou celular) que volta a responder ao REQA mesmo após HLTA
+  uint8_t estadoCartao;                     // 0 ocioso, 1 pronto (respondeu REQA), 2 ativo, 3 parado (HLTA)
+  uint8_t comIEn;                           // ComIEnReg atual
+  uint8_t comIrq;                           // Bits de interrupção pendentes (ComIrqReg)
+  uint32_t reqas;                           // REQA transmitidos
+  uint32_t respostasReqa;                   // ATQA recebidos
+  uint32_t leituras;                        // PICC_ReadCardSerial() com sucesso
+  uint32_t leiturasSemResposta;             // PICC_ReadCardSerial() que esperaram o timeout
+  uint32_t halts;                           // HLTA enviados (bloqueantes ou não)
+  uint32_t bordasIrq;                       // Descidas da linha IRQ
+  uint64_t ocupadoUs;                       // Tempo total em transações bloqueantes do driver
+  uint32_t maiorTransacaoUs;                // Transação bloqueante mais longa
+};
+
+void apresentarCartao(uint8_t pinoSS, const uint8_t *uid, uint8_t tamanho, bool ignoraHalt = false);
+void retirarCartao(uint8_t pinoSS);
+const LeitorSimulado &leitorRfid(uint8_t pinoSS);
+void ligarIrqRfid(uint8_t pinoSS, uint8_t pinoIrq); // Muda a ligação padrão da placa
+
+// ==============================================================================
+// SAÍDAS OBSERVÁVEIS
+// ==============================================================================
+
+std::string linhaLcd(int linha);            // Texto exibido numa linha do LCD
+uint32_t bytesLcd();                        // Bytes enviados ao LCD (caracteres + comandos)
+std::string saidaSerial();                  // Tudo o que o firmware escreveu no Serial
+void limparSerial();
+int pulsoServoUs();                         // Último pulso comandado (0 = nenhum)
+bool servoAnexado();
+unsigned tomHz();                           // Frequência tocando no buzzer (0 = silêncio)
+
+// ==============================================================================
+// FLASH E HORA
+// ==============================================================================
+
+uint8_t *dadosParticao(const char *rotulo, uint32_t *tamanho = nullptr); // Conteúdo de uma partição
+uint32_t apagamentosFlash();                // Setores apagados desde o boot
+void definirHoraUtc(time_t epoch);          // Como se o SNTP tivesse acertado o relógio agora
+bool sincronizarSntp(uint32_t tempoLimiteMs = 1000); // Consulta o servidor de configTzTime() ("host[:porta]")
+
+} // namespace sim
@@ -0,0 +1,139 @@
+/**
+ * @file Arduino.h
+ * @brief API do Arduino-ESP32 usada pelo firmware, implementada pelo simulador de host.
+ * @details Só declara o que src/main.cpp usa. Tempo, pinos, interrupções e tarefas são
+ * atendidos por host/simulador.cpp (relógio virtual ou real, ver simulador.h).
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <string>
+
+typedef uint8_t byte;
+
+#define IRAM_ATTR                           // Sem IRAM/RTC no host: memória comum
+#define RTC_NOINIT_ATTR
+#define PROGMEM
+#define PGM_P const char *
+#define F(texto) (texto)
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define OUTPUT_OPEN_DRAIN 0x13
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+// ==============================================================================
+// TEXTO E SAÍDA SERIAL
+// ==============================================================================
+
+class String {                              // Só o necessário para 'mensagemSistema'
+public:
+  String(const char *texto = "") : texto_(texto) {}
+  String &operator=(const char *texto) { texto_ = texto; return *this; }
+  const char *c_str() const { return texto_.c_str(); }
+  size_t length() const { return texto_.size(); }
+  bool operator==(const char *texto) const { return texto_ == texto; }
+  bool operator!=(const char *texto) const { return texto_ != texto; }
+
+private:
+  std::string texto_;
+};
+
+class IPAddress {
+public:
+  IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : octetos_{a, b, c, d} {}
+  uint8_t operator[](int i) const { return octetos_[i]; }
+
+private:
+  uint8_t octetos_[4];
+};
+
+class Print {                               // Mesma divisão do Arduino: write() por classe, print() comum
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *dados, size_t tamanho);
+  size_t write(const char *texto) { return write((const uint8_t *)texto, strlen(texto)); }
+
+  size_t print(const char *texto) { return write(texto); }
+  size_t print(const String &texto) { return write(texto.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int valor) { return printf("%d", valor); }
+  size_t print(unsigned int valor) { return printf("%u", valor); }
+  size_t print(long valor) { return printf("%ld", valor); }
+  size_t print(unsigned long valor) { return printf("%lu", valor); }
+  size_t print(double valor, int casas = 2) { return printf("%.*f", casas, valor); }
+  size_t print(const IPAddress &ip) { return printf("%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]); }
+  template <typename T> size_t println(const T &valor) { return print(valor) + println(); }
+  size_t println(double valor, int casas) { return print(valor, casas) + println(); }
+  size_t println() { return write("\r\n"); }
+  size_t printf(const char *formato, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class HardwareSerial : public Print {       // UART0 a 115200 baud com a FIFO de 128 bytes do ESP32
+public:
+  void begin(unsigned long baud);
+  using Print::write;
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *dados, size_t tamanho) override;
+  int availableForWrite();                  // Bytes livres na FIFO (escrever até isso não bloqueia)
+  void flush();
+};
+extern HardwareSerial Serial;
+
+// ==============================================================================
+// TEMPO, PINOS E INTERRUPÇÕES
+// ==============================================================================
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+void pinMode(uint8_t pino, uint8_t modo);
+void digitalWrite(uint8_t pino, uint8_t nivel);
+int digitalRead(uint8_t pino);
+inline int digitalPinToInterrupt(uint8_t pino) { return pino; }
+void attachInterrupt(uint8_t pino, void (*isr)(void), int modo);
+void attachInterruptArg(uint8_t pino, void (*isr)(void *), void *arg, int modo);
+void detachInterrupt(uint8_t pino);
+
+void tone(uint8_t pino, unsigned int frequencia, unsigned long duracao = 0);
+void noTone(uint8_t pino);
+
+// ==============================================================================
+// ESP32 E FREERTOS
+// ==============================================================================
+
+class EspClass {
+public:
+  uint32_t getFreeHeap();
+};
+extern EspClass ESP;
+
+uint32_t esp_random();
+void configTzTime(const char *fuso, const char *servidor1, const char *servidor2 = nullptr,
+                  const char *servidor3 = nullptr);
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+#define pdPASS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))  // Tick de 1 ms (CONFIG_FREERTOS_HZ = 1000)
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t funcao, const char *nome, uint32_t pilha, void *parametro,
+                                   UBaseType_t prioridade, TaskHandle_t *tarefa, BaseType_t nucleo);
+void vTaskDelay(TickType_t ticks);
@@ -0,0 +1,17 @@
+/**
+ * @file ESP32Servo.h
+ * @brief Servo por PWM (LEDC). O simulador guarda o pulso e se o servo está anexado.
+ */
+#pragma once
+
+class Servo {
+public:
+  void setPeriodHertz(int hertz);
+  int attach(int pino, int minimoUs, int maximoUs);
+  void detach();
+  void write(int angulo);                   // 0..180 graus, convertido para o pulso entre os limites
+  void writeMicroseconds(int pulsoUs);
+
+private:
+  int minimoUs_ = 544, maximoUs_ = 2400;
+};
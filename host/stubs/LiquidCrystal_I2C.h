@@ -0,0 +1,25 @@
+/**
+ * @file LiquidCrystal_I2C.h
+ * @brief LCD HD44780 atrás de um PCF8574, com o custo da biblioteca real a 100 kHz.
+ * @details Cada byte (caractere ou comando) vira dois nibbles e seis transmissões I2C,
+ * cerca de 1,3 ms; clear() e home() ainda esperam 2 ms. O texto exibido fica disponível
+ * para os testes em sim::linhaLcd().
+ */
+#pragma once
+#include <Arduino.h>
+
+class LiquidCrystal_I2C : public Print {
+public:
+  LiquidCrystal_I2C(uint8_t endereco, uint8_t colunas, uint8_t linhas);
+  void init();
+  void backlight();
+  void noBacklight();
+  void clear();
+  void home();
+  void setCursor(uint8_t coluna, uint8_t linha);
+  using Print::write;
+  size_t write(uint8_t c) override;
+
+private:
+  uint8_t colunas_, linhas_;
+};
@@ -0,0 +1,67 @@
+/**
+ * @file MFRC522.h
+ * @brief Driver do MFRC522 (mesma interface da biblioteca de miguelbalboa) sobre leitores simulados.
+ * @details Cada objeto é o leitor do seu pino SS no simulador. As transações bloqueiam
+ * como na biblioteca: PICC_ReadCardSerial() faz uma troca de quadros por nível de
+ * cascata e, se o cartão não responde, espera o timer interno de 25 ms; PICC_HaltA()
+ * sempre espera esse timer (o sucesso do HLTA é o silêncio do cartão). Os quadros
+ * recebidos ativam RxIRq, que sai na linha IRQ se RxIEn estiver habilitado.
+ */
+#pragma once
+#include <Arduino.h>
+
+class MFRC522 {
+public:
+  enum PCD_Register : byte {
+    CommandReg = 0x01 << 1,
+    ComIEnReg = 0x02 << 1,
+    DivIEnReg = 0x03 << 1,
+    ComIrqReg = 0x04 << 1,
+    DivIrqReg = 0x05 << 1,
+    ErrorReg = 0x06 << 1,
+    Status2Reg = 0x08 << 1,
+    FIFODataReg = 0x09 << 1,
+    FIFOLevelReg = 0x0A << 1,
+    ControlReg = 0x0C << 1,
+    BitFramingReg = 0x0D << 1,
+  };
+  enum PCD_Command : byte {
+    PCD_Idle = 0x00,
+    PCD_CalcCRC = 0x03,
+    PCD_Transceive = 0x0C,
+    PCD_SoftReset = 0x0F,
+  };
+  enum PICC_Command : byte {
+    PICC_CMD_REQA = 0x26,
+    PICC_CMD_WUPA = 0x52,
+    PICC_CMD_HLTA = 0x50,
+  };
+  enum StatusCode : byte {
+    STATUS_OK,
+    STATUS_ERROR,
+    STATUS_COLLISION,
+    STATUS_TIMEOUT,
+  };
+  struct Uid {
+    byte size;
+    byte uidByte[10];
+    byte sak;
+  };
+
+  Uid uid;
+
+  MFRC522();
+  MFRC522(byte pinoSS, byte pinoReset);
+  void PCD_Init();
+  void PCD_Init(byte pinoSS, byte pinoReset); // Define os pinos e inicia (como na biblioteca)
+  void PCD_WriteRegister(PCD_Register registrador, byte valor);
+  byte PCD_ReadRegister(PCD_Register registrador);
+  bool PICC_IsNewCardPresent();
+  bool PICC_ReadCardSerial();
+  StatusCode PICC_HaltA();
+  void PCD_StopCrypto1();
+
+private:
+  byte pinoSS_;
+  byte pinoReset_;
+};
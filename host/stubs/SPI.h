@@ -0,0 +1,11 @@
+/**
+ * @file SPI.h
+ * @brief Barramento SPI do ESP32 (no host, os leitores RFID simulados não precisam dele).
+ */
+#pragma once
+
+class SPIClass {
+public:
+  void begin() {}
+};
+extern SPIClass SPI;
@@ -0,0 +1,16 @@
+/**
+ * @file WiFi.h
+ * @brief Wi-Fi do ESP32. No host a "rede" já está conectada (127.0.0.1).
+ */
+#pragma once
+#include <Arduino.h>
+
+#define WL_CONNECTED 3
+
+class WiFiClass {
+public:
+  void begin(const char *ssid, const char *senha) {}
+  int status() { return WL_CONNECTED; }
+  IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+};
+extern WiFiClass WiFi;
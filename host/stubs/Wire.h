@@ -0,0 +1,5 @@
+/**
+ * @file Wire.h
+ * @brief I2C do ESP32 (no host, o custo do barramento é cobrado pelo LCD simulado).
+ */
+#pragma once
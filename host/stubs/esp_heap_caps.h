@@ -0,0 +1,10 @@
+/**
+ * @file esp_heap_caps.h
+ * @brief Consulta do heap do ESP-IDF (valores fixos no host).
+ */
+#pragma once
+#include <stddef.h>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+
+size_t heap_caps_get_largest_free_block(uint32_t capacidades);
@@ -0,0 +1,39 @@
+/**
+ * @file esp_partition.h
+ * @brief Partições de dados do ESP-IDF sobre buffers na RAM (semântica de flash NOR).
+ * @details Apagar põe 0xFF; gravar só baixa bits (E lógico), como na flash real. As
+ * partições de src/partitions.csv ("usuarios" e "eventos") existem desde o início.
+ */
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_SIZE 0x104
+
+typedef enum { ESP_PARTITION_TYPE_APP = 0x00, ESP_PARTITION_TYPE_DATA = 0x01 } esp_partition_type_t;
+typedef enum { ESP_PARTITION_SUBTYPE_ANY = 0xff } esp_partition_subtype_t;
+
+typedef struct {
+  esp_partition_type_t type;
+  esp_partition_subtype_t subtype;
+  uint32_t address;
+  uint32_t size;
+  char label[17];
+  bool encrypted;
+} esp_partition_t;
+
+typedef uint32_t spi_flash_mmap_handle_t;
+typedef enum { SPI_FLASH_MMAP_DATA, SPI_FLASH_MMAP_INST } spi_flash_mmap_memory_t;
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t tipo, esp_partition_subtype_t subtipo,
+                                                const char *rotulo);
+esp_err_t esp_partition_read(const esp_partition_t *particao, size_t offset, void *destino, size_t tamanho);
+esp_err_t esp_partition_write(const esp_partition_t *particao, size_t offset, const void *origem, size_t tamanho);
+esp_err_t esp_partition_erase_range(const esp_partition_t *particao, size_t offset, size_t tamanho);
+esp_err_t esp_partition_mmap(const esp_partition_t *particao, size_t offset, size_t tamanho,
+                             spi_flash_mmap_memory_t memoria, const void **ponteiro, spi_flash_mmap_handle_t *mapa);
+void spi_flash_munmap(spi_flash_mmap_handle_t mapa);
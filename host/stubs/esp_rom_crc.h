@@ -0,0 +1,8 @@
+/**
+ * @file esp_rom_crc.h
+ * @brief CRC32 (polinômio 0xEDB88320) com a mesma convenção da ROM do ESP32: crc = 0 no início.
+ */
+#pragma once
+#include <stdint.h>
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *dados, uint32_t tamanho);
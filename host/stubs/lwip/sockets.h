@@ -0,0 +1,13 @@
+/**
+ * @file sockets.h
+ * @brief Sockets BSD do lwIP. No host são os sockets POSIX do Linux, com a mesma API.
+ */
+#pragma once
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
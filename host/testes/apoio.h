@@ -0,0 +1,257 @@
+/**
+ * @file apoio.h
+ * @brief Apoio comum dos testes: verificações, loop no relógio virtual e cenários roteirizados.
+ * @details Incluído depois de src/main.cpp, então enxerga os globais do firmware.
+ *
+ * Um cenário (arquivo .txt em host/cenarios) tem um comando por linha, "instante_ms comando args",
+ * com o instante contado a partir do fim do setup():
+ *   distancia <cm>                      obstáculo à frente do ultrassônico (0 = nenhum eco)
+ *   dht <umidade> <temperatura>         próximas leituras do DHT11
+ *   cartao <entrada|saida> <uid hex>    aproxima um cartão ("ignora-halt" no fim: celular)
+ *   retira <entrada|saida>              afasta o cartão
+ *   comando <luz|ventilacao> <on|off>   como se a web tivesse enfileirado o comando
+ *   verifica <saida> <valor>            luz, ventoinha, ventoinha_auto, porta (0/1) ou servo (us)
+ *   lcd <linha> <texto>                 a linha do LCD começa com o texto
+ *   serial <texto>                      o texto apareceu no Serial
+ */
+#pragma once
+
+#include "simulador.h"
+
+#include <fcntl.h>
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+int falhasTeste = 0;
+
+#define VERIFICAR(condicao)                                                                        \
+    do {                                                                                           \
+        if (!(condicao)) {                                                                         \
+            fprintf(stderr, "%s:%d: falhou: %s\n", __FILE__, __LINE__, #condicao);                 \
+            falhasTeste++;                                                                         \
+        }                                                                                          \
+    } while (0)
+
+const uint32_t CUSTO_VOLTA_US = 10;         // Fora do loop(): yield do Arduino e tarefa ociosa
+const char TOKEN_TESTE[] = "token-de-teste-do-host"; // Como se tivesse sido configurado no firmware
+
+struct Execucao {                           // Medidas de uma sequência de voltas do loop()
+    uint64_t voltas = 0;
+    uint64_t voltaMaxUs = 0;                // Maior volta, incluindo timers e ISRs que a interromperam
+    uint64_t instanteVoltaMaxUs = 0;
+};
+
+/**
+ * @brief Roda o setup() do firmware com o servidor numa porta livre e o token de teste.
+ */
+void iniciarFirmware() {
+    portaHttp = 0;                          // O sistema escolhe (vários testes podem rodar juntos)
+    tokenAdministrador = TOKEN_TESTE;
+    setup();
+}
+
+/**
+ * @brief Porta em que o servidor HTTP do firmware está escutando.
+ */
+uint16_t portaServidor() {
+    sockaddr_in endereco = {};
+    socklen_t tamanho = sizeof(endereco);
+    getsockname(soqueteServidor, (sockaddr *)&endereco, &tamanho);
+    return ntohs(endereco.sin_port);
+}
+
+/**
+ * @brief Executa o loop() até o relógio virtual andar 'ms', acumulando as medidas em 'execucao'.
+ */
+void executarPor(uint64_t ms, Execucao &execucao) {
+    uint64_t fim = sim::agoraUs() + ms * 1000;
+    while (sim::agoraUs() < fim) {
+        uint64_t inicio = sim::agoraUs();
+        loop();
+        uint64_t duracao = sim::agoraUs() - inicio;
+        if (duracao > execucao.voltaMaxUs) {
+            execucao.voltaMaxUs = duracao;
+            execucao.instanteVoltaMaxUs = inicio;
+        }
+        execucao.voltas++;
+        sim::cobrar(CUSTO_VOLTA_US);
+    }
+}
+
+int pinoSaidaPorNome(const std::string &nome) {
+    if (nome == "luz") return PINO_LUZ;
+    if (nome == "ventoinha") return PINO_VENTOINHA_MANUAL;
+    if (nome == "ventoinha_auto") return PINO_VENTOINHA_AUTO;
+    return -1;
+}
+
+byte pinoLeitorPorNome(const std::string &nome) {
+    return nome == "saida" ? PINO_RFID_SS_SAIDA : PINO_RFID_SS_ENTRADA;
+}
+
+/**
+ * @brief Executa um comando do cenário; devolve false (e explica) se uma verificação falhar.
+ */
+bool executarComandoCenario(const std::string &linha, int numero) {
+    std::istringstream entrada(linha);
+    unsigned long instanteMs;
+    std::string comando, alvo;
+    entrada >> instanteMs >> comando;
+    if (comando == "distancia") {
+        unsigned cm;
+        entrada >> cm;
+        sim::definirDistancia(cm);
+    } else if (comando == "dht") {
+        float umidade, temperatura;
+        entrada >> umidade >> temperatura;
+        sim::definirDht(umidade, temperatura);
+    } else if (comando == "cartao") {
+        std::string hex, opcao;
+        entrada >> alvo >> hex >> opcao;
+        uint8_t uid[10];
+        uint8_t tamanho = 0;
+        for (size_t i = 0; i + 1 < hex.size() && tamanho < sizeof(uid); i += 2) {
+            uid[tamanho++] = (uint8_t)strtoul(hex.substr(i, 2).c_str(), nullptr, 16);
+        }
+        sim::apresentarCartao(pinoLeitorPorNome(alvo), uid, tamanho, opcao == "ignora-halt");
+    } else if (comando == "retira") {
+        entrada >> alvo;
+        sim::retirarCartao(pinoLeitorPorNome(alvo));
+    } else if (comando == "comando") {
+        std::string valor;
+        entrada >> alvo >> valor;
+        Comando cmd = {alvo == "luz" ? CMD_LUZ : CMD_VENTILACAO, valor == "on"};
+        enfileirarComando(cmd);
+    } else if (comando == "verifica") {
+        long esperado, obtido;
+        entrada >> alvo >> esperado;
+        if (alvo == "porta") obtido = portaAberta;
+        else if (alvo == "servo") obtido = sim::pulsoServoUs();
+        else obtido = sim::nivelPino(pinoSaidaPorNome(alvo));
+        if (obtido != esperado) {
+            fprintf(stderr, "cenario:%d: %s = %ld, esperado %ld\n", numero, alvo.c_str(), obtido, esperado);
+            return false;
+        }
+    } else if (comando == "lcd" || comando == "serial") {
+        int indice = 0;
+        if (comando == "lcd") entrada >> indice;
+        std::string texto;
+        std::getline(entrada >> std::ws, texto);
+        std::string atual = comando == "lcd" ? sim::linhaLcd(indice) : sim::saidaSerial();
+        bool ok = comando == "lcd" ? atual.compare(0, texto.size(), texto) == 0 : atual.find(texto) != std::string::npos;
+        if (!ok) {
+            fprintf(stderr, "cenario:%d: %s sem \"%s\" (atual: \"%s\")\n", numero, comando.c_str(), texto.c_str(),
+                    comando == "lcd" ? atual.c_str() : "...");
+            return false;
+        }
+    } else {
+        fprintf(stderr, "cenario:%d: comando desconhecido '%s'\n", numero, comando.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Roda o loop() seguindo um cenário; cada falha de verificação conta em 'falhasTeste'.
+ */
+void executarCenario(const char *caminho, Execucao &execucao) {
+    std::ifstream arquivo(caminho);
+    if (!arquivo) {
+        fprintf(stderr, "Cenario '%s' nao encontrado.\n", caminho);
+        falhasTeste++;
+        return;
+    }
+    uint64_t inicioMs = sim::agoraUs() / 1000;
+    std::string linha;
+    int numero = 0;
+    while (std::getline(arquivo, linha)) {
+        numero++;
+        size_t inicio = linha.find_first_not_of(" \t");
+        if (inicio == std::string::npos || linha[inicio] == '#') continue;
+        uint64_t instanteMs = inicioMs + strtoull(linha.c_str() + inicio, nullptr, 10);
+        uint64_t agoraMs = sim::agoraUs() / 1000;
+        if (instanteMs > agoraMs) executarPor(instanteMs - agoraMs, execucao);
+        if (!executarComandoCenario(linha.substr(inicio), numero)) falhasTeste++;
+    }
+}
+
+uint64_t passoRedeMaxUs = 0;                // Maior passoRede() feito por requisicaoHttp()
+
+/**
+ * @brief Faz uma requisição HTTP ao firmware no relógio virtual.
+ * @details Cliente, tarefa de rede (passoRede) e loop() se alternam na mesma thread, 1 ms de
+ * relógio virtual por rodada, até o servidor fechar a conexão.
+ * @param cabecalhos Linhas extras, cada uma terminada em "\r\n".
+ * @return Resposta inteira (status, cabeçalhos e corpo); vazia se não houve resposta.
+ */
+std::string requisicaoHttp(const std::string &metodo, const std::string &caminho, const std::string &corpo = "",
+                           const std::string &cabecalhos = "", uint64_t tempoLimiteMs = 5000) {
+    int soquete = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in endereco = {};
+    endereco.sin_family = AF_INET;
+    endereco.sin_port = htons(portaServidor());
+    endereco.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(soquete, (sockaddr *)&endereco, sizeof(endereco)) != 0) {
+        close(soquete);
+        return "";
+    }
+    fcntl(soquete, F_SETFL, O_NONBLOCK);
+    std::string pedido = metodo + " " + caminho + " HTTP/1.1\r\nHost: sala\r\n" + cabecalhos;
+    if (!corpo.empty()) pedido += "Content-Length: " + std::to_string(corpo.size()) + "\r\n";
+    pedido += "\r\n" + corpo;
+
+    std::string resposta;
+    size_t enviados = 0;
+    Execucao execucao;
+    uint64_t fim = sim::agoraUs() + tempoLimiteMs * 1000;
+    while (sim::agoraUs() < fim) {
+        if (enviados < pedido.size()) {
+            ssize_t n = send(soquete, pedido.data() + enviados, pedido.size() - enviados, MSG_NOSIGNAL);
+            if (n > 0) enviados += n;
+        }
+        uint64_t inicioPassoUs = sim::agoraUs();
+        passoRede(0);
+        if (sim::agoraUs() - inicioPassoUs > passoRedeMaxUs) passoRedeMaxUs = sim::agoraUs() - inicioPassoUs;
+        executarPor(1, execucao);
+        char bloco[2048];
+        ssize_t n = recv(soquete, bloco, sizeof(bloco), 0);
+        if (n > 0) resposta.append(bloco, n);
+        else if (n == 0) break;
+    }
+    close(soquete);
+    return resposta;
+}
+
+/**
+ * @brief Código de status de uma resposta de requisicaoHttp() (0 = sem resposta).
+ */
+int statusHttp(const std::string &resposta) {
+    return resposta.size() > 12 ? atoi(resposta.c_str() + 9) : 0;
+}
+
+/**
+ * @brief Corpo de uma resposta de requisicaoHttp().
+ */
+std::string corpoHttp(const std::string &resposta) {
+    size_t inicio = resposta.find("\r\n\r\n");
+    return inicio == std::string::npos ? "" : resposta.substr(inicio + 4);
+}
+
+/**
+ * @brief Segundos de relógio de parede desde 'inicio' (velocidade do simulador).
+ */
+double segundosDesde(std::chrono::steady_clock::time_point inicio) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+}
+
+/**
+ * @brief Resultado do processo de teste (0 = todas as verificações passaram).
+ */
+int concluirTeste(const char *nome) {
+    if (falhasTeste == 0) printf("%s: ok\n", nome);
+    else printf("%s: %d falha(s)\n", nome, falhasTeste);
+    return falhasTeste == 0 ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+/**
+ * @file teste_alocacoes.cpp
+ * @brief Alocações de heap e tempo de atendimento das páginas servidas pela tarefa de rede.
+ * @details malloc/calloc/realloc são substituídos por versões que contam as chamadas enquanto
+ * 'contandoAlocacoes' está ligado, e o operator new da libstdc++ passa por eles. Só as
+ * voltas da tarefa de rede (passoRede) entram na conta; o cliente usa buffers fixos. A página
+ * clássica é medida renderizada (ETag nova a cada pedido) e servida do cache.
+ */
+#include "main.cpp"
+#include "apoio.h"
+
+#include <algorithm>
+#include <vector>
+
+extern "C" void *__libc_malloc(size_t tamanho);
+extern "C" void *__libc_calloc(size_t quantidade, size_t tamanho);
+extern "C" void *__libc_realloc(void *ponteiro, size_t tamanho);
+
+bool contandoAlocacoes = false;
+uint32_t alocacoes = 0;
+
+extern "C" void *malloc(size_t tamanho) {
+    if (contandoAlocacoes) alocacoes++;
+    return __libc_malloc(tamanho);
+}
+
+extern "C" void *calloc(size_t quantidade, size_t tamanho) {
+    if (contandoAlocacoes) alocacoes++;
+    return __libc_calloc(quantidade, tamanho);
+}
+
+extern "C" void *realloc(void *ponteiro, size_t tamanho) {
+    if (contandoAlocacoes) alocacoes++;
+    return __libc_realloc(ponteiro, tamanho);
+}
+
+const int PEDIDOS = 200;
+
+struct Atendimento {                        // Medidas de um pedido, só do lado do servidor
+    int status;
+    uint32_t alocacoes;
+    double servidorUs;                      // Tempo de parede dentro de passoRede()
+};
+
+/**
+ * @brief GET 'caminho' com buffers fixos; conta as alocações e o tempo só dentro de passoRede().
+ */
+Atendimento atender(const char *caminho) {
+    static char pedido[128];
+    static char resposta[8192];
+    Atendimento a = {0, 0, 0};
+    int soquete = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in endereco = {};
+    endereco.sin_family = AF_INET;
+    endereco.sin_port = htons(portaServidor());
+    endereco.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(soquete, (sockaddr *)&endereco, sizeof(endereco)) != 0) {
+        close(soquete);
+        return a;
+    }
+    fcntl(soquete, F_SETFL, O_NONBLOCK);
+    int tamanhoPedido = snprintf(pedido, sizeof(pedido), "GET %s HTTP/1.1\r\nHost: sala\r\n\r\n", caminho);
+    send(soquete, pedido, tamanhoPedido, MSG_NOSIGNAL);
+    size_t recebidos = 0;
+    Execucao execucao;
+    uint64_t fim = sim::agoraUs() + 5000000;
+    while (sim::agoraUs() < fim) {
+        uint32_t antes = alocacoes;
+        auto inicio = std::chrono::steady_clock::now();
+        contandoAlocacoes = true;
+        passoRede(0);
+        contandoAlocacoes = false;
+        a.servidorUs += segundosDesde(inicio) * 1e6;
+        a.alocacoes += alocacoes - antes;
+        executarPor(1, execucao);
+        ssize_t n = recv(soquete, resposta + recebidos, sizeof(resposta) - 1 - recebidos, 0);
+        if (n > 0) recebidos += n;
+        else if (n == 0) break;
+    }
+    close(soquete);
+    resposta[recebidos] = '\0';
+    a.status = recebidos > 12 ? atoi(resposta + 9) : 0;
+    return a;
+}
+
+/**
+ * @brief Atende 'PEDIDOS' vezes e imprime alocações e a mediana do tempo do servidor.
+ * @param renderizar Muda a ETag antes de cada pedido, forçando a página a ser montada de novo.
+ * @return Total de alocações nos pedidos.
+ */
+uint32_t medir(const char *caminho, bool renderizar) {
+    uint32_t total = 0;
+    std::vector<double> tempos;
+    for (int i = 0; i < PEDIDOS; i++) {
+        if (renderizar) geracaoMensagem++;
+        Atendimento a = atender(caminho);
+        VERIFICAR(a.status == 200);
+        total += a.alocacoes;
+        tempos.push_back(a.servidorUs);
+    }
+    std::sort(tempos.begin(), tempos.end());
+    printf("%-10s %-10s %u alocacoes em %d pedidos, servidor p50 %.1f us, max %.1f us\n", caminho,
+           renderizar ? "renderiza" : "cache", total, PEDIDOS, tempos[PEDIDOS / 2], tempos.back());
+    return total;
+}
+
+int main() {
+    contandoAlocacoes = true;                   // A contagem enxerga o operator new
+    std::string *controle = new std::string(64, 'x');
+    contandoAlocacoes = false;
+    delete controle;
+    VERIFICAR(alocacoes == 2);
+    alocacoes = 0;
+
+    iniciarFirmware();
+    Execucao execucao;
+    sim::definirDistancia(12);
+    executarPor(6000, execucao);
+    atender("/classico");                       // Primeira volta: aquece o pool e os estáticos
+    atender("/api/state");
+
+    VERIFICAR(medir("/", false) == 0);
+    VERIFICAR(medir("/classico", true) == 0);
+    VERIFICAR(medir("/classico", false) == 0);
+    VERIFICAR(medir("/api/state", true) == 0);
+    VERIFICAR(respostasRenderizadas >= PEDIDOS);
+    VERIFICAR(respostasDoCache >= PEDIDOS);
+    return concluirTeste("teste_alocacoes");
+}
@@ -0,0 +1,70 @@
+/**
+ * @file teste_bloom.cpp
+ * @brief Taxa de falsos positivos do filtro de Bloom contra a teoria, e os contadores no /metrics.
+ * @details Com m = BITS_BLOOM (32768) bits, k = HASHES_BLOOM (4) hashes e n usuários
+ * carregados, um UID desconhecido passa no filtro com probabilidade (1 - e^(-kn/m))^k: ~2,4%
+ * na capacidade (4096) e ~0,02% com 1000. As tabelas entram pela importação de CSV, então o
+ * filtro medido é o que o controle refaz ao mapear a tabela nova; as consultas passam por
+ * buscarUsuario(), como as do RFID.
+ */
+#include "main.cpp"
+#include "apoio.h"
+
+#include <cmath>
+
+const uint32_t CONSULTAS = 200000;          // UIDs desconhecidos por tamanho de tabela
+
+std::string gerarCsv(uint32_t linhas) {
+    std::string csv = "uid_hex,nome,horario\n";
+    char linha[48];
+    for (uint32_t i = 0; i < linhas; i++) {
+        snprintf(linha, sizeof(linha), "%08X,Usuario %u,0\n", 0x10000000u + i * 2654435761u % 0x0FFFFFFF, i);
+        csv += linha;
+    }
+    return csv;
+}
+
+/**
+ * @brief GET /metrics e o valor de uma série sem rótulos (-1 se ausente).
+ */
+double metrica(const char *nome) {
+    std::string corpo = corpoHttp(requisicaoHttp("GET", "/metrics"));
+    size_t p = corpo.find(std::string("\n") + nome + " ");
+    return p == std::string::npos ? -1 : atof(corpo.c_str() + p + strlen(nome) + 2);
+}
+
+int main() {
+    iniciarFirmware();
+    Execucao execucao;
+    executarPor(100, execucao);
+    std::string autorizacao = std::string("Authorization: Bearer ") + tokenAdministrador + "\r\n";
+
+    for (uint32_t usuarios : {1000u, CAPACIDADE_USUARIOS_FLASH}) {
+        VERIFICAR(statusHttp(requisicaoHttp("POST", "/usuarios/importar", gerarCsv(usuarios), autorizacao, 60000)) ==
+                  200);
+        executarPor(10, execucao);               // O controle mapeia a tabela e refaz o filtro
+        VERIFICAR(cabecalhoAtivo.quantidade == usuarios);
+
+        unsigned long consultas = consultasBloom, rejeitados = rejeitadosBloom, falsos = falsosPositivosBloom;
+        byte horario;
+        for (uint32_t i = 0; i < CONSULTAS; i++) {
+            byte uid[4] = {0x20, (byte)(i >> 16), (byte)(i >> 8), (byte)i}; // Fora da faixa do CSV
+            VERIFICAR(buscarUsuario(criarChaveUID(uid, 4), horario) == nullptr);
+        }
+        unsigned long falsosAgora = falsosPositivosBloom - falsos;
+        double medida = (double)falsosAgora / CONSULTAS;
+        double teoria = pow(1 - exp(-(double)HASHES_BLOOM * usuarios / BITS_BLOOM), HASHES_BLOOM);
+        double desvio = sqrt(teoria * (1 - teoria) / CONSULTAS); // Binomial
+        printf("%4u usuarios: %lu falsos positivos em %u (%.3f%%), teoria %.3f%%\n", usuarios, falsosAgora, CONSULTAS,
+               100 * medida, 100 * teoria);
+        VERIFICAR(consultasBloom - consultas == CONSULTAS);
+        VERIFICAR(rejeitadosBloom - rejeitados + falsosAgora == CONSULTAS);
+        VERIFICAR(fabs(medida - teoria) < 0.15 * teoria + 4 * desvio);
+    }
+
+    // Os três contadores saem no /metrics com os valores do controle
+    VERIFICAR(metrica("sala_bloom_consultas_total") == consultasBloom);
+    VERIFICAR(metrica("sala_bloom_rejeitados_total") == rejeitadosBloom);
+    VERIFICAR(metrica("sala_bloom_falsos_positivos_total") == falsosPositivosBloom);
+    return concluirTeste("teste_bloom");
+}
@@ -0,0 +1,106 @@
+/**
+ * @file teste_busca_uid.cpp
+ * @brief Busca de UID pelo índice hash comparada ao laço linear antigo, com 10, 1k e 50k usuários.
+ * @details Monta na memória uma imagem no formato da partição "usuarios" e a põe no lugar da
+ * mapeada, então a busca medida é a do firmware (buscarUsuarioFlash). O laço linear é o que
+ * havia antes do índice: memcmp do UID lido contra cada usuário, na ordem da lista.
+ */
+#include "main.cpp"
+#include "apoio.h"
+
+#include <vector>
+
+const int TAMANHOS[] = {10, 1000, 50000};
+const int CONSULTAS = 2000;                 // Metade cadastrados, metade desconhecidos
+
+volatile uintptr_t sumidouro;               // Impede o compilador de descartar as buscas
+
+/**
+ * @brief UID de 7 bytes (NTAG) distinto para cada 'n'; 'desconhecido' troca o prefixo.
+ */
+ChaveUID chaveSintetica(uint32_t n, bool desconhecido) {
+    byte uid[7] = {desconhecido ? (byte)0x88 : (byte)0x04, (byte)n, (byte)(n >> 8), (byte)(n >> 16), 0x5A, 0x3C, 0x81};
+    return criarChaveUID(uid, sizeof(uid));
+}
+
+/**
+ * @brief Imagem da tabela (cabeçalho, índice, registros) com 'quantidade' usuários.
+ */
+std::vector<uint8_t> montarImagem(int quantidade) {
+    uint32_t capacidade = potenciaDeDois(2 * quantidade);
+    std::vector<uint8_t> imagem(sizeof(CabecalhoTabela) + capacidade * sizeof(uint16_t) +
+                                quantidade * sizeof(RegistroUsuario));
+    CabecalhoTabela *cabecalho = (CabecalhoTabela *)imagem.data();
+    cabecalho->magico = MAGICO_TABELA_USUARIOS;
+    cabecalho->quantidade = quantidade;
+    cabecalho->capacidadeIndice = capacidade;
+    uint16_t *indice = (uint16_t *)(cabecalho + 1);
+    RegistroUsuario *registros = (RegistroUsuario *)(indice + capacidade);
+    for (uint32_t i = 0; i < capacidade; i++) indice[i] = POSICAO_LIVRE_FLASH;
+    for (int i = 0; i < quantidade; i++) {
+        registros[i].chave = chaveSintetica(i, false);
+        registros[i].horario = HORARIO_SEMPRE;
+        snprintf(registros[i].nome, sizeof(registros[i].nome), "Usuario %d", i);
+        uint32_t pos = hashChave(registros[i].chave) & (capacidade - 1);
+        while (indice[pos] != POSICAO_LIVRE_FLASH) pos = (pos + 1) & (capacidade - 1);
+        indice[pos] = i;
+    }
+    return imagem;
+}
+
+/**
+ * @brief O laço de antes do índice: percorre todos os registros até o UID bater.
+ */
+const RegistroUsuario *buscarLinear(const RegistroUsuario *registros, int quantidade, const ChaveUID &chave) {
+    for (int i = 0; i < quantidade; i++) {
+        if (memcmp(chave.uid.bytes, registros[i].chave.uid.bytes, chave.uid.tamanho) == 0) return &registros[i];
+    }
+    return nullptr;
+}
+
+int main() {
+    std::vector<ChaveUID> consultas(CONSULTAS);
+    double razaoMaior = 0;
+    for (int quantidade : TAMANHOS) {
+        std::vector<uint8_t> imagem = montarImagem(quantidade);
+        imagemUsuarios = imagem.data();
+        cabecalhoAtivo = *(const CabecalhoTabela *)imagem.data();
+        const RegistroUsuario *registros = (const RegistroUsuario *)(imagemUsuarios + sizeof(CabecalhoTabela) +
+                                                                     cabecalhoAtivo.capacidadeIndice * sizeof(uint16_t));
+        for (int i = 0; i < CONSULTAS; i++) {
+            uint32_t n = (uint32_t)i * 7919 % quantidade; // Espalha as consultas pela lista inteira
+            consultas[i] = chaveSintetica(n, i % 2 == 1);
+        }
+
+        // As duas buscas concordam em todas as consultas
+        int encontrados = 0;
+        for (const ChaveUID &chave : consultas) {
+            const RegistroUsuario *r = buscarUsuarioFlash(chave);
+            VERIFICAR(r == buscarLinear(registros, quantidade, chave));
+            encontrados += r != nullptr;
+        }
+        VERIFICAR(encontrados == CONSULTAS / 2);
+
+        int repeticoes = quantidade >= 50000 ? 1 : quantidade >= 1000 ? 10 : 1000;
+        uintptr_t soma = 0;
+        auto inicio = std::chrono::steady_clock::now();
+        for (int r = 0; r < repeticoes; r++) {
+            for (const ChaveUID &chave : consultas) soma += (uintptr_t)buscarLinear(registros, quantidade, chave);
+        }
+        double linearNs = segundosDesde(inicio) * 1e9 / (repeticoes * CONSULTAS);
+        int repeticoesHash = 1000;
+        inicio = std::chrono::steady_clock::now();
+        for (int r = 0; r < repeticoesHash; r++) {
+            for (const ChaveUID &chave : consultas) soma += (uintptr_t)buscarUsuarioFlash(chave);
+        }
+        double hashNs = segundosDesde(inicio) * 1e9 / (repeticoesHash * CONSULTAS);
+        printf("%6d usuarios: linear %10.1f ns/busca, indice %6.1f ns/busca (%.0fx)\n", quantidade, linearNs,
+               hashNs, linearNs / hashNs);
+        sumidouro = soma;
+        if (quantidade >= 1000) VERIFICAR(hashNs * 10 < linearNs);
+        if (linearNs / hashNs > razaoMaior) razaoMaior = linearNs / hashNs;
+    }
+    imagemUsuarios = nullptr;
+    VERIFICAR(razaoMaior > 100);                // 50k usuários: o laço linear fica milhares de vezes mais lento
+    return concluirTeste("teste_busca_uid");
+}
@@ -0,0 +1,108 @@
+/**
+ * @file teste_cache_http.cpp
+ * @brief ETag, 304 e invalidação do cache da página clássica e do JSON de /api/state.
+ * @details A ETag é "boot.versaoEstado.geracaoMensagem": uma mudança do estado publicado ou
+ * uma mensagem do sistema nova (ou expirada) tem que gerar outra ETag e outra renderização;
+ * sem mudança, o If-None-Match da versão atual recebe 304 sem corpo.
+ */
+#include "main.cpp"
+#include "apoio.h"
+
+/**
+ * @brief Valor do cabeçalho ETag de uma resposta ("" se não houver).
+ */
+std::string etagDe(const std::string &resposta) {
+    size_t inicio = resposta.find("\r\nETag: ");
+    if (inicio == std::string::npos) return "";
+    inicio += 8;
+    return resposta.substr(inicio, resposta.find("\r\n", inicio) - inicio);
+}
+
+/**
+ * @brief GET com If-None-Match (ou sem, se 'etag' estiver vazia).
+ */
+std::string pedirCom(const char *caminho, const std::string &etag) {
+    return requisicaoHttp("GET", caminho, "", etag.empty() ? "" : "If-None-Match: " + etag + "\r\n");
+}
+
+/**
+ * @brief Deixa o último instantâneo do controle chegar à web (a fila de estados enche em executarPor()).
+ */
+void sincronizarWeb(Execucao &execucao) {
+    passoRede(0);
+    executarPor(60, execucao);
+    passoRede(0);
+}
+
+int main() {
+    iniciarFirmware();
+    Execucao execucao;
+    sim::definirDistancia(150);
+    executarPor(2000, execucao);
+    sincronizarWeb(execucao);
+
+    // Primeira página: renderizada; a mesma versão sai do cache, ou 304 com a ETag certa
+    unsigned long renderizadas = respostasRenderizadas;
+    std::string resposta = pedirCom("/classico", "");
+    VERIFICAR(statusHttp(resposta) == 200);
+    std::string etag = etagDe(resposta);
+    VERIFICAR(etag.size() > 2 && etag.front() == '"' && etag.back() == '"');
+    VERIFICAR(resposta.find("Cache-Control: no-cache\r\n") != std::string::npos);
+    VERIFICAR(respostasRenderizadas == renderizadas + 1);
+    unsigned long doCache = respostasDoCache;
+    VERIFICAR(etagDe(pedirCom("/classico", "")) == etag);
+    VERIFICAR(respostasDoCache == doCache + 1);
+    unsigned long naoModificadas = respostasNaoModificadas;
+    resposta = pedirCom("/classico", etag);
+    VERIFICAR(statusHttp(resposta) == 304);
+    VERIFICAR(corpoHttp(resposta).empty());
+    VERIFICAR(etagDe(resposta) == etag);
+    VERIFICAR(statusHttp(pedirCom("/api/state", etag)) == 304); // Mesma versão, mesma ETag
+    VERIFICAR(respostasNaoModificadas == naoModificadas + 2);
+    VERIFICAR(statusHttp(pedirCom("/classico", "\"outra\"")) == 200);
+
+    // Estado publicado mudou (alguém entrou): a ETag antiga não vale mais
+    sim::definirDistancia(12);
+    executarPor(6000, execucao);
+    sincronizarWeb(execucao);
+    renderizadas = respostasRenderizadas;
+    resposta = pedirCom("/classico", etag);
+    VERIFICAR(statusHttp(resposta) == 200);
+    VERIFICAR(resposta.find("OCUPADA") != std::string::npos);
+    std::string etagOcupada = etagDe(resposta);
+    VERIFICAR(etagOcupada != etag);
+    VERIFICAR(respostasRenderizadas == renderizadas + 1);
+    resposta = pedirCom("/api/state", etag);
+    VERIFICAR(statusHttp(resposta) == 200);
+    VERIFICAR(etagDe(resposta) == etagOcupada);
+
+    // Luz recusada com a sala vazia: mensagem nova, outra ETag
+    Comando luz = {CMD_LUZ, true};
+    sim::definirDistancia(150);                 // Sala vazia de novo, depois a luz é recusada
+    executarPor(6000, execucao);
+    sincronizarWeb(execucao);
+    std::string etagVazia = etagDe(pedirCom("/classico", ""));
+    enfileirarComando(luz);
+    executarPor(100, execucao);
+    sincronizarWeb(execucao);
+    resposta = pedirCom("/classico", etagVazia);
+    VERIFICAR(statusHttp(resposta) == 200);
+    VERIFICAR(resposta.find("class='msg'") != std::string::npos);
+    std::string etagMensagem = etagDe(resposta);
+    VERIFICAR(etagMensagem != etagVazia);
+    VERIFICAR(statusHttp(pedirCom("/classico", etagMensagem)) == 304);
+
+    // A mensagem expira com o mesmo estado: só a geração da mensagem muda, e a página também
+    uint32_t versao = estadoWeb.versao;
+    for (unsigned long ms = 0; ms <= validadeMensagemMs + 100; ms += 100) {
+        executarPor(100, execucao);
+        passoRede(0);
+    }
+    VERIFICAR(estadoWeb.versao == versao);
+    resposta = pedirCom("/classico", etagMensagem);
+    VERIFICAR(statusHttp(resposta) == 200);
+    VERIFICAR(resposta.find("class='msg'") == std::string::npos);
+    VERIFICAR(etagDe(resposta) != etagMensagem);
+    printf("ETags: %s %s %s %s\n", etag.c_str(), etagOcupada.c_str(), etagMensagem.c_str(), etagDe(resposta).c_str());
+    return concluirTeste("teste_cache_http");
+}
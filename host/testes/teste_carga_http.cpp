@@ -0,0 +1,132 @@
+/**
+ * @file teste_carga_http.cpp
+ * @brief Carga no servidor HTTP no relógio real: clientes simultâneos, requisições/s e p99.
+ * @details O loop() roda na thread principal e a tarefa de rede numa thread própria, como
+ * nos dois núcleos do ESP32; cada cliente é uma thread com sockets bloqueantes. Toda
+ * resposta tem de chegar inteira (corpo = Content-Length) e nenhum POST /api/commands pode
+ * levar 504: o tempo limite por conexão expirava conexões que o handler tinha acabado de
+ * atualizar, quando millis() avançava entre a leitura do relógio e o handler.
+ */
+#include "main.cpp"
+#include "apoio.h"
+
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+const int CLIENTES = 12;                    // Mais que MAX_CONEXOES: parte espera no backlog
+const int DURACAO_MS = 3000;
+const double LIMITE_P99_MS = 250;           // Folgado: o host de CI pode ter um só núcleo
+
+struct Pedido {
+    const char *texto;
+    int status;
+    bool podeRecusar;                       // 503 é válido: fila do controle cheia ou /metrics ainda enviando
+};
+
+const Pedido PEDIDOS[] = {
+    {"GET /api/state HTTP/1.1\r\nHost: sala\r\n\r\n", 200},
+    {"GET / HTTP/1.1\r\nHost: sala\r\n\r\n", 200},
+    {"GET /luz/on HTTP/1.1\r\nHost: sala\r\n\r\n", 302, true},
+    {"POST /api/commands HTTP/1.1\r\nHost: sala\r\nContent-Length: 22\r\n\r\nluz=off,ventilacao=off", 200, true},
+    {"GET /metrics HTTP/1.1\r\nHost: sala\r\n\r\n", 200, true},
+    {"GET /classico HTTP/1.1\r\nHost: sala\r\n\r\n", 200},
+};
+
+std::atomic<bool> parar{false};
+std::atomic<int> clientesAtivos{CLIENTES};
+std::mutex travaResultados;
+std::vector<double> latenciasMs;
+int falhas = 0;
+int recusadas = 0;                          // Respostas 503 válidas (contadas à parte)
+
+/**
+ * @brief Uma requisição com socket bloqueante; devolve a resposta inteira (até o servidor fechar).
+ */
+std::string enviarBloqueante(uint16_t porta, const char *pedido) {
+    int soquete = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in endereco = {};
+    endereco.sin_family = AF_INET;
+    endereco.sin_port = htons(porta);
+    endereco.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    timeval limite = {5, 0};
+    setsockopt(soquete, SOL_SOCKET, SO_RCVTIMEO, &limite, sizeof(limite));
+    std::string resposta;
+    if (connect(soquete, (sockaddr *)&endereco, sizeof(endereco)) == 0 &&
+        send(soquete, pedido, strlen(pedido), MSG_NOSIGNAL) == (ssize_t)strlen(pedido)) {
+        char bloco[4096];
+        ssize_t n;
+        while ((n = recv(soquete, bloco, sizeof(bloco), 0)) > 0) resposta.append(bloco, n);
+    }
+    close(soquete);
+    return resposta;
+}
+
+/**
+ * @brief Resposta completa: status esperado e corpo do tamanho do Content-Length.
+ */
+bool respostaCompleta(const std::string &resposta, int status) {
+    size_t campo = resposta.find("Content-Length: ");
+    size_t corpo = resposta.find("\r\n\r\n");
+    if (statusHttp(resposta) != status || campo == std::string::npos || corpo == std::string::npos) return false;
+    return resposta.size() - corpo - 4 == strtoul(resposta.c_str() + campo + 16, nullptr, 10);
+}
+
+void cliente(int indice, uint16_t porta) {
+    std::vector<double> minhas;
+    int minhasFalhas = 0, minhasRecusadas = 0;
+    for (int i = indice; !parar.load(); i++) {
+        const Pedido &p = PEDIDOS[i % (sizeof(PEDIDOS) / sizeof(PEDIDOS[0]))];
+        auto inicio = std::chrono::steady_clock::now();
+        std::string resposta = enviarBloqueante(porta, p.texto);
+        minhas.push_back(segundosDesde(inicio) * 1000);
+        if (p.podeRecusar && respostaCompleta(resposta, 503)) {
+            minhasRecusadas++;
+        } else if (!respostaCompleta(resposta, p.status)) {
+            if (minhasFalhas++ == 0) fprintf(stderr, "cliente %d: \"%.60s\" -> \"%.80s\"\n", indice, p.texto, resposta.c_str());
+        }
+    }
+    std::lock_guard<std::mutex> trava(travaResultados);
+    latenciasMs.insert(latenciasMs.end(), minhas.begin(), minhas.end());
+    falhas += minhasFalhas;
+    recusadas += minhasRecusadas;
+    clientesAtivos--;
+}
+
+int main() {
+    iniciarFirmware();
+    Execucao execucao;
+    executarPor(100, execucao);
+    uint16_t porta = portaServidor();
+    sim::usarRelogioReal();
+
+    std::thread rede([] {
+        while (clientesAtivos.load() > 0) passoRede(10);
+    });
+    std::vector<std::thread> clientes;
+    auto inicio = std::chrono::steady_clock::now();
+    for (int i = 0; i < CLIENTES; i++) clientes.emplace_back(cliente, i, porta);
+    while (clientesAtivos.load() > 0) {         // O controle segue até o último lote ser respondido
+        if (segundosDesde(inicio) * 1000 >= DURACAO_MS) parar.store(true);
+        loop();
+        std::this_thread::yield();              // Host com um só núcleo: deixa a rede e os clientes andarem
+    }
+    double segundos = segundosDesde(inicio);
+    for (std::thread &t : clientes) t.join();
+    rede.join();
+    sim::pararRelogioReal();
+
+    std::sort(latenciasMs.begin(), latenciasMs.end());
+    size_t total = latenciasMs.size();
+    double p50 = total ? latenciasMs[total / 2] : 0, p99 = total ? latenciasMs[total * 99 / 100] : 0;
+    printf("%d clientes, %zu requisicoes em %.2f s: %.0f req/s, p50 %.2f ms, p99 %.2f ms, max %.2f ms\n", CLIENTES,
+           total, segundos, total / segundos, p50, p99, total ? latenciasMs.back() : 0);
+    printf("falhas %d, recusadas (503) %d, conexoes expiradas %u\n", falhas, recusadas,
+           (unsigned)conexoesExpiradas);
+    VERIFICAR(total > 0);
+    VERIFICAR(falhas == 0);
+    VERIFICAR(conexoesExpiradas == 0);
+    VERIFICAR(p99 < LIMITE_P99_MS);
+    return concluirTeste("teste_carga_http");
+}
@@ -0,0 +1,77 @@
+/**
+ * @file teste_comandos.cpp
+ * @brief POST /api/commands: lote aplicado, lote recusado e controle sem resposta.
+ * @details Com o controle parado o servidor responde 504 depois de 'tempoLimiteConexaoMs',
+ * mas o lote continua na fila e é aplicado quando o controle volta; a resposta não pode
+ * dizer que nada foi alterado.
+ */
+#include "main.cpp"
+#include "apoio.h"
+
+/**
+ * @brief POST /api/commands com o loop() parado: só a tarefa de rede roda.
+ */
+std::string comandoSemControle(const std::string &corpo, uint64_t esperaMs) {
+    int soquete = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in endereco = {};
+    endereco.sin_family = AF_INET;
+    endereco.sin_port = htons(portaServidor());
+    endereco.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    connect(soquete, (sockaddr *)&endereco, sizeof(endereco));
+    fcntl(soquete, F_SETFL, O_NONBLOCK);
+    std::string pedido = "POST /api/commands HTTP/1.1\r\nHost: sala\r\nContent-Length: " +
+                         std::to_string(corpo.size()) + "\r\n\r\n" + corpo;
+    send(soquete, pedido.data(), pedido.size(), MSG_NOSIGNAL);
+    std::string resposta;
+    uint64_t fim = sim::agoraUs() + esperaMs * 1000;
+    while (sim::agoraUs() < fim) {
+        passoRede(0);
+        sim::avancar(1000);
+        char bloco[512];
+        ssize_t n = recv(soquete, bloco, sizeof(bloco), 0);
+        if (n > 0) resposta.append(bloco, n);
+        else if (n == 0) break;
+    }
+    close(soquete);
+    return resposta;
+}
+
+int main() {
+    iniciarFirmware();
+    Execucao execucao;
+    sim::definirDistancia(150);
+    executarPor(2000, execucao);
+
+    // Sala vazia: ligar a luz é recusado e nada muda
+    std::string resposta = requisicaoHttp("POST", "/api/commands", "luz=on");
+    VERIFICAR(statusHttp(resposta) == 409);
+    VERIFICAR(corpoHttp(resposta).find("\"aplicado\":false") != std::string::npos);
+    VERIFICAR(!iluminacaoState);
+
+    // Alguém entra; o lote é aplicado inteiro
+    sim::definirDistancia(12);
+    executarPor(3000, execucao);
+    resposta = requisicaoHttp("POST", "/api/commands", "ventilacao=on");
+    VERIFICAR(statusHttp(resposta) == 200);
+    VERIFICAR(corpoHttp(resposta).find("\"aplicado\":true") != std::string::npos);
+    VERIFICAR(ventilacaoState);
+
+    // Controle parado: 504 sem afirmar que nada foi alterado, e o lote é aplicado depois
+    resposta = comandoSemControle("ventilacao=off", tempoLimiteConexaoMs + 1000);
+    printf("Controle parado: %s\n", corpoHttp(resposta).c_str());
+    VERIFICAR(statusHttp(resposta) == 504);
+    VERIFICAR(corpoHttp(resposta).find("\"aplicado\":null") != std::string::npos);
+    VERIFICAR(ventilacaoState);
+    executarPor(100, execucao);
+    VERIFICAR(!ventilacaoState);                // O lote que estava na fila foi aplicado
+
+    // Uma fila cheia é esvaziada numa volta só do processarComandos()
+    Comando cmd = {CMD_LUZ, true};
+    int enfileirados = 0;
+    while (enfileirarComando(cmd)) enfileirados++;
+    VERIFICAR(enfileirados == (int)CAPACIDADE_FILA_COMANDOS - 1);
+    processarComandos();
+    Comando resto;
+    VERIFICAR(!filaComandos.desenfileirar(resto));
+    return concluirTeste("teste_comandos");
+}
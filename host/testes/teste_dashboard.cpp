@@ -0,0 +1,50 @@
+/**
+ * @file teste_dashboard.cpp
+ * @brief O painel comprimido em dashboard_gz.h é exatamente o dashboard.html atual.
+ * @details O cabeçalho é gerado pelo build do host, mas vai para o repositório porque a IDE do
+ * Arduino não roda o CMake: um commit só do HTML deixaria o firmware servindo a página velha.
+ * Também confere que "/" entrega esses bytes com Content-Encoding: gzip.
+ */
+#include "main.cpp"
+#include "apoio.h"
+
+#include <zlib.h>
+
+/**
+ * @brief Descomprime um arquivo gzip inteiro; vazio se os dados estiverem corrompidos.
+ */
+std::string descomprimir(const uint8_t *dados, size_t tamanho) {
+    z_stream fluxo = {};
+    if (inflateInit2(&fluxo, 16 + MAX_WBITS) != Z_OK) return "";
+    fluxo.next_in = const_cast<uint8_t *>(dados);
+    fluxo.avail_in = tamanho;
+    std::string saida;
+    char bloco[4096];
+    int resultado;
+    do {
+        fluxo.next_out = (Bytef *)bloco;
+        fluxo.avail_out = sizeof(bloco);
+        resultado = inflate(&fluxo, Z_NO_FLUSH);
+        saida.append(bloco, sizeof(bloco) - fluxo.avail_out);
+    } while (resultado == Z_OK);
+    inflateEnd(&fluxo);
+    return resultado == Z_STREAM_END && fluxo.avail_in == 0 ? saida : "";
+}
+
+int main() {
+    std::ifstream arquivo("../../src/dashboard.html", std::ios::binary);
+    VERIFICAR(arquivo.good());
+    std::stringstream html;
+    html << arquivo.rdbuf();
+    std::string painel = descomprimir(dashboardHtmlGz, dashboardHtmlGzTamanho);
+    printf("dashboard.html: %zu bytes, %zu comprimidos\n", html.str().size(), dashboardHtmlGzTamanho);
+    VERIFICAR(!painel.empty());
+    VERIFICAR(painel == html.str());
+
+    iniciarFirmware();
+    std::string resposta = requisicaoHttp("GET", "/");
+    VERIFICAR(statusHttp(resposta) == 200);
+    VERIFICAR(resposta.find("Content-Encoding: gzip\r\n") != std::string::npos);
+    VERIFICAR(corpoHttp(resposta) == std::string((const char *)dashboardHtmlGz, dashboardHtmlGzTamanho));
+    return concluirTeste("teste_dashboard");
+}
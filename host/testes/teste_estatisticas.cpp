@@ -0,0 +1,33 @@
+/**
+ * @file teste_estatisticas.cpp
+ * @brief Relatório de estatísticas no Serial sem travar o loop.
+ * @details O relatório tem ~1 KB; escrito de uma vez, o Serial bloqueante (FIFO de 128 bytes
+ * a 115200 baud) segurava a volta por ~90 ms. Agora cada execução escreve uma linha que cabe
+ * na FIFO.
+ */
+#include "main.cpp"
+#include "apoio.h"
+
+int contar(const std::string &texto, const char *trecho) {
+    int total = 0;
+    for (size_t pos = texto.find(trecho); pos != std::string::npos; pos = texto.find(trecho, pos + 1)) total++;
+    return total;
+}
+
+int main() {
+    iniciarFirmware();
+    sim::limparSerial();
+    Execucao execucao;
+    executarPor(61000, execucao);               // Relatório na primeira volta e depois de 60 s
+
+    std::string saida = sim::saidaSerial();
+    const Tarefa &t = tarefas[tarefaEstatisticas];
+    printf("Relatorio: %d linhas por vez, maior execucao %lu us\n", contar(saida, "\n") / 2, t.maximoUs);
+    VERIFICAR(contar(saida, "TAREFA        EXEC") == 2);
+    VERIFICAR(contar(saida, "RFID entrada  consultas") == 2);
+    VERIFICAR(contar(saida, "RFID saida    consulta max") == 2);
+    VERIFICAR(contar(saida, "Bloom: ") == 2);
+    VERIFICAR(t.maximoUs < 1000);
+    VERIFICAR(t.estourosOrcamento == 0);
+    return concluirTeste("teste_estatisticas");
+}
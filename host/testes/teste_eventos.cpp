@@ -0,0 +1,69 @@
+/**
+ * @file teste_eventos.cpp
+ * @brief Instante dos eventos de acesso: hora do SNTP quando houver, senão millis() e boot.
+ * @details O registro continua com 16 bytes. Um reset por software incrementa o contador de
+ * boots na RTC; ao ligar a placa ele continua do último evento gravado na flash. O controle
+ * só programa páginas: o setor em que ele vai entrar é apagado antes pela tarefa de rede.
+ */
+#include "main.cpp"
+#include "apoio.h"
+
+#include <algorithm>
+
+const EventoAcesso &ultimoEvento() {
+    return anelEventos.eventos[(anelEventos.escrita.load() - 1) % CAPACIDADE_ANEL_EVENTOS];
+}
+
+int main() {
+    iniciarFirmware();
+    Execucao execucao;
+    executarPor(100, execucao);
+    const byte uid[] = {0xDE, 0xAD, 0xBE, 0xEF};
+    ChaveUID chave = criarChaveUID(uid, 4);
+    VERIFICAR(anelEventos.boots == 0);          // Partição de eventos vazia
+
+    registrarEvento(EVENTO_NEGADO, chave);      // Sem SNTP: millis() do boot 0
+    VERIFICAR(ultimoEvento().sincronizado == 0);
+    VERIFICAR(ultimoEvento().instante == millis());
+    VERIFICAR(ultimoEvento().boot == 0);
+    VERIFICAR(ultimoEvento().tipo == EVENTO_NEGADO);
+    VERIFICAR(ultimoEvento().tamanhoUid == 4);
+
+    sim::definirHoraUtc(1760000000);
+    registrarEvento(EVENTO_ABERTURA, chave);    // Com SNTP: epoch UTC
+    VERIFICAR(ultimoEvento().sincronizado == 1);
+    VERIFICAR(ultimoEvento().instante == 1760000000);
+    VERIFICAR(ultimoEvento().tipo == EVENTO_ABERTURA);
+
+    iniciarLogEventos();                        // Reset por software: o anel na RTC continua
+    VERIFICAR(anelEventos.boots == 1);
+    VERIFICAR(anelEventos.escrita.load() == 2);
+    for (uint32_t i = 0; i < EVENTOS_POR_PAGINA; i++) registrarEvento(EVENTO_FECHAMENTO, chave);
+    VERIFICAR(ultimoEvento().boot == 1);
+    descarregarEventos();                       // Setor 0 ainda não apagado pela web: espera
+    VERIFICAR(paginasEventosGravadas == 0);
+    passoRede(0);
+    descarregarEventos();
+    VERIFICAR(paginasEventosGravadas == 1);
+
+    // O resto do setor: o controle só programa páginas, e o setor seguinte espera a web apagá-lo
+    const uint32_t paginasPorSetor = TAMANHO_SETOR_FLASH / TAMANHO_PAGINA_FLASH;
+    uint64_t maiorUs = 0;
+    for (uint32_t p = 0; p <= paginasPorSetor; p++) {
+        for (uint32_t i = 0; i < EVENTOS_POR_PAGINA; i++) registrarEvento(EVENTO_FECHAMENTO, chave);
+        uint64_t inicio = sim::agoraUs();
+        descarregarEventos();
+        maiorUs = std::max(maiorUs, sim::agoraUs() - inicio);
+    }
+    printf("%lu paginas gravadas, maior descarga %llu us\n", paginasEventosGravadas, (unsigned long long)maiorUs);
+    VERIFICAR(paginasEventosGravadas == paginasPorSetor);
+    VERIFICAR(maiorUs < 1000);                  // Nenhum apagamento (30 ms) no controle
+    passoRede(0);                               // A web apaga o setor 1
+    descarregarEventos();
+    VERIFICAR(paginasEventosGravadas == paginasPorSetor + 1);
+
+    anelEventos.magico = 0;                     // Placa desligada: a RTC perde o conteúdo
+    iniciarLogEventos();
+    VERIFICAR(anelEventos.boots == 2);          // Continua do último evento da flash
+    return concluirTeste("teste_eventos");
+}
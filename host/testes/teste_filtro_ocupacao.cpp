@@ -0,0 +1,88 @@
+/**
+ * @file teste_filtro_ocupacao.cpp
+ * @brief Filtro do ultrassônico (mediana móvel, EMA e histerese) e a ocupação que ele decide.
+ * @details Primeiro filtrarDistancia() sozinho: a janela ordenada tem de acompanhar o anel e
+ * um pico isolado não mexe na saída. Depois o firmware inteiro com um eco ruidoso que cruza
+ * DISTANCIA_PRESENCA_CM a cada poucas amostras: a ocupação troca uma vez só, e as trocas que
+ * a amostra bruta teria feito aparecem em trocasSuprimidas.
+ */
+#include "main.cpp"
+#include "apoio.h"
+
+#include <algorithm>
+#include <vector>
+
+const uint16_t RUIDO_CM[] = {15, 24, 16, 0, 18, 22, 14, 26, 17}; // Alguém a ~17 cm; 0 = eco perdido
+
+uint32_t semente = 12345;
+
+uint16_t sortear(uint16_t limite) {         // LCG: sequência fixa entre execuções
+    semente = semente * 1103515245 + 12345;
+    return (semente >> 16) % limite;
+}
+
+int main() {
+    // A janela ordenada é sempre o anel em ordem, e a mediana é o elemento do meio
+    FiltroDistancia filtro = {};
+    for (int i = 0; i < 1000; i++) {
+        filtrarDistancia(filtro, sortear(DISTANCIA_SEM_ECO_CM + 1));
+        int n = filtro.preenchidas;
+        std::vector<uint16_t> esperado(filtro.janela, filtro.janela + n);
+        std::sort(esperado.begin(), esperado.end());
+        VERIFICAR(std::equal(esperado.begin(), esperado.end(), filtro.ordenadas));
+    }
+
+    // Constante: a EMA converge para ela; um pico isolado (sem eco ou muito perto) não passa da mediana
+    filtro = {};
+    uint16_t saida = 0;
+    for (int i = 0; i < 40; i++) saida = filtrarDistancia(filtro, 150);
+    VERIFICAR(saida == 150);
+    VERIFICAR(filtrarDistancia(filtro, DISTANCIA_SEM_ECO_CM) == 150);
+    VERIFICAR(filtrarDistancia(filtro, 3) == 150);
+    for (int i = 0; i < JANELA_ULTRASSOM; i++) saida = filtrarDistancia(filtro, 150);
+    VERIFICAR(saida == 150);
+
+    // Degrau: a EMA (alfa 1/4) anda um quarto do caminho por amostra, sem passar do alvo
+    for (int i = 0; i < JANELA_ULTRASSOM / 2; i++) filtrarDistancia(filtro, 10); // Mediana ainda em 150
+    uint16_t anterior = filtrarDistancia(filtro, 10);                            // Mediana vira 10
+    VERIFICAR(anterior == 10 + (150 - 10) * 3 / 4);
+    for (int i = 0; i < 40; i++) {
+        saida = filtrarDistancia(filtro, 10);
+        VERIFICAR(saida <= anterior && saida >= 10);
+        anterior = saida;
+    }
+    VERIFICAR(saida == 10);
+
+    // Firmware: sala vazia, depois alguém parado no limiar com o eco ruidoso
+    iniciarFirmware();
+    Execucao execucao;
+    sim::definirDistancia(150);
+    executarPor(2000, execucao);
+    VERIFICAR(!ocupacao);
+    uint32_t trocas = trocasOcupacao;
+    uint32_t suprimidas = trocasSuprimidas;
+    int cruzamentos = 0;                        // Vezes que a amostra bruta cruzou o limiar
+    bool brutaPerto = false;
+    for (int i = 0; i < 150; i++) {             // 9 s, uma amostra por ciclo do HC-SR04
+        uint16_t cm = RUIDO_CM[i % (sizeof(RUIDO_CM) / sizeof(RUIDO_CM[0]))];
+        bool perto = cm != 0 && cm <= DISTANCIA_PRESENCA_CM;
+        cruzamentos += perto != brutaPerto;
+        brutaPerto = perto;
+        sim::definirDistancia(cm);
+        executarPor(periodoUltrassomUs / 1000, execucao);
+    }
+    printf("%d cruzamentos da amostra bruta; %u trocas de ocupacao, %u suprimidas; filtrada %u cm\n", cruzamentos,
+           trocasOcupacao - trocas, trocasSuprimidas - suprimidas,
+           (unsigned)distanciaFiltradaCm.load(std::memory_order_relaxed));
+    VERIFICAR(ocupacao);
+    VERIFICAR(trocasOcupacao == trocas + 1);
+    VERIFICAR(trocasSuprimidas > suprimidas + 10);
+    VERIFICAR(distanciaFiltradaCm.load(std::memory_order_relaxed) <= DISTANCIA_PRESENCA_CM);
+
+    // Saída: a distância limpa passa de DISTANCIA_AUSENCIA_CM e a sala esvazia, de novo uma vez
+    sim::definirDistancia(150);
+    executarPor(3000, execucao);
+    VERIFICAR(!ocupacao);
+    VERIFICAR(trocasOcupacao == trocas + 2);
+    return concluirTeste("teste_filtro_ocupacao");
+}
@@ -0,0 +1,101 @@
+/**
+ * @file teste_importacao.cpp
+ * @brief Importação de CSV em /usuarios/importar: capacidade, vazão e passos da tarefa de rede.
+ * @details A vazão medida é a de uma importação bem-sucedida na capacidade real da tabela
+ * (CAPACIDADE_USUARIOS_FLASH, 4096 usuários), repetida para tirar a mediana. O arquivo de 50
+ * mil linhas do pedido original não cabe: ele aparece à parte, como recusa (413) sem publicar
+ * a tabela truncada. Nenhum passo da tarefa de rede pode apagar mais de um setor da flash
+ * (~30 ms) ou conferir o CRC da tabela inteira de uma vez.
+ */
+#include "main.cpp"
+#include "apoio.h"
+
+#include <algorithm>
+#include <vector>
+
+const uint64_t LIMITE_PASSO_REDE_US = 40000; // Um setor apagado (30 ms) ou um trecho do corpo, nunca os dois
+const int REPETICOES = 5;                   // Importações medidas na capacidade
+
+struct Importacao {
+    int status;
+    uint32_t importados;
+    double segundos;                        // Tempo de parede no host
+    double segundosVirtuais;                // Relógio do simulador: inclui apagar e gravar a flash
+    uint64_t maiorPassoUs;                  // Maior volta da tarefa de rede durante a importação
+};
+
+std::string gerarCsv(uint32_t linhas) {
+    std::string csv = "uid_hex,nome,horario\n";
+    char linha[48];
+    for (uint32_t i = 0; i < linhas; i++) {
+        snprintf(linha, sizeof(linha), "%08X,Usuario %u,0\n", 0x10000000u + i * 2654435761u % 0x0FFFFFFF, i);
+        csv += linha;
+    }
+    return csv;
+}
+
+Importacao importar(const std::string &csv) {
+    std::string autorizacao = std::string("Authorization: Bearer ") + tokenAdministrador + "\r\n";
+    passoRedeMaxUs = 0;
+    uint64_t inicioVirtualUs = sim::agoraUs();
+    auto inicio = std::chrono::steady_clock::now();
+    std::string resposta = requisicaoHttp("POST", "/usuarios/importar", csv, autorizacao, 600000);
+    Importacao r = {statusHttp(resposta), leitorCsv.importados, segundosDesde(inicio),
+                    (sim::agoraUs() - inicioVirtualUs) / 1e6, passoRedeMaxUs};
+    printf("  %s", corpoHttp(resposta).c_str());
+    VERIFICAR(r.maiorPassoUs < LIMITE_PASSO_REDE_US);
+    return r;
+}
+
+int main() {
+    iniciarFirmware();
+    Execucao execucao;
+    executarPor(100, execucao);
+    const byte primeiro[] = {0x10, 0x00, 0x00, 0x00};
+    byte horario;
+
+    // Vazão: importações completas na capacidade, cada uma publicada e mapeada pelo controle
+    std::string csv = gerarCsv(CAPACIDADE_USUARIOS_FLASH);
+    std::vector<double> segundos, segundosVirtuais;
+    uint64_t maiorPassoUs = 0;
+    for (int i = 0; i < REPETICOES; i++) {
+        int slotAntes = slotTabelaEmUso.load();
+        Importacao r = importar(csv);
+        VERIFICAR(r.status == 200);
+        VERIFICAR(r.importados == CAPACIDADE_USUARIOS_FLASH);
+        executarPor(10, execucao);
+        VERIFICAR(slotTabelaEmUso.load() != slotAntes);
+        VERIFICAR(buscarUsuario(criarChaveUID(primeiro, 4), horario) != nullptr);
+        segundos.push_back(r.segundos);
+        segundosVirtuais.push_back(r.segundosVirtuais);
+        maiorPassoUs = std::max(maiorPassoUs, r.maiorPassoUs);
+    }
+    std::sort(segundos.begin(), segundos.end());
+    std::sort(segundosVirtuais.begin(), segundosVirtuais.end());
+    printf("Importacao de %u linhas (%zu bytes), mediana de %d: %.0f linhas/s no host (%.3f s), "
+           "%.1f s no relogio virtual (%.0f linhas/s), maior passo de rede %llu us\n",
+           CAPACIDADE_USUARIOS_FLASH, csv.size(), REPETICOES, CAPACIDADE_USUARIOS_FLASH / segundos[REPETICOES / 2],
+           segundos[REPETICOES / 2], segundosVirtuais[REPETICOES / 2],
+           CAPACIDADE_USUARIOS_FLASH / segundosVirtuais[REPETICOES / 2], (unsigned long long)maiorPassoUs);
+
+    // 50 mil linhas: recusa; nada é publicado e a tabela anterior continua valendo
+    int slotAntes = slotTabelaEmUso.load();
+    csv = gerarCsv(50000);
+    Importacao r = importar(csv);
+    VERIFICAR(r.status == 413);
+    printf("Recusa de 50000 linhas (%zu bytes): 413 em %.3f s no host, %.1f s no relogio virtual\n", csv.size(),
+           r.segundos, r.segundosVirtuais);
+    executarPor(10, execucao);
+    VERIFICAR(leitorCsv.excedentes == 50000 - CAPACIDADE_USUARIOS_FLASH);
+    VERIFICAR(slotTabelaEmUso.load() == slotAntes);
+    VERIFICAR(buscarUsuario(criarChaveUID(primeiro, 4), horario) != nullptr);
+
+    // Horário com dígitos demais: recusado, e o acumulador para no primeiro dígito inválido
+    const byte estouro[] = {0xCA, 0xFE, 0xBA, 0xBE};
+    r = importar("uid_hex,nome,horario\nDEADBEEF,Visitante,1\nCAFEBABE,Estouro,4294967303\n");
+    VERIFICAR(r.status == 200);
+    VERIFICAR(leitorCsv.importados == 1 && leitorCsv.rejeitados == 1);
+    executarPor(10, execucao);
+    VERIFICAR(buscarUsuario(criarChaveUID(estouro, 4), horario) == nullptr);
+    return concluirTeste("teste_importacao");
+}
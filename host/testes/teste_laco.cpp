@@ -0,0 +1,27 @@
+/**
+ * @file teste_laco.cpp
+ * @brief Pior volta do loop() abaixo de 5 ms durante o dia roteirizado (relógio virtual).
+ * @details A volta inclui os custos modelados dos periféricos (LCD I2C, Serial, SPI, flash) e
+ * os timers e ISRs que a interrompem, como no ESP32. Também relata cada tarefa do
+ * escalonador, para apontar quem estourou quando a verificação falha.
+ */
+#include "main.cpp"
+#include "apoio.h"
+
+const uint64_t LIMITE_VOLTA_US = 5000;
+
+int main() {
+    iniciarFirmware();
+    Execucao execucao;
+    executarCenario("dia_na_sala.txt", execucao);
+
+    printf("%llu voltas; pior volta %llu us em %.3f s\n", (unsigned long long)execucao.voltas,
+           (unsigned long long)execucao.voltaMaxUs, execucao.instanteVoltaMaxUs / 1e6);
+    for (int i = 0; i < totalTarefas; i++) {
+        const Tarefa &t = tarefas[ordemTarefas[i]];
+        printf("  %-12s max %6lu us, p99 %6lu us, %lu estouros de orcamento\n", t.nome, t.maximoUs,
+               percentil99Us(t), t.estourosOrcamento);
+    }
+    VERIFICAR(execucao.voltaMaxUs < LIMITE_VOLTA_US);
+    return concluirTeste("teste_laco");
+}
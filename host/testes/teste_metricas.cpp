@@ -0,0 +1,152 @@
+/**
+ * @file teste_metricas.cpp
+ * @brief Formato de exposição do /metrics (texto do Prometheus 0.0.4) e semântica dos contadores.
+ * @details Cada família tem um HELP e um TYPE, nessa ordem, seguidos de todas as suas amostras
+ * num grupo só; nenhum _total volta entre coletas; a maior volta do loop() é zerada pelo
+ * próprio controle depois de cada coleta.
+ */
+#include "main.cpp"
+#include "apoio.h"
+
+#include <map>
+#include <set>
+
+bool atrasarVolta = false;                  // A próxima execução de voltaLonga() segura o loop() 20 ms
+
+void voltaLonga() {
+    if (!atrasarVolta) return;
+    atrasarVolta = false;
+    delay(20);
+}
+
+/**
+ * @brief GET /metrics com o instantâneo mais recente do controle já na web.
+ * @details A tarefa de rede não roda durante executarPor(): a fila de estados enche com os
+ * antigos. Esvaziá-la antes dá ao controle a vez de publicar o atual.
+ */
+std::string coletar() {
+    Execucao execucao;
+    passoRede(0);
+    executarPor(60, execucao);                  // Uma publicação (a cada 50 ms)
+    std::string resposta = requisicaoHttp("GET", "/metrics");
+    VERIFICAR(statusHttp(resposta) == 200);
+    VERIFICAR(resposta.find("Content-Type: text/plain; version=0.0.4") != std::string::npos);
+    return corpoHttp(resposta);
+}
+
+/**
+ * @brief Confere o agrupamento das famílias; devolve as amostras (nome com rótulos -> valor).
+ */
+std::map<std::string, double> conferirFormato(const std::string &texto) {
+    std::map<std::string, double> amostras;
+    std::set<std::string> familiasVistas;
+    std::string familia, tipo, ajuda;
+    std::istringstream entrada(texto);
+    std::string linha;
+    int numero = 0;
+    while (std::getline(entrada, linha)) {
+        numero++;
+        if (linha.rfind("# HELP ", 0) == 0) {
+            std::string nome = linha.substr(7, linha.find(' ', 7) - 7);
+            if (!familiasVistas.insert(nome).second) {
+                fprintf(stderr, "linha %d: familia %s repetida\n", numero, nome.c_str());
+                falhasTeste++;
+            }
+            ajuda = nome;
+            familia.clear();
+            continue;
+        }
+        if (linha.rfind("# TYPE ", 0) == 0) {
+            std::istringstream campos(linha.substr(7));
+            campos >> familia >> tipo;
+            if (familia != ajuda) {
+                fprintf(stderr, "linha %d: TYPE de %s sem o HELP logo antes\n", numero, familia.c_str());
+                falhasTeste++;
+            }
+            continue;
+        }
+        size_t fimNome = linha.find_first_of("{ ");
+        std::string nome = linha.substr(0, fimNome);
+        bool daFamilia = nome == familia;
+        if (tipo == "histogram") {
+            daFamilia = nome == familia + "_bucket" || nome == familia + "_sum" || nome == familia + "_count";
+        }
+        if (familia.empty() || !daFamilia) {
+            fprintf(stderr, "linha %d: amostra %s fora do grupo da familia '%s'\n", numero, nome.c_str(),
+                    familia.c_str());
+            falhasTeste++;
+        }
+        size_t espaco = linha.rfind(' ');
+        char *fim = nullptr;
+        double valor = strtod(linha.c_str() + espaco + 1, &fim);
+        if (*fim != '\0') {
+            fprintf(stderr, "linha %d: valor invalido '%s'\n", numero, linha.c_str() + espaco + 1);
+            falhasTeste++;
+        }
+        amostras[linha.substr(0, espaco)] = valor;
+    }
+    return amostras;
+}
+
+/**
+ * @brief Nenhum contador (_total, _count, _sum, _bucket) diminuiu entre as coletas.
+ */
+void conferirMonotonia(const std::map<std::string, double> &antes, const std::map<std::string, double> &depois) {
+    for (const auto &a : antes) {
+        const std::string &serie = a.first;
+        bool contador = serie.find("_total") != std::string::npos || serie.find("_count") != std::string::npos ||
+                        serie.find("_sum") != std::string::npos || serie.find("_bucket") != std::string::npos;
+        auto d = depois.find(serie);
+        if (!contador || d == depois.end()) continue;
+        if (d->second < a.second) {
+            fprintf(stderr, "%s voltou: %g -> %g\n", serie.c_str(), a.second, d->second);
+            falhasTeste++;
+        }
+    }
+}
+
+int main() {
+    iniciarFirmware();
+    registrarTarefa("teste", voltaLonga, 10, 4, 30000);
+    Execucao execucao;
+    sim::definirDistancia(150);
+    executarPor(2000, execucao);
+
+    std::map<std::string, double> inicial = conferirFormato(coletar());
+    VERIFICAR(inicial.count("sala_saida_ligada_segundos_total{saida=\"luz\"}") == 1);
+    VERIFICAR(inicial.count("sala_acessos_total{resultado=\"fora_horario\"}") == 1);
+
+    // A volta longa aparece na coleta seguinte e some depois dela: o controle reabriu a janela
+    atrasarVolta = true;
+    executarPor(100, execucao);
+    std::map<std::string, double> comVoltaLonga = conferirFormato(coletar());
+    VERIFICAR(comVoltaLonga["sala_loop_volta_max_segundos"] >= 0.020);
+    executarPor(100, execucao);
+    std::map<std::string, double> depoisDaColeta = conferirFormato(coletar());
+    VERIFICAR(depoisDaColeta["sala_loop_volta_max_segundos"] > 0);
+    VERIFICAR(depoisDaColeta["sala_loop_volta_max_segundos"] < 0.020);
+
+    // Alguém entra e a luz acende sozinha; os contadores das saídas só andam para frente
+    sim::definirDistancia(12);
+    executarPor(8000, execucao);
+    std::map<std::string, double> luzLigada = conferirFormato(coletar());
+    VERIFICAR(luzLigada["sala_saida_acionamentos_total{saida=\"luz\"}"] == 1);
+    VERIFICAR(luzLigada["sala_saida_ligada_segundos_total{saida=\"luz\"}"] > 0);
+    executarPor(2000, execucao);
+    std::map<std::string, double> luzMaisTempo = conferirFormato(coletar());
+    VERIFICAR(luzMaisTempo["sala_saida_ligada_segundos_total{saida=\"luz\"}"] >=
+              luzLigada["sala_saida_ligada_segundos_total{saida=\"luz\"}"] + 1.9);
+    Comando desliga = {CMD_LUZ, false};
+    enfileirarComando(desliga);
+    std::map<std::string, double> luzDesligada = conferirFormato(coletar()); // Coleta logo no desligamento
+    executarPor(500, execucao);
+    std::map<std::string, double> final = conferirFormato(coletar());
+    VERIFICAR(final["sala_saida_acionamentos_total{saida=\"luz\"}"] == 2);
+
+    const std::map<std::string, double> *coletas[] = {&inicial,    &comVoltaLonga, &depoisDaColeta, &luzLigada,
+                                                      &luzMaisTempo, &luzDesligada, &final};
+    for (size_t i = 1; i < sizeof(coletas) / sizeof(coletas[0]); i++) conferirMonotonia(*coletas[i - 1], *coletas[i]);
+    printf("%zu series; luz ligada %.3f s, %g acionamentos\n", final.size(),
+           final["sala_saida_ligada_segundos_total{saida=\"luz\"}"], final["sala_saida_acionamentos_total{saida=\"luz\"}"]);
+    return concluirTeste("teste_metricas");
+}
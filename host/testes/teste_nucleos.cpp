@@ -0,0 +1,152 @@
+/**
+ * @file teste_nucleos.cpp
+ * @brief Os dois lados do firmware em threads, sob o ThreadSanitizer: latência comando -> acionamento.
+ * @details O loop() (controle, núcleo 1) roda na thread principal, a tarefa de rede (núcleo 0)
+ * numa thread própria e os timers na thread do simulador, no relógio real. Um cliente manda
+ * lotes alternando a ventoinha e um navegador segue /api/events. Eles só conversam pelas
+ * filas SPSC e pelos atômicos; qualquer outro global compartilhado aparece como corrida e o
+ * TSan encerra o processo com erro. Um Prometheus coleta /metrics o tempo todo, que lê os
+ * contadores do controle e das ISRs, e o relatório do Serial (controle) é adiantado a cada
+ * RELATORIO_VOLTAS voltas, lendo os contadores da web. A latência medida pelo firmware vai da entrada na fila
+ * (web) ao fim do acionamento (controle); a do cliente é a volta inteira do POST.
+ */
+#include "main.cpp"
+#include "apoio.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+const int LOTES = 300;
+const double LIMITE_P99_MS = 250;           // Folgado: TSan e um host de CI com um só núcleo
+const int RELATORIO_VOLTAS = 2000;          // O período normal (60 s) não cabe no teste
+
+std::atomic<bool> terminou{false};
+
+/**
+ * @brief Uma requisição com socket bloqueante; devolve a resposta inteira.
+ */
+std::string pedirHttp(uint16_t porta, const char *pedido) {
+    int soquete = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in endereco = {};
+    endereco.sin_family = AF_INET;
+    endereco.sin_port = htons(porta);
+    endereco.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    timeval limite = {5, 0};
+    setsockopt(soquete, SOL_SOCKET, SO_RCVTIMEO, &limite, sizeof(limite));
+    std::string resposta;
+    if (connect(soquete, (sockaddr *)&endereco, sizeof(endereco)) == 0 &&
+        send(soquete, pedido, strlen(pedido), MSG_NOSIGNAL) == (ssize_t)strlen(pedido)) {
+        char bloco[1024];
+        ssize_t n;
+        while ((n = recv(soquete, bloco, sizeof(bloco), 0)) > 0) resposta.append(bloco, n);
+    }
+    close(soquete);
+    return resposta;
+}
+
+/**
+ * @brief Um POST /api/commands com o lote 'corpo'.
+ */
+std::string postarLote(uint16_t porta, const char *corpo) {
+    char pedido[160];
+    snprintf(pedido, sizeof(pedido), "POST /api/commands HTTP/1.1\r\nHost: sala\r\nContent-Length: %zu\r\n\r\n%s",
+             strlen(corpo), corpo);
+    return pedirHttp(porta, pedido);
+}
+
+/**
+ * @brief Prometheus: coleta /metrics a cada 20 ms até o fim do teste.
+ */
+void coletor(uint16_t porta, int *coletas) {
+    while (!terminou.load()) {
+        std::string resposta = pedirHttp(porta, "GET /metrics HTTP/1.1\r\nHost: sala\r\n\r\n");
+        if (statusHttp(resposta) == 200 && resposta.find("sala_acessos_total") != std::string::npos) (*coletas)++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+}
+
+/**
+ * @brief Navegador com o painel aberto: lê o fluxo SSE até o fim do teste.
+ */
+void navegador(uint16_t porta, size_t *eventos) {
+    int soquete = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in endereco = {};
+    endereco.sin_family = AF_INET;
+    endereco.sin_port = htons(porta);
+    endereco.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    timeval limite = {0, 100000};
+    setsockopt(soquete, SOL_SOCKET, SO_RCVTIMEO, &limite, sizeof(limite));
+    const char *pedido = "GET /api/events HTTP/1.1\r\nHost: sala\r\n\r\n";
+    if (connect(soquete, (sockaddr *)&endereco, sizeof(endereco)) == 0) send(soquete, pedido, strlen(pedido), MSG_NOSIGNAL);
+    std::string recebido;
+    while (!terminou.load()) {
+        char bloco[1024];
+        ssize_t n = recv(soquete, bloco, sizeof(bloco), 0);
+        if (n > 0) recebido.append(bloco, n);
+        else if (n == 0) break;
+    }
+    close(soquete);
+    for (size_t p = recebido.find("data: "); p != std::string::npos; p = recebido.find("data: ", p + 1)) (*eventos)++;
+}
+
+int main() {
+    iniciarFirmware();
+    Execucao execucao;
+    sim::definirDistancia(12);                  // Sala ocupada: a ventoinha manual pode ligar
+    executarPor(6000, execucao);
+    VERIFICAR(ocupacao);
+    uint16_t porta = portaServidor();
+    sim::usarRelogioReal();
+
+    std::thread rede([] {
+        while (!terminou.load()) passoRede(10);
+    });
+    size_t eventosSse = 0;
+    std::thread painel(navegador, porta, &eventosSse);
+    int coletas = 0;
+    std::thread prometheus(coletor, porta, &coletas);
+    std::vector<double> voltasMs;
+    int falhas = 0;
+    std::thread cliente([&] {
+        for (int i = 0; i < LOTES; i++) {
+            auto inicio = std::chrono::steady_clock::now();
+            std::string resposta = postarLote(porta, i % 2 == 0 ? "ventilacao=on" : "ventilacao=off");
+            voltasMs.push_back(segundosDesde(inicio) * 1000);
+            if (statusHttp(resposta) != 200 && statusHttp(resposta) != 503) {
+                if (falhas++ == 0) fprintf(stderr, "lote %d: \"%.80s\"\n", i, resposta.c_str());
+            }
+        }
+        terminou.store(true);
+    });
+    int relatorios = 0;
+    for (int volta = 0; !terminou.load(); volta++) {
+        if (volta % RELATORIO_VOLTAS == 0 && linhaRelatorio == 0) {
+            reagendarTarefa(tarefaEstatisticas, 0);
+            relatorios++;
+        }
+        loop();
+        std::this_thread::yield();              // Host com um só núcleo: deixa a rede e o cliente andarem
+    }
+    cliente.join();
+    painel.join();
+    prometheus.join();
+    rede.join();
+    sim::pararRelogioReal();
+
+    std::sort(voltasMs.begin(), voltasMs.end());
+    uint32_t aplicados = 0;
+    for (int i = 0; i < FAIXAS_LATENCIA_COMANDO; i++) aplicados += latenciaComando[CMD_LOTE][i];
+    double mediaUs = aplicados ? (double)somaLatenciaComandoUs[CMD_LOTE] / aplicados : 0;
+    printf("%d lotes: volta do POST p50 %.2f ms, p99 %.2f ms; fila -> acionamento media %.0f us, max %lu us\n",
+           LOTES, voltasMs[LOTES / 2], voltasMs[LOTES * 99 / 100], mediaUs, (unsigned long)latenciaComandoMaxUs);
+    printf("%u lotes aplicados, %zu eventos SSE, %d coletas de /metrics, %d relatorios, falhas %d\n", aplicados,
+           eventosSse, coletas, relatorios, falhas);
+    VERIFICAR(falhas == 0);
+    VERIFICAR(aplicados > 0);
+    VERIFICAR(eventosSse > 0);
+    VERIFICAR(coletas > 0);
+    VERIFICAR(relatorios > 1);
+    VERIFICAR(voltasMs[LOTES * 99 / 100] < LIMITE_P99_MS);
+    return concluirTeste("teste_nucleos");
+}
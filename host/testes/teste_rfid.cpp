@@ -0,0 +1,93 @@
+/**
+ * @file teste_rfid.cpp
+ * @brief Detecção de cartão pela linha IRQ do MFRC522.
+ * @details Só a resposta ao REQA pode sinalizar a IRQ: os quadros de PICC_ReadCardSerial() e
+ * do HLTA não podem marcar o leitor de novo, senão a visita seguinte faz um ReadCardSerial
+ * num cartão parado e espera o timeout de 25 ms do MFRC522. Um cartão aproximado de novo
+ * dentro de 'janelaRepeticaoMs' é descartado; depois dela, é lido como novo.
+ */
+#include "main.cpp"
+#include "apoio.h"
+
+const uint8_t UID_ANNE[] = {207, 219, 197, 196};
+const uint8_t UID_7_BYTES[] = {0x04, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66};
+const uint8_t UID_VISITANTE[] = {0xDE, 0xAD, 0xBE, 0xEF};
+
+/**
+ * @brief Aproxima e afasta um cartão da entrada, como um toque rápido.
+ */
+void tocar(const uint8_t *uid, size_t tamanho, Execucao &execucao) {
+    sim::apresentarCartao(PINO_RFID_SS_ENTRADA, uid, tamanho);
+    executarPor(300, execucao);
+    sim::retirarCartao(PINO_RFID_SS_ENTRADA);
+}
+
+int main() {
+    iniciarFirmware();
+    Execucao execucao;
+    executarPor(1000, execucao);
+    LeitorRFID &entrada = leitores[0];
+    const sim::LeitorSimulado &modelo = sim::leitorRfid(PINO_RFID_SS_ENTRADA);
+
+    // Um toque: uma resposta, uma leitura, um HLTA e nenhuma espera pelo timeout
+    sim::apresentarCartao(PINO_RFID_SS_ENTRADA, UID_ANNE, sizeof(UID_ANNE));
+    executarPor(300, execucao);
+    VERIFICAR(modelo.leituras == 1);
+    VERIFICAR(modelo.halts == 1);
+    VERIFICAR(entrada.interrupcoes == 1);
+    VERIFICAR(entrada.cartoes == 1);
+
+    // O cartão parado continua no campo: não responde mais ao REQA, e nada bloqueia
+    executarPor(10000, execucao);
+    VERIFICAR(modelo.leituras == 1);
+    VERIFICAR(modelo.leiturasSemResposta == 0);
+    VERIFICAR(entrada.interrupcoes == 1);
+    VERIFICAR(entrada.consultaMaxUs <= 3000);   // Orçamento da tarefa "rfid"
+    sim::retirarCartao(PINO_RFID_SS_ENTRADA);
+    executarPor(5000, execucao);
+
+    // Janela anti-repetição: o mesmo cartão volta logo depois do feedback e é descartado
+    unsigned long cartoes = entrada.cartoes, suprimidas = entrada.suprimidas;
+    uint32_t negados = eventosPorTipo[EVENTO_NEGADO];
+    tocar(UID_VISITANTE, sizeof(UID_VISITANTE), execucao);
+    VERIFICAR(entrada.cartoes == cartoes + 1);
+    while (feedbackEmAndamento()) executarPor(10, execucao);
+    executarPor(janelaRepeticaoMs / 2, execucao);
+    tocar(UID_VISITANTE, sizeof(UID_VISITANTE), execucao);
+    VERIFICAR(entrada.cartoes == cartoes + 1);
+    VERIFICAR(entrada.suprimidas == suprimidas + 1);
+    VERIFICAR(eventosPorTipo[EVENTO_NEGADO] == negados + 1);
+    VERIFICAR(!feedbackEmAndamento());
+
+    // Passada a janela (contada da última leitura), o mesmo cartão é uma leitura nova
+    executarPor(janelaRepeticaoMs + 100, execucao);
+    tocar(UID_VISITANTE, sizeof(UID_VISITANTE), execucao);
+    VERIFICAR(entrada.cartoes == cartoes + 2);
+    VERIFICAR(entrada.suprimidas == suprimidas + 1);
+    VERIFICAR(eventosPorTipo[EVENTO_NEGADO] == negados + 2);
+    while (feedbackEmAndamento()) executarPor(10, execucao);
+
+    // O descarte aparece no /metrics por leitor
+    std::string metricas = corpoHttp(requisicaoHttp("GET", "/metrics"));
+    char serie[96];
+    snprintf(serie, sizeof(serie), "sala_rfid_suprimidas_total{leitor=\"entrada\"} %lu\n", entrada.suprimidas.ler());
+    VERIFICAR(metricas.find(serie) != std::string::npos);
+
+    // Um celular ignora o HLTA e responde a todo REQA: leituras repetidas, suprimidas
+    uint32_t leiturasAntes = modelo.leituras;
+    suprimidas = entrada.suprimidas;
+    sim::apresentarCartao(PINO_RFID_SS_ENTRADA, UID_7_BYTES, sizeof(UID_7_BYTES), true);
+    executarPor(8000, execucao);
+    uint32_t leiturasCelular = modelo.leituras - leiturasAntes;
+    VERIFICAR(leiturasCelular > 5);
+    VERIFICAR(entrada.suprimidas == suprimidas + leiturasCelular - 1);
+    VERIFICAR(entrada.interrupcoes == modelo.leituras);
+    VERIFICAR(modelo.leiturasSemResposta == 0);
+    sim::retirarCartao(PINO_RFID_SS_ENTRADA);
+
+    printf("Entrada: %u REQA, %u respostas, %u leituras, %u halts, %u sem resposta; maior consulta %lu us\n",
+           modelo.reqas, modelo.respostasReqa, modelo.leituras, modelo.halts, modelo.leiturasSemResposta,
+           entrada.consultaMaxUs);
+    printf("Maior transacao bloqueante no driver: %u us\n", modelo.maiorTransacaoUs);
+    return concluirTeste("teste_rfid");
+}
@@ -0,0 +1,98 @@
+/**
+ * @file teste_rodizio_rfid.cpp
+ * @brief Rodízio entre quatro leitores RFID simulados com um celular parado num deles.
+ * @details O celular ignora o HLTA e responde a todo REQA, então o seu leitor tem trabalho em
+ * toda visita. O rodízio não pode deixar os outros sem consulta: cada leitor ocioso continua
+ * recebendo o seu REQA a cada 'intervaloReqaMs' (mais uma volta do rodízio) e um cartão
+ * apresentado ao último leitor é lido dentro dessa mesma janela. Durante um feedback só o
+ * leitor que o disparou para; um cartão lido em outro fica pendente até o feedback acabar.
+ */
+#include "main.cpp"
+#include "apoio.h"
+
+const PinosLeitorRFID leitoresTeste[] = {
+    {PINO_RFID_SS_ENTRADA, PINO_RFID_IRQ_ENTRADA, "entrada"},
+    {PINO_RFID_SS_SAIDA, PINO_RFID_IRQ_SAIDA, "saida"},
+    {4, 36, "lab"},
+    {26, 39, "deposito"},
+};
+const int TOTAL_TESTE = sizeof(leitoresTeste) / sizeof(leitoresTeste[0]);
+
+const uint8_t UID_CELULAR[] = {0x08, 0x5A, 0x11, 0x20};
+const uint8_t UID_ANNE[] = {207, 219, 197, 196};
+const uint8_t UID_VISITANTE[] = {0xDE, 0xAD, 0xBE, 0xEF};
+
+int main() {
+    pinosLeitores = leitoresTeste;
+    quantidadeLeitores = TOTAL_TESTE;
+    sim::ligarIrqRfid(4, 36);
+    sim::ligarIrqRfid(26, 39);
+    iniciarFirmware();
+    VERIFICAR(totalLeitores == TOTAL_TESTE);
+    Execucao execucao;
+    executarPor(1000, execucao);
+
+    // Um rodízio completo da tarefa "rfid" (período 50 / totalLeitores ms por leitor)
+    const unsigned long voltaRodizioMs = (50 / TOTAL_TESTE) * TOTAL_TESTE;
+    const unsigned long intervaloLimiteMs = intervaloReqaMs + voltaRodizioMs;
+
+    // A primeira leitura do celular é um acesso negado: o feedback para só o leitor da entrada
+    LeitorRFID &deposito = leitores[TOTAL_TESTE - 1];
+    sim::apresentarCartao(PINO_RFID_SS_ENTRADA, UID_CELULAR, sizeof(UID_CELULAR), true);
+    executarPor(100, execucao);
+    VERIFICAR(leitores[0].cartoes == 1);
+    VERIFICAR(feedbackEmAndamento());
+    unsigned long consultasFeedback[TOTAL_TESTE];
+    for (int i = 0; i < TOTAL_TESTE; i++) consultasFeedback[i] = leitores[i].consultas;
+
+    // Um cartão no depósito durante o feedback é lido na hora e decidido quando ele termina
+    uint32_t negados = eventosPorTipo[EVENTO_NEGADO];
+    sim::apresentarCartao(26, UID_VISITANTE, sizeof(UID_VISITANTE));
+    executarPor(intervaloLimiteMs, execucao);
+    VERIFICAR(deposito.cartoes == 1);
+    VERIFICAR(deposito.temPendente);
+    VERIFICAR(eventosPorTipo[EVENTO_NEGADO] == negados);
+    sim::retirarCartao(26);
+    while (feedbackEmAndamento()) executarPor(1, execucao);
+    VERIFICAR(leitores[0].consultas == consultasFeedback[0]);
+    for (int i = 1; i < TOTAL_TESTE - 1; i++) VERIFICAR(leitores[i].consultas > consultasFeedback[i] + 10);
+    VERIFICAR(deposito.consultas > consultasFeedback[TOTAL_TESTE - 1]); // Parado só depois de ter um pendente
+    executarPor(voltaRodizioMs, execucao);
+    VERIFICAR(eventosPorTipo[EVENTO_NEGADO] == negados + 1);
+    VERIFICAR(!deposito.temPendente && leitorFeedback == TOTAL_TESTE - 1);
+    while (feedbackEmAndamento()) executarPor(1, execucao);
+    executarPor(intervaloLimiteMs, execucao);   // Primeira consulta de cada leitor depois dos feedbacks
+
+    // Daqui em diante o celular só gera leituras repetidas, suprimidas sem feedback
+    const sim::LeitorSimulado &celular = sim::leitorRfid(PINO_RFID_SS_ENTRADA);
+    uint32_t leiturasAntes = celular.leituras;
+    unsigned long consultasAntes[TOTAL_TESTE];
+    for (int i = 0; i < TOTAL_TESTE; i++) {
+        consultasAntes[i] = leitores[i].consultas;
+        leitores[i].intervaloMaxMs = 0;
+    }
+    executarPor(5000, execucao);
+    VERIFICAR(celular.leituras - leiturasAntes > 10); // O leitor do celular trabalhou o tempo todo
+    VERIFICAR(leitores[0].cartoes == 1);
+    for (int i = 0; i < TOTAL_TESTE; i++) {
+        const LeitorRFID &l = leitores[i];
+        unsigned long consultas = l.consultas - consultasAntes[i];
+        printf("%-9s %4lu consultas, intervalo max %3lu ms, consulta max %4lu us\n", l.nome, consultas,
+               l.intervaloMaxMs, l.consultaMaxUs);
+        VERIFICAR(consultas >= 5000 / intervaloLimiteMs);
+        VERIFICAR(l.intervaloMaxMs <= intervaloLimiteMs);
+        VERIFICAR(l.consultaMaxUs <= 3000);     // Orçamento da tarefa "rfid"
+    }
+
+    // Com o celular ainda parado na entrada, um cartão no último leitor é lido a tempo
+    sim::apresentarCartao(26, UID_ANNE, sizeof(UID_ANNE));
+    uint64_t inicioUs = sim::agoraUs();
+    while (deposito.cartoes == 1 && sim::agoraUs() - inicioUs < 1000000) executarPor(1, execucao);
+    unsigned long esperaMs = (sim::agoraUs() - inicioUs) / 1000;
+    printf("Cartao no leitor %s lido em %lu ms\n", deposito.nome, esperaMs);
+    VERIFICAR(deposito.cartoes == 2);
+    VERIFICAR(esperaMs <= intervaloLimiteMs);
+    sim::retirarCartao(26);
+    sim::retirarCartao(PINO_RFID_SS_ENTRADA);
+    return concluirTeste("teste_rodizio_rfid");
+}
@@ -0,0 +1,25 @@
+/**
+ * @file teste_sem_leitores.cpp
+ * @brief Firmware montado sem nenhum leitor RFID: nada de divisão por zero no rodízio.
+ * @details O período da tarefa "rfid" e o rodízio dividem pelo número de leitores; com zero
+ * a tarefa não é registrada, e o resto (ocupação, relatório, /metrics) segue funcionando.
+ */
+#include "main.cpp"
+#include "apoio.h"
+
+int main() {
+    quantidadeLeitores = 0;
+    iniciarFirmware();
+    VERIFICAR(totalLeitores == 0);
+    for (int i = 0; i < totalTarefas; i++) VERIFICAR(strcmp(tarefas[i].nome, "rfid") != 0);
+    VERIFICAR(sim::saidaSerial().find("Nenhum leitor RFID") != std::string::npos);
+
+    Execucao execucao;
+    sim::definirDistancia(12);
+    executarPor(6000, execucao);
+    VERIFICAR(ocupacao);
+    char texto[FIFO_SERIAL_BYTES];
+    for (int linha = 0; formatarLinhaRelatorio(linha, texto, sizeof(texto)) > 0; linha++) VERIFICAR(linha < 100);
+    VERIFICAR(statusHttp(requisicaoHttp("GET", "/metrics")) == 200);
+    return concluirTeste("teste_sem_leitores");
+}
@@ -0,0 +1,30 @@
+/**
+ * @file teste_simulador.cpp
+ * @brief Um dia curto na sala (cenarios/dia_na_sala.txt) no relógio virtual.
+ * @details Confere os sensores modelados, as automações e o RFID de ponta a ponta e relata a
+ * velocidade do simulador, a maior volta do loop() e quantas vezes cada saída foi acionada.
+ */
+#include "main.cpp"
+#include "apoio.h"
+
+int main() {
+    auto inicio = std::chrono::steady_clock::now();
+    iniciarFirmware();
+    Execucao execucao;
+    executarCenario("dia_na_sala.txt", execucao);
+    double segundos = segundosDesde(inicio);
+
+    printf("Simulados %.1f s em %.2f s: %llu voltas (%.0f voltas/s simuladas por segundo real)\n",
+           sim::agoraUs() / 1e6, segundos, (unsigned long long)execucao.voltas, execucao.voltas / segundos);
+    printf("Maior volta do loop(): %llu us (em %.3f s)\n", (unsigned long long)execucao.voltaMaxUs,
+           execucao.instanteVoltaMaxUs / 1e6);
+    printf("Acionamentos: luz %u, ventoinha %u, ventoinha automatica %u\n", saidaLuz.acionamentos,
+           saidaVentilacao.acionamentos, saidaVentilacaoAuto.acionamentos);
+
+    VERIFICAR(saidaLuz.acionamentos == 2);
+    VERIFICAR(saidaVentilacao.acionamentos == 2);
+    VERIFICAR(saidaVentilacaoAuto.acionamentos == 2);
+    VERIFICAR(sim::leitorRfid(PINO_RFID_SS_ENTRADA).leituras >= 1);
+    VERIFICAR(sim::leitorRfid(PINO_RFID_SS_SAIDA).leituras >= 1);
+    return concluirTeste("teste_simulador");
+}
@@ -0,0 +1,141 @@
+/**
+ * @file teste_sntp.cpp
+ * @brief Hora local por SNTP contra um servidor NTP local e os horários de acesso compilados.
+ * @details Uma thread responde NTP numa porta UDP do localhost; 'servidorNtp' aponta para ela
+ * antes do setup(), então o endereço passa pelo configTzTime() como no ESP32. Cada
+ * sincronização põe o relógio num ponto da semana e o teste de bit de dentroDoHorario() é
+ * conferido contra a regra HORARIO_COMERCIAL (segunda a sexta, 07:00 às 19:00, UTC-3).
+ */
+#include "main.cpp"
+#include "apoio.h"
+
+#include <thread>
+
+const uint32_t ERA_NTP = 2208988800UL;      // Segundos de 1900 (NTP) a 1970 (Unix)
+const time_t QUARTA_10H = 1791982800;       // Quarta-feira 14/10/2026, 10:00 em Brasília
+const time_t QUARTA_18H59 = 1792015140;     // Mesma quarta, um minuto antes do fim do expediente
+const time_t QUARTA_06H59 = 1791971940;     // Mesma quarta, um minuto antes do início
+const time_t SABADO_10H = 1792242000;       // Sábado 17/10/2026, 10:00
+
+const uint8_t UID_VISITANTE[] = {0xDE, 0xAD, 0xBE, 0xEF};
+
+std::atomic<bool> terminou{false};
+std::atomic<int64_t> horaServidor{0};       // Epoch Unix que o servidor anuncia
+std::atomic<int> pedidosValidos{0};
+std::atomic<int> pedidosInvalidos{0};
+
+/**
+ * @brief Servidor NTP mínimo: responde cada pedido de cliente com 'horaServidor'.
+ */
+void servidorNtpLocal(int soquete) {
+    while (!terminou.load()) {
+        uint8_t pacote[48];
+        sockaddr_in cliente = {};
+        socklen_t tamanho = sizeof(cliente);
+        ssize_t n = recvfrom(soquete, pacote, sizeof(pacote), 0, (sockaddr *)&cliente, &tamanho);
+        if (n < 0) continue;                    // Tempo de espera: confere 'terminou'
+        if (n != sizeof(pacote) || (pacote[0] & 0x07) != 3 || ((pacote[0] >> 3) & 0x07) < 3) {
+            pedidosInvalidos++;                 // Só modo cliente, versão 3 ou 4
+            continue;
+        }
+        pedidosValidos++;
+        uint8_t resposta[48] = {0x24, 1};       // LI 0, versão 4, modo servidor; estrato 1
+        uint32_t segundos = (uint32_t)(horaServidor.load() + ERA_NTP);
+        for (int i = 0; i < 4; i++) resposta[40 + i] = segundos >> (24 - 8 * i); // Transmit timestamp
+        memcpy(resposta + 24, pacote + 40, 8);  // Originate = transmit do cliente
+        sendto(soquete, resposta, sizeof(resposta), 0, (sockaddr *)&cliente, tamanho);
+    }
+}
+
+/**
+ * @brief Acerta o relógio pelo servidor local anunciando 'epoch'.
+ */
+bool sincronizarEm(time_t epoch) {
+    horaServidor.store(epoch);
+    return sim::sincronizarSntp(1000);
+}
+
+/**
+ * @brief Aproxima o cartão do visitante da entrada e devolve o evento que ele gerou.
+ */
+int tentarAcesso(Execucao &execucao) {
+    uint32_t antes[EVENTO_FORA_HORARIO + 1];
+    for (int i = 0; i <= EVENTO_FORA_HORARIO; i++) antes[i] = eventosPorTipo[i];
+    sim::apresentarCartao(PINO_RFID_SS_ENTRADA, UID_VISITANTE, sizeof(UID_VISITANTE));
+    executarPor(300, execucao);
+    sim::retirarCartao(PINO_RFID_SS_ENTRADA);
+    while (feedbackEmAndamento()) executarPor(10, execucao);
+    executarPor(8000, execucao);                // Porta fecha e o cartão deixa de ser "repetido"
+    for (int i = 0; i <= EVENTO_FORA_HORARIO; i++) {
+        if (eventosPorTipo[i] != antes[i] && i != EVENTO_FECHAMENTO) return i;
+    }
+    return -1;
+}
+
+int main() {
+    int soquete = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in endereco = {};
+    endereco.sin_family = AF_INET;
+    endereco.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(soquete, (sockaddr *)&endereco, sizeof(endereco));
+    socklen_t tamanho = sizeof(endereco);
+    getsockname(soquete, (sockaddr *)&endereco, &tamanho);
+    timeval limite = {0, 100000};
+    setsockopt(soquete, SOL_SOCKET, SO_RCVTIMEO, &limite, sizeof(limite));
+    std::thread servidor(servidorNtpLocal, soquete);
+
+    char enderecoNtp[32];
+    snprintf(enderecoNtp, sizeof(enderecoNtp), "127.0.0.1:%u", ntohs(endereco.sin_port));
+    servidorNtp = enderecoNtp;
+    iniciarFirmware();
+    Execucao execucao;
+    sim::definirDistancia(150);
+    executarPor(1000, execucao);
+
+    // Sem SNTP só HORARIO_SEMPRE libera
+    VERIFICAR(dentroDoHorario(HORARIO_SEMPRE));
+    VERIFICAR(!dentroDoHorario(HORARIO_COMERCIAL));
+    VERIFICAR(!dentroDoHorario(MAX_HORARIOS));
+
+    // Visitante com horário comercial, importado pela web
+    std::string autorizacao = std::string("Authorization: Bearer ") + tokenAdministrador + "\r\n";
+    std::string resposta = requisicaoHttp("POST", "/usuarios/importar", "uid_hex,nome,horario\nDEADBEEF,Visitante,1\n",
+                                          autorizacao);
+    VERIFICAR(statusHttp(resposta) == 200);
+    executarPor(10, execucao);
+    VERIFICAR(tentarAcesso(execucao) == EVENTO_FORA_HORARIO);
+
+    // Quarta às 10:00: dentro do horário, e a porta abre
+    VERIFICAR(sincronizarEm(QUARTA_10H));
+    VERIFICAR(time(nullptr) - QUARTA_10H <= 1);
+    VERIFICAR(dentroDoHorario(HORARIO_COMERCIAL));
+    VERIFICAR(tentarAcesso(execucao) == EVENTO_ABERTURA);
+
+    // Sábado: fora, mesmo em horário comercial
+    VERIFICAR(sincronizarEm(SABADO_10H));
+    VERIFICAR(!dentroDoHorario(HORARIO_COMERCIAL));
+    VERIFICAR(tentarAcesso(execucao) == EVENTO_FORA_HORARIO);
+
+    // Bordas do expediente: 06:59 fora; 18:59 dentro até o relógio virtual passar das 19:00
+    VERIFICAR(sincronizarEm(QUARTA_06H59));
+    VERIFICAR(!dentroDoHorario(HORARIO_COMERCIAL));
+    executarPor(60000, execucao);
+    VERIFICAR(dentroDoHorario(HORARIO_COMERCIAL));
+    VERIFICAR(sincronizarEm(QUARTA_18H59));
+    VERIFICAR(dentroDoHorario(HORARIO_COMERCIAL));
+    executarPor(60000, execucao);
+    VERIFICAR(!dentroDoHorario(HORARIO_COMERCIAL));
+
+    // Servidor que não responde: a sincronização falha e o relógio segue como estava
+    terminou.store(true);
+    servidor.join();
+    time_t antes = time(nullptr);
+    VERIFICAR(!sincronizarEm(QUARTA_10H));
+    VERIFICAR(time(nullptr) - antes <= 1);
+    close(soquete);
+
+    printf("%d pedidos NTP respondidos, %d invalidos\n", pedidosValidos.load(), pedidosInvalidos.load());
+    VERIFICAR(pedidosValidos.load() == 4);
+    VERIFICAR(pedidosInvalidos.load() == 0);
+    return concluirTeste("teste_sntp");
+}
@@ -0,0 +1,145 @@
+/**
+ * @file dashboard_gz.h
+ * @brief Painel da sala (dashboard.html) comprimido com gzip, servido direto da flash.
+ * @details Arquivo gerado por host/gerar_dashboard.cmake; não edite à mão. O build do host
+ * (CMakeLists.txt) o regenera sempre que dashboard.html muda: rode o build e faça o commit
+ * dos dois arquivos juntos. teste_dashboard confere que ele descomprime no HTML atual.
+ */
+#pragma once
+
+const uint8_t dashboardHtmlGz[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x8d, 0x57,
+  0xdb, 0x6e, 0xdb, 0x38, 0x10, 0x7d, 0xf7, 0x57, 0xb0, 0x4a, 0x37, 0xb0,
+  0xb1, 0x96, 0x6c, 0xc7, 0x49, 0x51, 0x48, 0xb6, 0x17, 0x69, 0xe2, 0x6e,
+  0xb3, 0xe8, 0x25, 0xa8, 0xd3, 0x02, 0x8b, 0xa2, 0x58, 0x50, 0xe2, 0xd8,
+  0xe6, 0x46, 0x12, 0xb5, 0x24, 0xe5, 0xdc, 0xe0, 0x8f, 0xe9, 0xd3, 0x7e,
+  0x48, 0x7f, 0x6c, 0x87, 0xa4, 0x64, 0xcb, 0x71, 0x83, 0x2e, 0xf2, 0x60,
+  0x8a, 0x9c, 0x33, 0x97, 0x33, 0x33, 0xe4, 0x64, 0xf4, 0xec, 0xfc, 0xc3,
+  0xd9, 0xd5, 0x9f, 0x97, 0x53, 0xb2, 0xd4, 0x59, 0x3a, 0x69, 0x8d, 0xcc,
+  0x0f, 0x49, 0x69, 0xbe, 0x18, 0x7b, 0x85, 0xf6, 0x5f, 0x7d, 0xf4, 0x70,
+  0xef, 0x99, 0xef, 0xb7, 0x08, 0xb9, 0xa4, 0x3c, 0x87, 0x94, 0x30, 0x4a,
+  0x14, 0x4d, 0x69, 0x40, 0x2e, 0xbf, 0x7f, 0x5b, 0xf0, 0x9c, 0x12, 0x50,
+  0xfa, 0xfb, 0x37, 0xcd, 0x13, 0x1a, 0x12, 0xa1, 0xc8, 0x8a, 0xa6, 0x42,
+  0x82, 0x22, 0xc9, 0x12, 0x16, 0x34, 0x23, 0x85, 0x90, 0xa4, 0x47, 0x0b,
+  0xde, 0x83, 0x15, 0xe4, 0x5a, 0x91, 0xf6, 0x0c, 0xe4, 0x0a, 0xa4, 0x3f,
+  0xc3, 0x2f, 0x32, 0xb5, 0x7b, 0x9d, 0x2e, 0x2a, 0x17, 0xa5, 0x15, 0x4d,
+  0x44, 0xae, 0xca, 0x54, 0x53, 0x42, 0x1d, 0x4a, 0x69, 0xaa, 0x81, 0x40,
+  0x46, 0x72, 0xba, 0x42, 0x7d, 0xcc, 0xaa, 0x56, 0xf8, 0x6d, 0xa1, 0x33,
+  0x51, 0xca, 0x04, 0x02, 0x84, 0x9f, 0x43, 0x21, 0xb8, 0x22, 0x0c, 0x65,
+  0x19, 0xd7, 0x54, 0x76, 0x89, 0x84, 0x05, 0xe4, 0x20, 0x81, 0x08, 0x92,
+  0xd0, 0x18, 0xbe, 0xff, 0x4b, 0xd3, 0x25, 0x2e, 0x45, 0x56, 0x48, 0x9e,
+  0x71, 0x26, 0x48, 0x1b, 0xdd, 0xc0, 0x60, 0xd4, 0x32, 0x16, 0x54, 0xb2,
+  0xbf, 0x16, 0xf7, 0xc1, 0xb2, 0x13, 0xb4, 0x7c, 0xdf, 0x70, 0x00, 0x94,
+  0xe1, 0x4f, 0x06, 0xe8, 0x48, 0xb2, 0xa4, 0x52, 0x81, 0x1e, 0x7b, 0x9f,
+  0xae, 0x5e, 0xfb, 0x2f, 0xbd, 0x7a, 0x3b, 0xa7, 0x19, 0x8c, 0xbd, 0x15,
+  0x87, 0x1b, 0x74, 0x5b, 0x7b, 0xc6, 0x71, 0x8d, 0x1e, 0x8d, 0xbd, 0x1b,
+  0xce, 0xf4, 0x72, 0xcc, 0x60, 0xc5, 0x13, 0xf0, 0xed, 0x47, 0x97, 0xf0,
+  0x9c, 0x6b, 0x4e, 0x53, 0x5f, 0x25, 0x34, 0x85, 0xf1, 0xc0, 0x28, 0xd1,
+  0x5c, 0xa7, 0x30, 0x39, 0x43, 0x94, 0x14, 0x29, 0x18, 0xc7, 0x67, 0x48,
+  0xea, 0xa8, 0xe7, 0xf6, 0x5b, 0x23, 0xa5, 0xef, 0xcc, 0xaf, 0xc9, 0xc6,
+  0xc3, 0x1c, 0xa5, 0xfc, 0x39, 0xcd, 0x78, 0x7a, 0x17, 0xbe, 0x81, 0x74,
+  0x05, 0x86, 0xec, 0xee, 0xa9, 0x44, 0x95, 0x5d, 0x45, 0x73, 0xe5, 0x2b,
+  0x90, 0x7c, 0x1e, 0x69, 0xb8, 0xd5, 0x3e, 0x4d, 0xf9, 0x22, 0x0f, 0x13,
+  0x74, 0x05, 0xe4, 0xba, 0x15, 0x0b, 0x76, 0xf7, 0x10, 0xd3, 0xe4, 0x7a,
+  0x21, 0x45, 0x99, 0xb3, 0xf0, 0x60, 0x7e, 0x6c, 0xfe, 0xa2, 0x8c, 0xde,
+  0x3a, 0xdf, 0xc2, 0x17, 0xfd, 0x7e, 0x71, 0x8b, 0xdf, 0x12, 0x53, 0x19,
+  0xf6, 0x09, 0x2d, 0xb5, 0x58, 0xb7, 0x96, 0x83, 0x87, 0x44, 0x60, 0x1a,
+  0xc3, 0x83, 0xe1, 0x70, 0x88, 0x9f, 0xc3, 0xfa, 0xf3, 0xe4, 0xe4, 0x24,
+  0x8a, 0x85, 0x64, 0x98, 0x40, 0x2d, 0x8a, 0xf0, 0xa8, 0xb8, 0x25, 0x4a,
+  0xa4, 0x9c, 0x91, 0x83, 0x24, 0x49, 0xa2, 0x82, 0x32, 0xc6, 0xf3, 0x85,
+  0x3d, 0x1a, 0x9c, 0x6c, 0xd4, 0x3a, 0x51, 0x34, 0xb3, 0x6e, 0x15, 0x2e,
+  0x16, 0xc5, 0xef, 0x21, 0x1c, 0xbc, 0x34, 0x3b, 0x71, 0xa0, 0xdc, 0xde,
+  0x0d, 0xf0, 0xc5, 0x52, 0x87, 0xb1, 0x48, 0x19, 0xee, 0x96, 0x5a, 0x8b,
+  0x7c, 0xc7, 0xf3, 0xe3, 0xb3, 0xd3, 0xd7, 0x27, 0xfd, 0xca, 0x7a, 0x98,
+  0x8b, 0x1c, 0xa2, 0xca, 0xa9, 0xf9, 0x7c, 0x5e, 0x9b, 0x0e, 0x07, 0xc7,
+  0xe8, 0xd2, 0xd0, 0x84, 0xb4, 0x35, 0x74, 0x74, 0xb4, 0x8d, 0xd0, 0x2c,
+  0x93, 0x52, 0x2a, 0xc4, 0x61, 0xc1, 0x18, 0x92, 0xea, 0x78, 0x24, 0x65,
+  0xbc, 0x54, 0xa1, 0x73, 0xca, 0x9a, 0x0f, 0x1e, 0x79, 0x30, 0x3f, 0x3e,
+  0x1e, 0x0e, 0x5f, 0xac, 0x5b, 0x07, 0x99, 0x5a, 0x54, 0x84, 0xc4, 0x69,
+  0x09, 0xd1, 0x63, 0xf7, 0xa3, 0x26, 0x08, 0xfa, 0xd0, 0x6f, 0xfa, 0x67,
+  0x5c, 0xdb, 0xb5, 0x78, 0x62, 0x2c, 0x1e, 0x88, 0xf9, 0xbc, 0x26, 0x99,
+  0xf6, 0xfb, 0xeb, 0xd6, 0xa8, 0x57, 0x55, 0xc0, 0xa8, 0x57, 0x55, 0xa3,
+  0xc9, 0xa5, 0xa9, 0xcd, 0x41, 0xa3, 0x6a, 0xa8, 0xad, 0x1a, 0xe2, 0x93,
+  0xe9, 0xec, 0x72, 0x78, 0x84, 0xa2, 0x03, 0x94, 0x28, 0x08, 0x67, 0x63,
+  0x0f, 0x9d, 0xf4, 0xc8, 0x92, 0x33, 0x06, 0xf9, 0x64, 0xd4, 0x2b, 0x36,
+  0xfb, 0x68, 0x68, 0xb3, 0x3f, 0xc3, 0x46, 0xc2, 0xc2, 0x85, 0xdb, 0x43,
+  0xaa, 0x79, 0xca, 0x20, 0xb2, 0x0d, 0x62, 0x3a, 0xc6, 0x59, 0x30, 0xfd,
+  0x16, 0x54, 0xe0, 0xc9, 0x28, 0x9e, 0x5c, 0x41, 0x56, 0x80, 0xa4, 0xba,
+  0x94, 0x34, 0x1c, 0xf5, 0xe2, 0x09, 0x19, 0xa9, 0x82, 0xe6, 0x56, 0xad,
+  0xde, 0x1e, 0x79, 0x13, 0xdf, 0x47, 0xf7, 0xf1, 0x64, 0x72, 0xc8, 0x60,
+  0x11, 0x9d, 0x91, 0x43, 0x6c, 0x38, 0x26, 0x74, 0x44, 0x50, 0xc7, 0x27,
+  0x5c, 0x53, 0x06, 0x8f, 0xf1, 0xa5, 0xdb, 0x6e, 0x60, 0x7f, 0x69, 0x18,
+  0x36, 0x51, 0x56, 0x88, 0x98, 0x24, 0x29, 0x55, 0x6a, 0xec, 0x29, 0xcf,
+  0xc5, 0x93, 0x94, 0x48, 0x6e, 0x65, 0x14, 0x05, 0x9a, 0xb6, 0x2e, 0xb1,
+  0x35, 0x9f, 0xc2, 0x99, 0xb6, 0xdd, 0xa0, 0x9c, 0xa9, 0xe5, 0x70, 0x72,
+  0x91, 0xa2, 0x23, 0x39, 0x3d, 0x4c, 0x12, 0xbc, 0x47, 0xd2, 0x68, 0xc3,
+  0x0b, 0x52, 0x3b, 0xb4, 0xce, 0x4c, 0xf1, 0x46, 0x62, 0x22, 0xdc, 0xd7,
+  0x97, 0x96, 0xf7, 0xbb, 0xda, 0x5c, 0x11, 0xd9, 0xb3, 0xd8, 0x1c, 0x62,
+  0xb6, 0x34, 0xf5, 0xa5, 0xd0, 0x74, 0xec, 0xf5, 0x70, 0xa3, 0x57, 0x89,
+  0x5b, 0x31, 0x67, 0xfd, 0x33, 0xb6, 0x2d, 0x4f, 0xf7, 0xad, 0x93, 0xf6,
+  0x29, 0xf6, 0x65, 0x76, 0x48, 0x69, 0x52, 0x6a, 0x88, 0x4c, 0xfb, 0x77,
+  0x36, 0x1e, 0x9d, 0x26, 0x5c, 0x98, 0x5b, 0x38, 0x0b, 0x1b, 0x74, 0x52,
+  0xbb, 0x99, 0xa1, 0x3e, 0xb1, 0x97, 0x8e, 0x9a, 0xd7, 0x27, 0x43, 0x59,
+  0x39, 0x37, 0x12, 0x2a, 0xac, 0x59, 0x6a, 0xec, 0xed, 0x31, 0xf5, 0xb4,
+  0xaf, 0xef, 0x68, 0x5e, 0xd2, 0xb4, 0xf3, 0x73, 0xca, 0xb6, 0x76, 0x9e,
+  0x66, 0xae, 0x21, 0xb3, 0x43, 0xe0, 0x76, 0xff, 0x31, 0x8f, 0x2a, 0x91,
+  0xbc, 0xd0, 0x93, 0xd6, 0x8a, 0x4a, 0x02, 0x64, 0x4c, 0x1e, 0xd6, 0x51,
+  0x6b, 0x5e, 0xe6, 0x89, 0x46, 0x46, 0xc8, 0xf3, 0x36, 0x67, 0x1d, 0xf2,
+  0x80, 0xaf, 0x03, 0x56, 0x6a, 0x4e, 0x18, 0x56, 0x8f, 0x21, 0x29, 0x58,
+  0x80, 0x9e, 0xa6, 0x60, 0x96, 0xaf, 0xee, 0x2e, 0x98, 0x11, 0x8a, 0xc8,
+  0x7a, 0x0b, 0xc3, 0x4b, 0x95, 0xb6, 0x57, 0x0d, 0xe0, 0x8a, 0xfc, 0x46,
+  0xbc, 0xb7, 0x17, 0xbf, 0x9f, 0x9e, 0x9f, 0x7a, 0x24, 0x24, 0xde, 0xf9,
+  0x74, 0x56, 0x7d, 0xed, 0xe0, 0x32, 0xa1, 0xb4, 0xa4, 0xb2, 0xad, 0x10,
+  0x8a, 0xaf, 0x94, 0x71, 0x47, 0x45, 0xb8, 0x78, 0xde, 0xde, 0x69, 0x98,
+  0x4e, 0x60, 0xee, 0xee, 0x33, 0xf7, 0x84, 0x18, 0x99, 0xa0, 0x71, 0x5a,
+  0xc9, 0xd7, 0x0d, 0xb2, 0x2f, 0x5b, 0x9d, 0x54, 0x72, 0x75, 0x3f, 0xec,
+  0xcb, 0x55, 0x27, 0xc6, 0xf3, 0x0f, 0x67, 0x9f, 0x2e, 0x6b, 0xd7, 0xdf,
+  0x5e, 0x7c, 0xfe, 0x38, 0xf5, 0x2a, 0xb4, 0xeb, 0x8a, 0x7d, 0xac, 0xdd,
+  0x37, 0xc8, 0xd3, 0x57, 0xd3, 0x8f, 0x57, 0x0e, 0xf8, 0x7a, 0x7a, 0xf6,
+  0xc6, 0x46, 0xec, 0xa0, 0xa6, 0xc6, 0x1f, 0x03, 0x2d, 0x6f, 0x2a, 0xc0,
+  0xa3, 0x4e, 0x25, 0xd5, 0x2c, 0xcc, 0x7d, 0x33, 0x8d, 0xd3, 0x4a, 0xfe,
+  0x87, 0xb5, 0xf8, 0x84, 0x99, 0x1f, 0xc9, 0x76, 0xf6, 0xf4, 0xfc, 0x1c,
+  0x6d, 0x31, 0x5f, 0x6c, 0x40, 0x5d, 0xd2, 0x44, 0x7e, 0x0d, 0xe6, 0x42,
+  0x4e, 0x69, 0xb2, 0x6c, 0x6f, 0x32, 0xdc, 0xbe, 0x76, 0xa9, 0x25, 0xc4,
+  0xd4, 0x5b, 0x8c, 0xea, 0xd0, 0x58, 0xec, 0x91, 0x5f, 0xc9, 0xb5, 0x55,
+  0x43, 0x48, 0xfc, 0x38, 0xca, 0x2f, 0xd7, 0x5f, 0x0d, 0x93, 0xe7, 0xa0,
+  0x8c, 0x65, 0xe9, 0x92, 0x60, 0x57, 0x35, 0xc0, 0xb6, 0xc9, 0x7b, 0xe4,
+  0xa1, 0x21, 0x2e, 0x72, 0x2b, 0x68, 0x65, 0xd6, 0x56, 0x35, 0x9f, 0x13,
+  0x74, 0x1b, 0xc9, 0x52, 0x74, 0x01, 0x59, 0xed, 0x06, 0x9a, 0x37, 0x57,
+  0x7f, 0x27, 0xe0, 0x39, 0x8e, 0x3f, 0x6f, 0xae, 0xde, 0xbd, 0xb5, 0xcc,
+  0xd6, 0x62, 0xd1, 0xae, 0x90, 0x7b, 0x08, 0x50, 0x62, 0x4e, 0x53, 0x05,
+  0xee, 0x10, 0xa7, 0x9d, 0x2b, 0x9e, 0x81, 0x28, 0x75, 0x23, 0x4c, 0x53,
+  0xfb, 0xfb, 0x28, 0x2d, 0xf1, 0xfd, 0x23, 0xeb, 0x2e, 0x39, 0xe9, 0xf7,
+  0xfb, 0x55, 0xbc, 0x5b, 0x5b, 0x28, 0x50, 0xf9, 0xdb, 0x6a, 0xf4, 0x04,
+  0x2d, 0x52, 0xcc, 0x8b, 0x6c, 0x33, 0xe7, 0x31, 0x32, 0x8a, 0xa3, 0x18,
+  0x72, 0x77, 0x8d, 0x63, 0x12, 0xc1, 0x4d, 0x30, 0x01, 0x8f, 0x09, 0xc3,
+  0x1f, 0x83, 0xad, 0x5b, 0x08, 0x50, 0x7d, 0x53, 0x8b, 0xc6, 0x3b, 0x86,
+  0xdf, 0xe3, 0x41, 0xa5, 0x06, 0x34, 0xa6, 0xc5, 0xdb, 0x0e, 0x8d, 0x98,
+  0xba, 0x07, 0x9c, 0xfc, 0x70, 0x0c, 0x45, 0xd6, 0x72, 0xe1, 0xdb, 0xa5,
+  0x87, 0xd4, 0x59, 0x27, 0x03, 0xbd, 0x84, 0xbc, 0x11, 0x9e, 0x6c, 0xf4,
+  0xb6, 0x0c, 0xfe, 0x56, 0x22, 0x6f, 0x9b, 0x1b, 0xe0, 0xc7, 0xc2, 0xaa,
+  0x22, 0xc3, 0x3c, 0xa5, 0x7b, 0x64, 0xd4, 0xe1, 0xa9, 0x06, 0x3e, 0xa1,
+  0x7a, 0xa7, 0x66, 0x7e, 0x8c, 0x77, 0x29, 0xb0, 0xc9, 0x5d, 0xb7, 0x36,
+  0x37, 0xd3, 0x3f, 0x25, 0xc8, 0xbb, 0x19, 0xa4, 0x90, 0x68, 0x21, 0x4f,
+  0xd3, 0x14, 0xab, 0xcb, 0xde, 0x74, 0x88, 0xdc, 0x2f, 0xc6, 0xd8, 0x91,
+  0x11, 0xe3, 0xe8, 0x92, 0xa0, 0x1b, 0xd7, 0x46, 0x6b, 0xd3, 0xea, 0xa6,
+  0x50, 0xcd, 0x49, 0x1c, 0x70, 0x16, 0xa8, 0x32, 0x46, 0x7e, 0x71, 0x34,
+  0x69, 0x0f, 0xaa, 0xfc, 0x99, 0x63, 0x69, 0x80, 0x96, 0xd1, 0x38, 0x30,
+  0xb7, 0x2e, 0x96, 0x44, 0x60, 0x2e, 0x5e, 0x2c, 0xeb, 0x36, 0xd4, 0x05,
+  0x69, 0x06, 0x89, 0xd0, 0x16, 0x66, 0xa7, 0x6b, 0xd9, 0x63, 0x5c, 0xa2,
+  0x97, 0xb8, 0x95, 0xd9, 0x17, 0xc0, 0xab, 0xea, 0xd4, 0x55, 0xea, 0x33,
+  0x33, 0x26, 0x41, 0x07, 0xd9, 0xb5, 0x6c, 0x6e, 0xf2, 0x67, 0x45, 0xf0,
+  0x8a, 0x36, 0xb2, 0xc6, 0xb4, 0x15, 0x43, 0xf3, 0x37, 0x3c, 0x67, 0xe2,
+  0x26, 0x68, 0xcc, 0xf9, 0x68, 0x34, 0x87, 0x9b, 0xe6, 0xe4, 0x5f, 0xe5,
+  0xdb, 0xfd, 0x6b, 0xe1, 0x75, 0xd0, 0x9b, 0xbc, 0x4c, 0xd3, 0xa8, 0x65,
+  0xec, 0x55, 0xe6, 0x5c, 0x89, 0xe1, 0x12, 0x29, 0xc9, 0x40, 0x99, 0xba,
+  0xdc, 0x21, 0xc5, 0xf4, 0xcd, 0x26, 0x67, 0x7f, 0xcc, 0x3e, 0xbc, 0x0f,
+  0x0a, 0x33, 0xef, 0xb7, 0x33, 0x1b, 0x77, 0xc7, 0x24, 0x31, 0x6a, 0xa8,
+  0x10, 0x85, 0x4b, 0xd5, 0x4f, 0x52, 0x59, 0xf5, 0x45, 0x13, 0x09, 0x52,
+  0x0a, 0xf9, 0x3f, 0xa0, 0x75, 0x15, 0x20, 0x23, 0x04, 0x70, 0x69, 0x23,
+  0x68, 0x54, 0xbb, 0xd1, 0x89, 0xe9, 0xb8, 0x30, 0xb3, 0x2b, 0xfe, 0xaf,
+  0xb5, 0x25, 0xb2, 0x4b, 0x8e, 0x5c, 0x13, 0xda, 0xe1, 0xb1, 0x7a, 0x04,
+  0xf1, 0x5d, 0x74, 0x63, 0x63, 0xcf, 0xfd, 0x7b, 0xf7, 0x1f, 0x40, 0x4a,
+  0x2f, 0xf8, 0xef, 0x0d, 0x00, 0x00
+};
+const size_t dashboardHtmlGzTamanho = sizeof(dashboardHtmlGz);
@@ -13,21 +13,32 @@
  * - Desligamento automático de luz/ventoinha manual por ausência.
  * - Interface de controle web via Wi-Fi com atualização automática.
  * - Display LCD I2C para feedback local.
+ *
+ * O servidor web roda numa tarefa presa ao núcleo 0; sensores e atuadores rodam no
+ * loop() (núcleo 1). Os dois lados só trocam dados por filas de um produtor e um
+ * consumidor: comandos (web -> controle) e instantâneos de estado (controle -> web).
  */
 
 // ==============================================================================
 // BIBLIOTECAS
 // ==============================================================================
 
+#include <Arduino.h>           // API do Arduino (obrigatória em .cpp, fora da IDE)
 #include <SPI.h>               // Comunicação SPI (usada pelo RFID)
 #include <MFRC522.h>           // Biblioteca do leitor RFID MFRC522
 #include <Wire.h>              // Comunicação I2C (usada pelo LCD)
 #include <LiquidCrystal_I2C.h> // Biblioteca para LCD I2C
-#include <DHT.h>               // Biblioteca para sensor DHT11 (temperatura/umidade)
 #include <WiFi.h>              // Biblioteca para conexão Wi-Fi
-#include <WebServer.h>         // Biblioteca para servidor web embutido
-#include <Ultrasonic.h>        // Biblioteca para sensor ultrassônico
+#include <lwip/sockets.h>     // Sockets não bloqueantes do servidor HTTP
 #include <ESP32Servo.h>        // Biblioteca para controle de servo motor no ESP32
+#include <esp_timer.h>         // Timer de alta resolução (ultrassônico e DHT11)
+#include <esp_partition.h>     // Partição da tabela de usuários (flash mapeada)
+#include <esp_rom_crc.h>       // CRC32 das imagens da tabela de usuários
+#include <esp_heap_caps.h>     // Maior bloco livre do heap (/metrics)
+#include <stdarg.h>            // Formatação incremental do texto de /metrics
+#include <time.h>              // Hora local (SNTP) para os horários de acesso
+#include <atomic>              // Índices atômicos das filas entre os núcleos
+#include "dashboard_gz.h"      // Painel estático comprimido (gerado a partir de dashboard.html)
 
 // ==============================================================================
 // CONFIGURAÇÕES E CONSTANTES
@@ -35,14 +46,23 @@
 
 const char *ssid1 = "Wifi2";      // Nome da rede Wi-Fi
 const char *password1 = "01010101";          // Senha da rede Wi-Fi
-const int DISTANCIA_PRESENCA_CM = 20;       // Distância máxima para considerar presença (em cm)
+const char *tokenAdministrador = "";       // "Authorization: Bearer ..." das rotas /usuarios (vazio = rotas recusadas)
+const size_t TAMANHO_MIN_TOKEN = 16;        // Token mais curto conta como não configurado
+const int DISTANCIA_PRESENCA_CM = 20;       // Distância filtrada que marca a sala como ocupada (em cm)
+const int DISTANCIA_AUSENCIA_CM = 30;       // Distância filtrada que marca a sala como vazia (histerese)
 String mensagemSistema = "";                // Mensagem do sistema para feedback na web/LCD
 int tempacionamento = 25;                   // Temperatura para ligar ventoinha automática
 int tempdesligamento = 22;                  // Temperatura para desligar ventoinha automática
+const char *servidorNtp = "pool.ntp.org";   // Servidor SNTP (pode ser um servidor local da rede)
+const char *fusoHorario = "<-03>3";         // Fuso horário POSIX (Brasília, UTC-3)
+const time_t EPOCH_MINIMO_SNTP = 1700000000; // Antes disto o relógio ainda não foi acertado pelo SNTP
 
 // Definição dos pinos do ESP32 para cada periférico
-const byte PINO_RFID_SS = 5;                // Pino SS do RFID
-const byte PINO_RFID_RST = 0;               // Pino RST do RFID
+const byte PINO_RFID_SS_ENTRADA = 5;        // Pino SS do RFID de entrada
+const byte PINO_RFID_SS_SAIDA = 27;         // Pino SS do RFID de saída (mesmo barramento SPI)
+const byte PINO_RFID_RST = 0;               // Pino RST dos leitores RFID (compartilhado)
+const byte PINO_RFID_IRQ_ENTRADA = 34;      // Pino IRQ do RFID de entrada (somente entrada)
+const byte PINO_RFID_IRQ_SAIDA = 35;        // Pino IRQ do RFID de saída (somente entrada)
 const byte PINO_DHT = 15;                   // Pino do sensor DHT11
 const byte PINO_BUZZER = 32;                // Pino do buzzer
 const byte PINO_TRIG = 16;                  // Pino TRIG do ultrassônico
@@ -69,29 +89,433 @@ unsigned long tempoInicioPresenca = 0;
 // ESTRUTURAS DE DADOS
 // ==============================================================================
 
+/**
+ * @brief Contador com um único escritor, lido sem trava pelo outro núcleo.
+ * @details Quem incrementa é sempre o mesmo lado (controle, web, timer ou uma ISR), então
+ * ler-somar-gravar relaxado basta e não custa uma instrução atômica de RMW; o leitor só
+ * precisa de um valor inteiro, não de ordem entre contadores. De 64 bits não é lock-free no
+ * ESP32 (a libatomic do IDF usa uma seção crítica, válida também em ISR).
+ */
+template <typename T>
+class ContadorCompartilhado {
+public:
+  void operator++(int) { valor.store(valor.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+  void operator+=(T n) { valor.store(valor.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+  T ler() const { return valor.load(std::memory_order_relaxed); }
+  operator T() const { return ler(); }
+
+private:
+  std::atomic<T> valor{0};
+};
+
+const byte TAMANHO_MAX_UID = 10;            // MIFARE: UIDs de 4, 7 ou 10 bytes
+
+union ChaveUID {                            // UID de tamanho variável em 12 bytes alinhados
+  struct {
+    byte tamanho;                           // Bytes válidos do UID (4, 7 ou 10)
+    byte bytes[TAMANHO_MAX_UID];            // UID; bytes além do tamanho ficam em zero
+    byte reserva;                           // Sempre zero
+  } uid;
+  uint32_t palavras[3];                     // Mesma memória vista como palavras (compara/espalha)
+};
+
+// Horários de acesso: cada usuário aponta para um horário; o horário 0 libera 24h por dia.
+const byte HORARIO_SEMPRE = 0;              // Sem restrição
+const byte HORARIO_COMERCIAL = 1;           // Segunda a sexta, 07:00 às 19:00
+const byte MAX_HORARIOS = 8;                // Horários compilados em mapas de bits
+
+const byte DOMINGO = 1 << 0, SEGUNDA = 1 << 1, TERCA = 1 << 2, QUARTA = 1 << 3, QUINTA = 1 << 4,
+           SEXTA = 1 << 5, SABADO = 1 << 6; // Máscaras de dias da semana (tm_wday)
+
+struct RegraHorario {                       // Faixa liberada de um horário
+  byte horario;                             // Horário ao qual a regra pertence
+  byte dias;                                // Máscara de dias da semana
+  byte inicioQuarto;                        // Primeiro quarto de hora liberado (0..95)
+  byte fimQuarto;                           // Quarto de hora final, exclusivo (1..96)
+};
+
+const RegraHorario regrasHorarios[] = {     // Regras compiladas em mapasHorarios[] no setup()
+    {HORARIO_COMERCIAL, SEGUNDA | TERCA | QUARTA | QUINTA | SEXTA, 7 * 4, 19 * 4},
+};
+
 struct Usuario {                            // Estrutura para armazenar usuários autorizados
-  byte uid[4];                              // UID do cartão RFID (4 bytes)
+  ChaveUID chave;                           // UID do cartão RFID
+  byte horario;                             // Horário de acesso (HORARIO_*)
   const char *nome;                         // Nome do usuário
 };
 
 const Usuario usuariosAutorizados[] = {     // Lista de usuários autorizados
-    {{207, 219, 197, 196}, "Anne Beatriz"},
-    {{30, 157, 226, 105}, "Victor Augusto"}
+    {{{4, {207, 219, 197, 196}}}, HORARIO_SEMPRE, "Anne Beatriz"},
+    {{{4, {30, 157, 226, 105}}}, HORARIO_SEMPRE, "Victor Augusto"}
 };
 const int totalUsuarios = sizeof(usuariosAutorizados) / sizeof(usuariosAutorizados[0]); // Total de usuários
 
+// Formato da tabela de usuários na partição "usuarios" (dois slots A/B, little-endian):
+// [CabecalhoTabela][uint16 índice x capacidadeIndice][RegistroUsuario x quantidade]
+// O índice é hash com sondagem linear (hashChave) e guarda a posição do registro.
+struct CabecalhoTabela {
+  uint32_t magico;                          // MAGICO_TABELA_USUARIOS
+  uint32_t geracao;                         // Maior geração válida = imagem ativa
+  uint32_t quantidade;                      // Registros na imagem
+  uint32_t capacidadeIndice;                // Posições do índice (potência de 2)
+  uint32_t crc;                             // CRC32 do índice + registros
+  uint32_t reservado[3];
+};
+
+struct RegistroUsuario {                    // Registro de 32 bytes
+  ChaveUID chave;                           // UID do cartão
+  byte horario;                             // Horário de acesso (HORARIO_*)
+  char nome[19];                            // Nome terminado em '\0'
+};
+static_assert(sizeof(RegistroUsuario) == 32, "Formato da tabela na flash mudou");
+
+enum EtapaGravacao : byte {                 // Web: trabalho longo da gravação, um passo por volta da rede
+  ETAPA_RECEBENDO,                          // Nada pendente: o corpo pode chegar
+  ETAPA_APAGANDO_SLOT,                      // CSV: apaga um setor (índice e registros) por passo, antes do corpo
+  ETAPA_CALCULANDO_CRC,                     // CRC do conteúdo, um bloco por passo, depois do corpo
+  ETAPA_CRC_PRONTO                          // CRC em 'crc': o cabeçalho pode ser gravado
+};
+
+struct GravacaoTabela {                     // Web: imagem sendo gravada no slot inativo
+  bool ativa;                               // false também após erro de flash: nada será publicado
+  EtapaGravacao etapa;
+  uint32_t base;                            // Offset do slot na partição
+  uint32_t geracao;                         // Geração que a imagem receberá
+  uint32_t recebidos;                       // Bytes recebidos (relativo ao slot)
+  uint32_t apagadoAte;                      // Setores já apagados (relativo ao slot)
+  uint32_t crc;                             // CRC parcial do conteúdo (ETAPA_CALCULANDO_CRC)
+  uint32_t crcAte;                          // Bytes do conteúdo já incluídos em 'crc'
+  CabecalhoTabela cabecalho;                // Gravado por último
+};
+
+struct LeituraRecente {                     // Entrada da tabela anti-repetição do RFID
+  ChaveUID chave;                           // Cartão visto recentemente
+  unsigned long ultimoMs;                   // Última vez que foi lido (ou fim do feedback)
+};
+
+const int MAX_LEITURAS_RECENTES = 4;        // Cartões lembrados pela tabela anti-repetição de cada leitor
+
+const int MAX_LEITORES_RFID = 4;            // Leitores que cabem no rodízio do barramento SPI
+
+struct PinosLeitorRFID {                    // Ligação de um leitor na placa
+  byte pinoSS;                              // Chip select
+  byte pinoIRQ;                             // Linha IRQ
+  const char *nome;                         // Nome para logs e relatórios
+};
+
+struct LeitorRFID {                         // Um MFRC522 no barramento SPI compartilhado
+  byte pinoSS;                              // Chip select deste leitor
+  byte pinoIRQ;                             // Linha IRQ (nível baixo = cartão respondeu)
+  MFRC522 rfid;                             // Driver (SS próprio, RST compartilhado)
+  const char *nome;                         // Nome para logs e relatórios
+  LeituraRecente recentes[MAX_LEITURAS_RECENTES]; // Tabela anti-repetição deste leitor
+  volatile bool cartaoNoCampo;              // Marcado pela interrupção; limpo por lerRfid()
+  unsigned long ultimoReqaMs;               // Última vez que o REQA foi armado
+  ContadorCompartilhado<unsigned long> consultas; // Vezes que o leitor foi consultado (REQA armado ou leitura)
+  unsigned long interrupcoes;               // Respostas sinalizadas pela linha IRQ
+  ContadorCompartilhado<unsigned long> cartoes; // Cartões novos lidos (após a anti-repetição)
+  ContadorCompartilhado<unsigned long> suprimidas; // Leituras repetidas ignoradas
+  unsigned long consultaMaxUs;              // Maior duração de uma consulta (SPI)
+  unsigned long ultimaConsultaMs;           // Instante da última consulta
+  unsigned long intervaloMaxMs;             // Maior intervalo entre duas consultas
+  ChaveUID pendente;                        // Cartão lido durante o feedback de outro leitor
+  bool temPendente;                         // 'pendente' espera o fim do feedback para ser decidido
+};
+
+enum TipoEvento : byte {                    // Decisões de acesso registradas no log
+  EVENTO_ABERTURA,                          // Usuário autorizado abriu a porta
+  EVENTO_FECHAMENTO,                        // Mesmo usuário fechou a porta
+  EVENTO_JA_ABERTA,                         // Porta já aberta por outro usuário
+  EVENTO_NEGADO,                            // Cartão não cadastrado
+  EVENTO_FORA_HORARIO                       // Cartão cadastrado fora do seu horário
+};
+
+struct EventoAcesso {                       // Registro binário de 16 bytes (16 por página da flash)
+  uint32_t instante;                        // Hora UTC do SNTP (epoch, s) ou, sem hora, millis() da decisão
+  byte tipo : 7;                            // TipoEvento
+  byte sincronizado : 1;                    // 1 = 'instante' é hora UTC; 0 = millis() do boot 'boot'
+  byte tamanhoUid : 4;                      // Bytes válidos em 'uid'
+  byte boot : 4;                            // Contador de boots (mod 16): ordena eventos sem hora entre resets
+  byte uid[TAMANHO_MAX_UID];                // UID do cartão
+};
+static_assert(sizeof(EventoAcesso) == 16, "Formato do log na flash mudou");
+
+const uint32_t CAPACIDADE_ANEL_EVENTOS = 128; // Eventos retidos na RTC (2 KB)
+
+struct AnelEventos {                        // Anel na memória RTC: sobrevive a resets por software
+  uint32_t magico;                          // MAGICO_ANEL_EVENTOS se o conteúdo é válido
+  std::atomic<uint32_t> escrita;            // Total de eventos produzidos (só cresce)
+  std::atomic<uint32_t> lida;               // Total de eventos já gravados na flash
+  uint32_t boots;                           // Boots contados (continua do último evento da flash ao ligar)
+  EventoAcesso eventos[CAPACIDADE_ANEL_EVENTOS];
+};
+
+enum ResultadoInsercao : byte {             // Resultado de inserir um usuário na imagem em construção
+  RESULTADO_INSERIDO,
+  RESULTADO_DUPLICADO,
+  RESULTADO_CHEIA,                          // CAPACIDADE_USUARIOS_FLASH atingida
+  RESULTADO_FALHA                           // Erro de flash (a gravação é cancelada)
+};
+
+struct LeitorCSV {                          // Web: estado do parser de CSV entre trechos do upload
+  byte campo;                               // 0 = uid_hex, 1 = nome, 2 = horario
+  byte uid[TAMANHO_MAX_UID];                // Bytes do UID montados a cada dois dígitos
+  byte digitosUid;                          // Dígitos hexadecimais lidos
+  char nome[sizeof(RegistroUsuario::nome)]; // Nome da linha atual
+  byte tamanhoNome;
+  int horario;                              // Horário de acesso (vazio = HORARIO_SEMPRE)
+  bool linhaVazia;                          // Nenhum caractere na linha ainda
+  bool linhaInvalida;                       // Algum campo malformado
+  uint32_t linhas, importados, duplicados, rejeitados;
+  uint32_t excedentes;                      // Linhas válidas além da capacidade (cancelam a importação)
+};
+
+// Menor potência de 2 maior ou igual a n (avaliada em tempo de compilação)
+constexpr int potenciaDeDois(int n) { return n <= 1 ? 1 : 2 * potenciaDeDois((n + 1) / 2); }
+
+// Índice hash dos usuários (endereçamento aberto, ocupação máxima de 50%), montado no setup()
+const int CAPACIDADE_INDICE_UID = potenciaDeDois(2 * totalUsuarios);
+const int16_t POSICAO_VAZIA = -1;
+int16_t indiceUID[CAPACIDADE_INDICE_UID];   // Posição em usuariosAutorizados[], ou POSICAO_VAZIA
+
+const uint32_t MAGICO_TABELA_USUARIOS = 0x32525355; // "USR2" (registros com horário)
+const esp_partition_subtype_t SUBTIPO_PARTICAO_USUARIOS = (esp_partition_subtype_t)0x40; // Ver partitions.csv
+const uint32_t TAMANHO_SLOT_TABELA = 0x30000; // Cada slot (A e B) ocupa 192 KB
+const uint32_t TAMANHO_SETOR_FLASH = 4096;
+const uint32_t CAPACIDADE_USUARIOS_FLASH = 4096;
+const uint32_t CAPACIDADE_INDICE_FLASH = 8192; // 16 KB de índice + 128 KB de registros cabem no slot
+const uint16_t POSICAO_LIVRE_FLASH = 0xFFFF;   // Flash apagada
+
+const uint32_t MAGICO_ANEL_EVENTOS = 0x32545645; // "EVT2" (instante com hora SNTP e boot)
+const esp_partition_subtype_t SUBTIPO_PARTICAO_EVENTOS = (esp_partition_subtype_t)0x41; // Ver partitions.csv
+const uint32_t TAMANHO_PAGINA_FLASH = 256;  // Unidade de programação da flash
+const uint32_t EVENTOS_POR_PAGINA = TAMANHO_PAGINA_FLASH / sizeof(EventoAcesso);
+RTC_NOINIT_ATTR AnelEventos anelEventos;    // Não é zerado no boot
+const esp_partition_t *particaoEventos = nullptr; // Log circular na flash (nullptr = só RTC)
+uint32_t offsetLogEventos = 0;              // Próxima página a gravar na partição
+const uint32_t SETOR_EVENTOS_NENHUM = 0xFFFFFFFF;
+std::atomic<uint32_t> setorEventosEmUso{0}; // Controle: setor do log que está recebendo páginas
+std::atomic<uint32_t> setorEventosApagado{SETOR_EVENTOS_NENHUM}; // Web: setor seguinte, já apagado
+unsigned long eventosDescartados = 0;       // Anel cheio
+unsigned long paginasEventosGravadas = 0;   // Páginas gravadas na flash desde o boot
+
+const int QUARTOS_POR_DIA = 96;             // Resolução dos horários: 15 minutos
+uint8_t mapasHorarios[MAX_HORARIOS][7][QUARTOS_POR_DIA / 8]; // Bit = acesso liberado naquele quarto de hora
+
+// Filtro de Bloom na frente do índice: 8 bits por usuário na capacidade máxima, 4 hashes (~2,4% de falsos positivos)
+const uint32_t BITS_BLOOM = 8 * CAPACIDADE_USUARIOS_FLASH;
+const int HASHES_BLOOM = 4;
+uint32_t filtroBloom[BITS_BLOOM / 32];      // Controle: refeito a cada troca de tabela
+ContadorCompartilhado<unsigned long> consultasBloom; // Controle: UIDs testados no filtro
+ContadorCompartilhado<unsigned long> rejeitadosBloom; // Controle: descartados sem tocar no índice
+ContadorCompartilhado<unsigned long> falsosPositivosBloom; // Controle: passaram no filtro mas não estavam no índice
+
+// Ações possíveis de um passo do feedback de acesso (LCD, buzzer e servo)
+enum AcaoPasso : byte {
+  PASSO_LCD,                                // Limpa o LCD e escreve duas linhas
+  PASSO_TOM,                                // Toca uma nota no buzzer
+  PASSO_SILENCIO,                           // Para o buzzer
+  PASSO_SOLTA_SERVO,                        // Desanexa o servo (proteção)
+  PASSO_PRENDE_SERVO,                       // Reanexa o servo
+  PASSO_POSICIONA_SERVO,                    // Move o servo para 'valor' microssegundos
+  PASSO_FIM                                 // Encerra a sequência
+};
+
+struct PassoFeedback {                      // Um passo da sequência de feedback
+  AcaoPasso acao;                           // O que fazer
+  int valor;                                // Frequência do tom (Hz) ou posição do servo (us)
+  unsigned int duracao;                     // Duração do tom (ms)
+  const char *linha1;                       // Primeira linha do LCD (PASSO_LCD)
+  const char *linha2;                       // Segunda linha do LCD (PASSO_LCD)
+  unsigned int espera;                      // Tempo até o próximo passo (ms)
+};
+
+const int FAIXAS_HISTOGRAMA = 16;           // Faixas log2 do histograma de tempo de execução (us)
+
+struct Tarefa {                             // Tarefa periódica do escalonador cooperativo
+  const char *nome;                         // Nome (para relatórios)
+  void (*funcao)();                         // Função executada
+  unsigned long periodoUs;                  // Período (0 = toda volta, PERIODO_EVENTO = só quando sinalizada)
+  byte prioridade;                          // 0 = mais prioritária
+  unsigned long orcamentoUs;                // Tempo máximo esperado por execução
+  unsigned long proximaUs;                  // Instante (micros) da próxima execução
+  bool sinalizada;                          // Tarefa por evento pendente
+  unsigned long execucoes;                  // Quantidade de execuções
+  unsigned long ultimoUs;                   // Duração da última execução
+  unsigned long maximoUs;                   // Maior duração observada
+  unsigned long prazosPerdidos;             // Execuções que começaram mais de um período atrasadas
+  unsigned long estourosOrcamento;          // Execuções que passaram do orçamento
+  unsigned long histograma[FAIXAS_HISTOGRAMA]; // Faixa i: duração em [2^i, 2^(i+1)) us
+};
+
+enum TipoComando : byte {                   // Comandos enviados pelo servidor web ao controle
+  CMD_LUZ,                                  // Liga/desliga a luz
+  CMD_VENTILACAO,                           // Liga/desliga a ventoinha manual
+  CMD_LOTE                                  // Várias saídas de uma vez (POST /api/commands)
+};
+const int TIPOS_COMANDO = CMD_LOTE + 1;
+
+const byte ALVO_LUZ = 0x01;                 // Bits de 'alvos'/'valores' de um lote
+const byte ALVO_VENTILACAO = 0x02;
+
+struct Comando {                            // Comando da fila web -> controle
+  TipoComando tipo;
+  bool ligar;
+  byte alvos;                               // CMD_LOTE: saídas incluídas (ALVO_*)
+  byte valores;                             // CMD_LOTE: bit ligado = ligar a saída
+  uint16_t lote;                            // CMD_LOTE: identifica a conexão que espera o resultado
+  uint32_t enfileiradoUs;                   // micros() ao entrar na fila (latência até o acionamento)
+};
+
+struct ResultadoLote {                      // Resposta do controle a um CMD_LOTE
+  uint16_t lote;
+  bool aplicado;                            // false = nada foi alterado
+  byte rejeitados;                          // Saídas que violaram a regra de ocupação (ALVO_*)
+  uint32_t versao;                          // 'versaoEstado' depois do lote
+  bool iluminacao;
+  bool ventilacao;
+};
+
+const int JANELA_ULTRASSOM = 7;             // Amostras na mediana móvel (7 x 60ms)
+
+struct FiltroDistancia {                    // Mediana móvel + média exponencial das distâncias
+  uint16_t janela[JANELA_ULTRASSOM];        // Amostras na ordem de chegada (anel)
+  uint16_t ordenadas[JANELA_ULTRASSOM];     // As mesmas amostras, em ordem crescente
+  byte proxima;                             // Posição do anel a substituir
+  byte preenchidas;                         // Amostras válidas (até JANELA_ULTRASSOM)
+  int32_t mediaX16;                         // EMA da mediana em 1/16 cm
+};
+
+struct AmostraDHT {                         // Leitura do DHT11 publicada pela aquisição em segundo plano
+  float umidade;                            // Umidade relativa (%)
+  float temperatura;                        // Temperatura (°C)
+  unsigned long instanteMs;                 // millis() da leitura
+  bool valida;                              // false = timeout ou checksum inválido
+};
+
+enum EtapaDHT : byte {                      // Etapas da aquisição do DHT11
+  DHT_OCIOSO,                               // Aguardando a próxima leitura
+  DHT_PULSO_INICIO,                         // Linha em nível baixo (>= 18ms) pedindo leitura
+  DHT_CAPTURANDO                            // Bordas de descida sendo gravadas pela ISR
+};
+
+struct ContadorSaida {                      // Estatísticas de uma saída liga/desliga (para /metrics)
+  bool ligada;
+  uint32_t acionamentos;                    // Trocas de estado
+  uint32_t ligadaSegundos;                  // Tempo ligada acumulado (desligamentos já contados)
+  uint32_t restoMs;                         // Fração de segundo ainda não somada
+  unsigned long ligadaDesdeMs;              // Quando ligou (vale se 'ligada')
+};
+
+struct EstadoSala {                         // Instantâneo publicado pelo controle para a web
+  uint32_t versao;                          // 'versaoEstado' no momento da publicação
+  int temperatura;
+  int umidade;
+  bool ocupacao;
+  bool iluminacao;
+  bool ventilacao;
+  bool ventilacaoAutomatica;
+  bool portaAberta;
+  char mensagem[96];                        // Mensagem do sistema ("" = nenhuma nova)
+  ContadorSaida contadorLuz;                // Cópias dos contadores das saídas (para /metrics)
+  ContadorSaida contadorVentilacao;
+  ContadorSaida contadorVentilacaoAuto;
+};
+
+enum EstadoConexao : byte {                 // Fase de uma conexão do servidor HTTP
+  CONEXAO_LIVRE,                            // Vaga disponível no pool
+  CONEXAO_LENDO_CABECALHO,                  // Acumulando a linha de requisição e os cabeçalhos
+  CONEXAO_LENDO_CORPO,                      // Recebendo o corpo (upload em trechos ou corpo pequeno inteiro)
+  CONEXAO_ENVIANDO,                         // Resposta montada; fecha ao terminar de enviar
+  CONEXAO_EVENTOS,                          // Canal SSE aberto; recebe eventos de difundirEstado()
+  CONEXAO_AGUARDANDO_CONTROLE,              // Lote de comandos enfileirado; espera o ResultadoLote
+  CONEXAO_AGUARDANDO_TABELA                 // Upload parado enquanto avancarGravacaoTabela() trabalha na flash
+};
+
+const size_t TAMANHO_BUFFER_CONEXAO = 2304; // Requisição recebida e, depois, a resposta (cabeçalho + página)
+
+struct Conexao;
+
+struct Rota {                               // Rota do servidor HTTP
+  const char *metodo;                       // "GET", "POST" ou nullptr (qualquer método)
+  const char *caminho;                      // Caminho exato, sem a query string
+  void (*atender)(Conexao &c);              // Monta a resposta (depois do corpo, se houver)
+  bool (*iniciarCorpo)(Conexao &c);         // Upload: prepara a recepção (false = já respondeu com erro)
+  void (*receberCorpo)(const uint8_t *dados, size_t tamanho); // Upload: um trecho do corpo
+  size_t corpoMaximo;                       // > 0: corpo pequeno, entregue inteiro em 'buffer' (com '\0')
+};
+
+struct Conexao {                            // Conexão do pool do servidor HTTP
+  int soquete;                              // Socket não bloqueante (-1 = vaga livre)
+  EstadoConexao estado;
+  unsigned long abertaMs;                   // Instante do accept()
+  unsigned long ultimoMs;                   // Última atividade (tempo limite por conexão)
+  const Rota *rota;                         // Rota da requisição atual
+  size_t corpoRestante;                     // Bytes do corpo ainda por receber
+  uint16_t lote;                            // Lote de comandos aguardado (CONEXAO_AGUARDANDO_CONTROLE)
+  char buffer[TAMANHO_BUFFER_CONEXAO];      // Entrada (requisição) e, depois, saída (resposta)
+  size_t usados;                            // Bytes válidos em 'buffer'
+  size_t enviados;                          // Bytes de 'buffer' já enviados
+  const char *corpoExterno;                 // Corpo enviado sem cópia depois de 'buffer' (ou nullptr)
+  size_t corpoExternoTamanho;
+  size_t corpoExternoEnviado;
+};
+
+/**
+ * @brief Fila circular sem trava para exatamente um produtor e um consumidor.
+ * @details Usada entre a tarefa de rede (núcleo 0) e o loop de controle (núcleo 1).
+ * Comporta N-1 itens.
+ */
+template <typename T, size_t N>
+class FilaSPSC {
+public:
+  bool enfileirar(const T &item) {          // Chamado só pelo produtor
+    size_t atual = cauda.load(std::memory_order_relaxed);
+    size_t proxima = (atual + 1) % N;
+    if (proxima == cabeca.load(std::memory_order_acquire)) return false; // Fila cheia
+    itens[atual] = item;
+    cauda.store(proxima, std::memory_order_release);
+    return true;
+  }
+
+  bool desenfileirar(T &item) {             // Chamado só pelo consumidor
+    size_t atual = cabeca.load(std::memory_order_relaxed);
+    if (atual == cauda.load(std::memory_order_acquire)) return false; // Fila vazia
+    item = itens[atual];
+    cabeca.store((atual + 1) % N, std::memory_order_release);
+    return true;
+  }
+
+private:
+  T itens[N];
+  std::atomic<size_t> cabeca{0};            // Próximo item a consumir
+  std::atomic<size_t> cauda{0};             // Próxima posição livre
+};
+
+const unsigned long janelaRepeticaoMs = 3000; // Leituras do mesmo cartão dentro da janela são ignoradas
+const unsigned long intervaloReqaMs = 100;  // Cadência do REQA transmitido por cada leitor
+
 bool portaAberta = false;                   // Estado da porta (aberta/fechada)
-byte ultimoUID[4] = {0, 0, 0, 0};           // UID do último usuário que abriu a porta
+ChaveUID ultimoUID = {};                    // UID do último usuário que abriu a porta
+ChaveUID chaveFeedback = {};                // Cartão que disparou o feedback em andamento
+int leitorFeedback = 0;                     // Leitor que leu esse cartão
+int proximoLeitor = 0;                      // Rodízio entre os leitores
 
 // ==============================================================================
 // INSTÂNCIAS DE OBJETOS
 // ==============================================================================
 
 LiquidCrystal_I2C lcd(LCD_ENDERECO, LCD_COLUNAS, LCD_LINHAS); // LCD I2C
-MFRC522 rfid(PINO_RFID_SS, PINO_RFID_RST);                    // Leitor RFID
-DHT dht(PINO_DHT, DHT11);                                     // Sensor DHT11
-Ultrasonic ultrasonic1(PINO_TRIG, PINO_ECHO);                 // Sensor ultrassônico
-WebServer server(80);                                         // Servidor web na porta 80
+const PinosLeitorRFID leitoresPlaca[] = {                     // Leitores RFID ligados na placa
+    {PINO_RFID_SS_ENTRADA, PINO_RFID_IRQ_ENTRADA, "entrada"},
+    {PINO_RFID_SS_SAIDA, PINO_RFID_IRQ_SAIDA, "saida"},
+};
+const PinosLeitorRFID *pinosLeitores = leitoresPlaca;         // Leitores usados (o simulador de host troca)
+int quantidadeLeitores = sizeof(leitoresPlaca) / sizeof(leitoresPlaca[0]);
+LeitorRFID leitores[MAX_LEITORES_RFID];                       // Leitores RFID (um consultado por vez)
+int totalLeitores = 0;                                        // Leitores iniciados por iniciarLeitoresRfid()
+esp_timer_handle_t timerDht = nullptr;                        // Timer das etapas de leitura do DHT11
+esp_timer_handle_t timerUltrassom = nullptr;                  // Timer que dispara o TRIG
 
 // ==============================================================================
 // VARIÁVEIS GLOBAIS DE ESTADO
@@ -101,24 +525,265 @@ bool ventilacaoState = false;               // Estado da ventoinha manual
 bool iluminacaoState = false;               // Estado da luz
 bool ocupacao = false;                      // Estado de ocupação da sala
 int temperaturaAtual = 0;                   // Temperatura lida do sensor
+int umidadeAtual = 0;                       // Umidade relativa lida do sensor (%)
 bool ventilacaoAutomaticaState = false;     // Estado da ventoinha automática
-unsigned long millisAnterior = 0;           // Armazena o tempo da última leitura de temperatura
+uint32_t versaoEstado = 1;                  // Controle: incrementada a cada mudança do estado publicado
+ContadorSaida saidaLuz = {};                // Controle: estatísticas das saídas (publicadas em EstadoSala)
+ContadorSaida saidaVentilacao = {};
+ContadorSaida saidaVentilacaoAuto = {};
+ContadorCompartilhado<uint32_t> eventosPorTipo[EVENTO_FORA_HORARIO + 1]; // Controle: decisões de acesso por TipoEvento
+ContadorCompartilhado<uint32_t> voltasLoop; // Controle: chamadas de executarEscalonador()
+std::atomic<uint32_t> voltaMaxUs{0};        // Controle: maior volta desde a última coleta de /metrics
+std::atomic<uint32_t> coletasVoltaMax{0};   // Web: coletas de /metrics; o controle reabre a janela ao ver uma nova
+uint32_t coletaVoltaVista = 0;              // Controle: última coleta já vista
 const long intervaloLeituraTemp = 5000;     // Intervalo entre leituras de temperatura (ms)
 bool luzDesligadaManualmente = false;       // NOVO: Flag para indicar que a luz foi desligada manualmente com a sala ocupada
 
+const int MAX_PASSOS_FEEDBACK = 24;         // Tamanho máximo de um roteiro de feedback
+PassoFeedback sequenciaFeedback[MAX_PASSOS_FEEDBACK]; // Roteiro do feedback em andamento
+int totalPassos = 0;                        // Quantidade de passos no roteiro
+int passoAtual = 0;                         // Próximo passo a executar
+unsigned long proximoPassoMs = 0;           // Instante (millis) do próximo passo
+
+const unsigned long PERIODO_CONTINUO = 0;   // Tarefa executada em toda volta do loop
+const unsigned long PERIODO_EVENTO = 0xFFFFFFFFUL; // Tarefa executada só quando sinalizada
+const unsigned long ORCAMENTO_VOLTA_US = 5000; // Tempo máximo por volta para tarefas não críticas
+const int MAX_TAREFAS = 12;                 // Capacidade do escalonador
+Tarefa tarefas[MAX_TAREFAS];                // Tarefas registradas
+int ordemTarefas[MAX_TAREFAS];              // Índices das tarefas, por prioridade
+int totalTarefas = 0;                       // Quantidade de tarefas registradas
+int tarefaDht = -1;                         // Tarefa de leitura do DHT11
+int tarefaVentoinha = -1;                   // Tarefa da ventoinha automática (por evento)
+int tarefaEstatisticas = -1;                // Tarefa do relatório de estatísticas no Serial
+int tarefaEventos = -1;                     // Tarefa que grava o log de eventos na flash
+int linhaRelatorio = 0;                     // Próxima linha do relatório (0 = cabeçalho)
+const int FIFO_SERIAL_BYTES = 128;          // FIFO de transmissão da UART0
+
+const unsigned long periodoUltrassomUs = 60000; // Ciclo de medição do HC-SR04 (mínimo 60ms)
+const unsigned long US_POR_CM = 58;         // Largura do eco (ida e volta) por centímetro
+// Timer (núcleo 0) e ISR do ECHO (núcleo 1) dividem a medição: só atômicos de 32 bits (lock-free no ESP32)
+std::atomic<uint32_t> inicioEchoUs{0};      // ISR: instante da subida do ECHO (0 = sem eco)
+std::atomic<bool> medicaoPendente{false};   // Disparo feito, eco ainda não terminou (quem o zera publica)
+std::atomic<uint32_t> disparoUltrassomUs{0}; // Timer: instante do pulso no TRIG
+const uint32_t LIMITES_LATENCIA_US[] = {1000, 2000, 5000, 10000, 20000, 40000}; // Faixas do histograma
+const int FAIXAS_LATENCIA = sizeof(LIMITES_LATENCIA_US) / sizeof(LIMITES_LATENCIA_US[0]) + 1; // + faixa +Inf
+ContadorCompartilhado<uint32_t> latenciaUltrassom[FAIXAS_LATENCIA]; // ISR: disparo -> fim do eco, por faixa
+ContadorCompartilhado<uint64_t> somaLatenciaUltrassomUs; // ISR: soma das latências
+ContadorCompartilhado<uint32_t> ultrassomSemEco; // Timer: ciclos sem eco
+std::atomic<uint32_t> amostraUltrassom{0};  // Última amostra: sequência (16 bits altos) | distância cm
+const uint16_t DISTANCIA_SEM_ECO_CM = 400;  // Sem eco = nada no alcance do sensor
+FiltroDistancia filtroUltrassom = {};       // Controle: filtro das amostras do ultrassônico
+uint16_t ultimaSequenciaUltrassom = 0;      // Controle: última amostra já filtrada
+std::atomic<uint16_t> distanciaFiltradaCm{0}; // Controle: saída do filtro (lida por /metrics)
+bool presencaBruta = false;                 // Controle: critério antigo (amostra única) na última amostra
+ContadorCompartilhado<uint32_t> trocasOcupacao; // Controle: mudanças de 'ocupacao' depois do filtro
+ContadorCompartilhado<uint32_t> trocasSuprimidas; // Controle: mudanças da amostra bruta que o filtro segurou
+
+const unsigned long duracaoPulsoDhtUs = 20000; // Pulso de início (mínimo 18ms)
+const unsigned long janelaCapturaDhtUs = 8000; // Resposta + 40 bits cabem em ~5ms
+const unsigned long limiarBitDhtUs = 100;   // Entre descidas: ~78us = bit 0, ~120us = bit 1
+const unsigned long atrasoMinimoDhtMs = 1000; // Primeira nova tentativa após falha
+const int MAX_BORDAS_DHT = 48;              // Resposta (2) + 40 bits, com folga
+int64_t bordasDhtUs[MAX_BORDAS_DHT];        // ISR: instantes das bordas (publicados por totalBordasDht)
+std::atomic<int> totalBordasDht{0};         // ISR: bordas gravadas (release depois de cada borda)
+std::atomic<bool> capturandoDht{false};     // Timer: a ISR só grava durante a captura
+EtapaDHT etapaDht = DHT_OCIOSO;             // Etapa atual (só o timer altera)
+int falhasSeguidasDht = 0;                  // Para o recuo exponencial
+ContadorCompartilhado<unsigned long> falhasDht; // Timer: total de leituras inválidas
+const int PALAVRAS_AMOSTRA_DHT = (sizeof(AmostraDHT) + 3) / 4;
+std::atomic<uint32_t> amostraDht[PALAVRAS_AMOSTRA_DHT]; // Última amostra, palavra a palavra (protegida por versaoDht)
+std::atomic<uint32_t> versaoDht{0};         // Sequência do seqlock: ímpar = escrita em andamento
+uint32_t versaoDhtExibida = 0;              // Controle: última versão mostrada no LCD
+
+// Quadro do LCD em RAM: as tarefas só escrevem em 'telaLcd'; atualizarLcd() leva ao display
+// um byte por volta (cada byte custa ~1,3 ms no I2C a 100 kHz), só nas células que mudaram.
+char telaLcd[LCD_LINHAS][LCD_COLUNAS];      // O que deve aparecer
+char telaExibida[LCD_LINHAS][LCD_COLUNAS];  // O que o display mostra
+int cursorLcd = 0;                          // Célula do cursor do HD44780 (-1 = fora da tela)
+
+const esp_partition_t *particaoUsuarios = nullptr; // Partição "usuarios" (nullptr = lista compilada)
+const uint8_t *imagemUsuarios = nullptr;    // Controle: imagem ativa mapeada na memória
+spi_flash_mmap_handle_t mapaUsuarios;       // Controle: mapeamento da imagem ativa
+CabecalhoTabela cabecalhoAtivo;             // Controle: cópia do cabeçalho da imagem ativa
+std::atomic<int> slotTabelaEmUso{-1};       // Slot mapeado pelo controle (-1 = nenhum)
+std::atomic<uint32_t> geracaoTabelaGravada{0}; // Web: geração do último cabeçalho gravado (0 = nenhum)
+std::atomic<uint32_t> geracaoTabelaVerificada{0}; // Controle: última geração que já passou por abrirTabelaFlash()
+const uint32_t PASSO_CRC_TABELA = 4096;     // Bytes do conteúdo conferidos por passo da gravação
+GravacaoTabela gravacao;                    // Web: gravação em andamento
+const char *resultadoUpload = nullptr;      // Web: resultado do último upload
+LeitorCSV leitorCsv;                        // Web: importação de CSV em andamento
+
+const size_t CAPACIDADE_FILA_COMANDOS = 8;  // Posições da fila de comandos (cabem 7 comandos)
+FilaSPSC<Comando, CAPACIDADE_FILA_COMANDOS> filaComandos; // Web (núcleo 0) -> controle (núcleo 1)
+FilaSPSC<EstadoSala, 4> filaEstados;        // Controle (núcleo 1) -> web (núcleo 0)
+FilaSPSC<ResultadoLote, 16> filaResultados; // Controle -> web; cabe um por conexão do pool
+uint16_t proximoLote = 1;                   // Web: identificador do próximo lote de comandos
+ContadorCompartilhado<uint32_t> comandosDescartados; // Web: comandos recusados com a fila cheia
+const uint32_t LIMITES_LATENCIA_COMANDO_US[] = {100, 500, 1000, 5000, 20000, 100000}; // Faixas do histograma
+const int FAIXAS_LATENCIA_COMANDO = sizeof(LIMITES_LATENCIA_COMANDO_US) / sizeof(LIMITES_LATENCIA_COMANDO_US[0]) + 1;
+ContadorCompartilhado<uint32_t> latenciaComando[TIPOS_COMANDO][FAIXAS_LATENCIA_COMANDO]; // Controle: fila -> acionamento
+ContadorCompartilhado<uint64_t> somaLatenciaComandoUs[TIPOS_COMANDO]; // Controle: soma das latências por tipo
+uint32_t latenciaComandoMaxUs = 0;          // Controle: maior latência (relatório serial)
+EstadoSala ultimoEstadoPublicado;           // Controle: último instantâneo enviado
+unsigned long ultimaPublicacaoMs = 0;       // Controle: instante do último envio
+EstadoSala estadoWeb;                       // Web: cópia local usada pelos handlers
+char mensagemWeb[96] = "";                  // Web: mensagem pendente de exibição
+bool mensagemParaDifundir = false;          // Web: mensagem nova ainda não enviada aos clientes SSE
+uint32_t geracaoMensagem = 0;               // Web: muda quando 'mensagemWeb' aparece ou expira
+uint32_t idInicializacao = 0;               // Web: aleatório por boot, para a ETag não se repetir após reiniciar
+unsigned long mensagemDesdeMs = 0;          // Web: quando a mensagem atual chegou
+const unsigned long validadeMensagemMs = 10000; // Mensagem fica visível para todos por este tempo
+ContadorCompartilhado<unsigned long> respostasRenderizadas; // Web: página/JSON montados (uma vez por versão)
+ContadorCompartilhado<unsigned long> respostasDoCache; // Web: página/JSON servidos prontos
+ContadorCompartilhado<unsigned long> respostasNaoModificadas; // Web: 304 por ETag igual
+uint32_t servicoHttpMaxUs = 0;              // Web: maior volta de servirHttp() (sem a espera) desde a última coleta
+uint64_t servicoHttpTotalUs = 0;            // Web: tempo total atendendo conexões
+char metricas[8192];                        // Web: texto de /metrics (reservado até o envio terminar)
+size_t tamanhoMetricas = 0;                 // Web: bytes escritos em 'metricas'
+const int MAX_CLIENTES_SSE = 4;             // Conexões /api/events simultâneas (dentro do pool)
+EstadoSala estadoDifundido = {};            // Web: último estado enviado aos clientes SSE
+unsigned long ultimoEnvioSseMs = 0;         // Web: último evento ou keep-alive enviado
+const unsigned long intervaloKeepAliveSseMs = 15000; // Comentário SSE que detecta conexões mortas
+const unsigned long intervaloPublicacaoMs = 1000; // Reenvio periódico mesmo sem mudança
+const int MAX_CONEXOES = 8;                 // Conexões HTTP simultâneas (incluindo os canais SSE)
+const unsigned long tempoLimiteConexaoMs = 5000; // Conexão parada por mais tempo é fechada (exceto SSE)
+int soqueteServidor = -1;                   // Web: socket de escuta
+uint16_t portaHttp = 80;                    // Porta do servidor (o simulador de host usa outra)
+Conexao conexoes[MAX_CONEXOES];             // Web: pool de conexões
+Conexao *conexaoUpload = nullptr;           // Web: conexão que está enviando um upload (um por vez)
+ContadorCompartilhado<unsigned long> conexoesAceitas; // Web: estatísticas do servidor HTTP (lidas no relatório)
+ContadorCompartilhado<unsigned long> conexoesExpiradas; // Web: fechadas pelo tempo limite
+
 // ==============================================================================
 // DECLARAÇÃO DE FUNÇÕES (PROTÓTIPOS)
 // ==============================================================================
 
-void handleRoot();                          // Handler da página principal do servidor web
+void handleRoot(Conexao &c);                // Handler da página clássica (HTML completo) do servidor web
+void handleDashboard(Conexao &c);           // Painel estático comprimido (gzip) guardado na flash
+void handleEstadoApi(Conexao &c);           // Instantâneo do estado em JSON
+void handleEventos(Conexao &c);             // Abre um canal Server-Sent Events
+void handleMetricas(Conexao &c);            // Contadores no formato de exposição do Prometheus
+void escreverMetrica(const char *formato, ...); // Acrescenta uma linha ao texto de /metrics
+double segundosLigada(const ContadorSaida &saida, unsigned long agora); // Tempo ligada com o trecho em curso
+void montarEtag(char *saida, size_t capacidade); // ETag da versão atual (estado + mensagem)
+bool responderSeNaoModificado(Conexao &c, const char *etag); // 304 se o cliente já tem esta versão
+void difundirEstado();                      // Web: envia as mudanças aos clientes SSE
+bool iniciarServidorHttp();                 // Abre o socket de escuta não bloqueante
+void servirHttp(unsigned long esperaMaxMs); // Uma volta do servidor: select(), accept, leitura e envio
+void aceitarConexoes();                     // Aceita conexões pendentes enquanto houver vaga
+void lerConexao(Conexao &c);                // Lê o que chegou e avança a requisição
+void processarRequisicao(Conexao &c, size_t tamanhoCabecalho); // Roteia uma requisição completa
+void receberCorpoConexao(Conexao &c, const uint8_t *dados, size_t tamanho); // Repassa trecho do corpo
+bool enviarPendente(Conexao &c);            // Envia o que o socket aceitar (false = conexão fechada)
+void fecharConexao(Conexao &c);             // Fecha e libera a vaga (aborta upload em andamento)
+const char *valorCabecalho(const Conexao &c, const char *nome); // Valor de um cabeçalho da requisição
+void responder(Conexao &c, int codigo, const char *tipo, const char *corpo, size_t tamanho,
+               const char *extras = "", bool semCopia = false); // Monta a resposta e começa a enviar
+void responderTexto(Conexao &c, int codigo, const char *texto); // Resposta text/plain
+void responderJson(Conexao &c, int codigo, const char *json); // Resposta application/json curta
+bool anexarSaida(Conexao &c, const char *dados, size_t tamanho); // Acrescenta à saída de um canal SSE
+const char *textoStatus(int codigo);        // Frase de status HTTP
+bool reservarUpload(Conexao &c);            // Um upload por vez (409 se já houver outro)
+bool autorizarAdministrador(Conexao &c);    // Token das rotas /usuarios (403 sem token, 401 se errado)
+size_t renderizarEstadoJson(char *saida, size_t capacidade, const EstadoSala &estado,
+                            const EstadoSala *anterior, const char *mensagem); // Estado (ou só o que mudou) em JSON
+size_t escaparJson(const char *texto, char *saida, size_t capacidade); // Copia texto escapado para JSON
 void controleLuz(bool ligar);               // Função para controlar a luz
+void acionarSaida(byte pino, ContadorSaida &saida, bool ligar); // digitalWrite + tempo ligado e acionamentos
 void controleVentilacao(bool ligar);        // Função para controlar a ventoinha manual
-void redirectToRoot();                      // Redireciona para a página principal
+void redirectToRoot(Conexao &c);            // Redireciona para a página clássica
+void enviarComando(Conexao &c, TipoComando tipo, bool ligar); // Enfileira comando para o controle e redireciona
+bool enfileirarComando(Comando cmd);        // Web: carimba o instante e põe na fila (false = cheia)
+void registrarLatenciaComando(const Comando &cmd); // Controle: fila -> acionamento no histograma
+void handleComandos(Conexao &c);            // POST /api/commands: enfileira um lote e espera o resultado
+const char *interpretarLote(char *texto, Comando &cmd); // Lista "luz=on,ventilacao=off" -> CMD_LOTE (nullptr = ok)
+void receberResultadosLote();               // Web: responde às conexões que aguardam um lote
+void aplicarLote(const Comando &cmd);       // Controle: valida e aplica todas as saídas do lote, ou nenhuma
+void tarefaRede(void *parametro);           // Tarefa do servidor web (núcleo 0)
+void passoRede(unsigned long esperaMaxMs);  // Uma volta da tarefa de rede
+void receberEstados();                      // Web: atualiza a cópia local do estado
+void processarComandos();                   // Controle: aplica os comandos recebidos
+void publicarEstado();                      // Controle: envia o estado para a web
 void lerRfid();                             // Função para ler o cartão RFID
+void decidirAcesso(int indiceLeitor, const ChaveUID &chave); // Decide o acesso e monta o feedback
+void iniciarLeitoresRfid();                 // Inicia os leitores de 'pinosLeitores' no barramento SPI
+void iniciarLeitorIRQ(LeitorRFID &leitor);  // Habilita a IRQ de recepção do MFRC522
+void armarReqa(LeitorRFID &leitor);         // Transmite um REQA; a resposta chega pela IRQ
+void pararCartao(LeitorRFID &leitor);       // Transmite um HLTA sem esperar o timeout do MFRC522
+void IRAM_ATTR isrRfid(void *arg);          // Interrupção da linha IRQ de um leitor
+ChaveUID criarChaveUID(const byte *uid, byte tamanho); // Empacota o UID lido
+bool leituraRepetida(LeitorRFID &leitor, const ChaveUID &chave); // Cartão ainda no campo dentro da janela?
+void renovarLeituraRecente(LeitorRFID &leitor, const ChaveUID &chave); // Reinicia a janela de um cartão
+bool chavesIguais(const ChaveUID &a, const ChaveUID &b); // Compara duas chaves (3 palavras)
+uint32_t hashChave(const ChaveUID &chave);  // Espalha a chave para o índice hash
+void formatarChave(const ChaveUID &chave, char *saida); // UID em hexadecimal (para logs)
+void construirIndiceUID();                  // Monta o índice hash dos usuários autorizados
+const char *buscarUsuario(const ChaveUID &chave, byte &horario); // Busca O(1) pelo UID (flash ou lista compilada)
+void compilarHorarios();                    // Converte regrasHorarios[] em mapas de bits
+bool dentroDoHorario(byte horario);         // Um teste de bit na hora local atual
+void limparBloom();                         // Zera o filtro de Bloom
+void adicionarBloom(const ChaveUID &chave); // Marca uma chave no filtro
+bool talvezNoBloom(const ChaveUID &chave);  // false = certamente não cadastrado
+void iniciarLogEventos();                   // Valida o anel na RTC e localiza o fim do log na flash
+bool paginaGravada(uint32_t pagina);        // Página do log já usada?
+void registrarEvento(TipoEvento tipo, const ChaveUID &chave); // Acrescenta evento ao anel
+void descarregarEventos();                  // Grava uma página completa do anel na flash por volta
+void apagarProximoSetorEventos();           // Web: deixa apagado o próximo setor do log
+void abrirTabelaFlash(bool conferirCrc = true); // Mapeia a imagem de usuários válida mais nova
+bool lerCabecalhoValido(int slot, CabecalhoTabela &cabecalho, bool conferirCrc = true); // Valida o cabeçalho de um slot
+uint32_t crcConteudoTabela(uint32_t base, const CabecalhoTabela &cabecalho); // CRC do conteúdo
+bool acumularCrcFlash(uint32_t offset, uint32_t tamanho, uint32_t &crc); // CRC32 de um trecho da partição
+uint32_t tamanhoConteudoTabela(const CabecalhoTabela &cabecalho); // Bytes de índice + registros
+const RegistroUsuario *buscarUsuarioFlash(const ChaveUID &chave); // Busca na imagem mapeada
+bool iniciarGravacaoTabela();               // Web: prepara o slot inativo
+bool apagarSlotAte(uint32_t fim);           // Web: apaga setores conforme a gravação avança
+bool receberTrechoImagem(const uint8_t *dados, size_t tamanho); // Web: grava trecho da imagem
+bool conferirImagemRecebida();              // Web: cabeçalho e tamanho da imagem enviada
+bool concluirGravacaoTabela();              // Web: confere o CRC e grava o cabeçalho (troca atômica)
+void iniciarCrcTabela();                    // Web: o CRC do conteúdo passa a ser calculado em passos
+void avancarGravacaoTabela();               // Web: um passo (setor apagado ou bloco do CRC) por volta
+bool gravarCabecalhoTabela();               // Web: grava o cabeçalho e pede a troca de slot
+bool iniciarConstrucaoTabela();             // Web: prepara a construção incremental
+ResultadoInsercao adicionarUsuarioTabela(const ChaveUID &chave, byte horario, const char *nome); // Web: insere usuário
+bool concluirConstrucaoTabela();            // Web: publica a imagem construída (CRC já calculado)
+void consumirTrechoCsv(const uint8_t *dados, size_t tamanho); // Web: parser de CSV por trechos
+void concluirLinhaCsv();                    // Web: insere a linha atual do CSV
+bool iniciarUploadCsv(Conexao &c);          // Web: início do upload do CSV
+void receberUploadCsv(const uint8_t *dados, size_t tamanho); // Web: trecho do CSV
+void responderUploadCsv(Conexao &c);        // Web: conclui e responde a importação
+bool iniciarUploadImagem(Conexao &c);       // Web: início do upload da imagem
+void receberUploadImagem(const uint8_t *dados, size_t tamanho); // Web: trecho da imagem
+void responderUploadImagem(Conexao &c);     // Web: conclui e responde o upload da imagem
+void executarSequenciaFeedback();           // Avança um passo do feedback de LCD/buzzer/servo
+bool feedbackEmAndamento();                 // Indica se há feedback em andamento
+void iniciarSequencia();                    // Reinicia o roteiro de feedback
+PassoFeedback *adicionarPasso(AcaoPasso acao, int valor, unsigned int duracao, unsigned int espera); // Acrescenta passo
+void adicionarTexto(const char *linha1, const char *linha2, unsigned int espera); // Acrescenta texto no LCD
+void adicionarPausa(unsigned int espera);   // Estende a espera do último passo
 void atualizarEstadoOcupacao();             // Atualiza a variável de ocupação
+uint16_t filtrarDistancia(FiltroDistancia &filtro, uint16_t distanciaCm); // Nova amostra -> distância filtrada
+void iniciarUltrassom();                    // Configura disparo por timer e eco por interrupção
+void dispararUltrassom(void *arg);          // Callback do timer: pulso de TRIG
+void IRAM_ATTR isrEcho();                   // Interrupção de borda do ECHO
+void publicarDistancia(uint32_t distanciaCm); // Publica a última distância medida
+void iniciarDht();                          // Configura a aquisição do DHT11 em segundo plano
+void etapaLeituraDht(void *arg);            // Callback do timer: avança a leitura do DHT11
+void IRAM_ATTR isrDht();                    // Interrupção de borda de descida do DHT11
+bool decodificarDht(float &umidade, float &temperatura); // Decodifica o quadro de 40 bits
+void publicarAmostraDht(const AmostraDHT &amostra); // Publica a amostra (escritor do seqlock)
+bool lerAmostraDht(AmostraDHT &amostra, uint32_t &versao); // Copia a amostra (leitor do seqlock)
 void atualizarDisplayTempUmi();             // Atualiza o display LCD com temp/umidade
+void escreverLcd(int linha, const char *texto); // Troca uma linha do quadro do LCD
+void atualizarLcd();                        // Envia ao display um byte do que mudou no quadro
 void controleAutomaticoVentoinha();         // Controla a ventoinha automática
 void verificarDesligamentoPorAusencia();    // Desliga luz/ventoinha manual se sala vazia
+int registrarTarefa(const char *nome, void (*funcao)(), unsigned long periodoMs, byte prioridade, unsigned long orcamentoUs); // Registra tarefa
+void sinalizarTarefa(int id);               // Pede a execução de uma tarefa por evento
+void reagendarTarefa(int id, unsigned long atrasoMs); // Adia a próxima execução de uma tarefa
+void executarEscalonador();                 // Executa as tarefas vencidas
+unsigned long percentil99Us(const Tarefa &t); // Estima o p99 da duração de uma tarefa
+void imprimirEstatisticasTarefas();         // Relatório de tempo das tarefas no Serial, uma linha por volta
+int formatarLinhaRelatorio(int linha, char *texto, size_t tamanho); // Uma linha do relatório (0 = fim)
 
 // ==============================================================================
 // SETUP: Executado uma vez na inicialização do ESP32
@@ -138,9 +803,17 @@ void setup() {
     digitalWrite(PINO_LUZ, LOW);            // Garante luz desligada
     digitalWrite(PINO_VENTOINHA_AUTO, LOW); // Garante ventoinha automática desligada
     digitalWrite(PINO_VENTOINHA_MANUAL, LOW);// Garante ventoinha manual desligada
-    dht.begin();                            // Inicializa sensor DHT11
+    iniciarDht();                           // DHT11 lido em segundo plano
+    iniciarUltrassom();                     // Ultrassônico medido em segundo plano
+    construirIndiceUID();                   // Índice hash dos usuários autorizados
+    compilarHorarios();                     // Horários de acesso em mapas de bits
+    abrirTabelaFlash();                     // Tabela de usuários gravada na flash, se houver
+    iniciarLogEventos();                    // Log de acessos (RTC + flash)
     SPI.begin();                            // Inicializa barramento SPI
-    rfid.PCD_Init();                        // Inicializa leitor RFID
+    iniciarLeitoresRfid();                  // Leitores RFID de 'pinosLeitores'
+    if (strlen(tokenAdministrador) < TAMANHO_MIN_TOKEN) {
+        Serial.println(F("Token de administrador nao configurado: /usuarios recusado ate gravar um."));
+    }
     lcd.init();                             // Inicializa LCD
     lcd.backlight();                        // Liga backlight do LCD
     lcd.clear();                            // Limpa display LCD
@@ -158,16 +831,35 @@ void setup() {
     lcd.print(WiFi.localIP());              // Mostra IP no LCD
     Serial.print(F("\nEndereço IP: "));     // Mostra IP no Serial
     Serial.println(WiFi.localIP());
+    configTzTime(fusoHorario, servidorNtp); // Sincroniza a hora local por SNTP em segundo plano
     delay(3000);                            // Aguarda 3 segundos
-    server.on("/", handleRoot);             // Rota principal do servidor web
-    server.on("/luz/on", []() { controleLuz(true); });        // Rota para ligar luz
-    server.on("/luz/off", []() { controleLuz(false); });      // Rota para desligar luz
-    server.on("/ventilacao/on", []() { controleVentilacao(true); });  // Ligar ventoinha manual
-    server.on("/ventilacao/off", []() { controleVentilacao(false); }); // Desligar ventoinha manual
-    server.onNotFound(handleRoot);          // Qualquer outra rota: página principal
-    server.begin();                         // Inicia servidor web
-    Serial.println(F("Servidor HTTP iniciado.")); // Mensagem debug
+    idInicializacao = esp_random();
+    if (iniciarServidorHttp()) Serial.println(F("Servidor HTTP iniciado.")); // Mensagem debug
+    else Serial.printf("Falha ao abrir a porta %u.\n", portaHttp);
     lcd.clear();                            // Limpa LCD
+    memset(telaLcd, ' ', sizeof(telaLcd));  // Daqui em diante o LCD só muda pelo quadro em RAM
+    memset(telaExibida, ' ', sizeof(telaExibida));
+    cursorLcd = 0;
+
+    // O servidor web roda sozinho no núcleo 0; o loop() (núcleo 1) fica com o controle
+    xTaskCreatePinnedToCore(tarefaRede, "rede", 8192, nullptr, 1, nullptr, 0);
+
+    // Tarefas do loop: nome, função, período (ms), prioridade, orçamento (us)
+    registrarTarefa("comandos", processarComandos, PERIODO_CONTINUO, 0, 1000);
+    registrarTarefa("publicar", publicarEstado, 50, 1, 1000);
+    if (totalLeitores > 0) {                // Sem leitores não há rodízio (nem período)
+        registrarTarefa("rfid", lerRfid, 50 / totalLeitores, 1, 3000); // IRQ atendida em até ~50ms por leitor
+    } else {
+        Serial.println(F("Nenhum leitor RFID configurado: acesso pela porta desativado."));
+    }
+    registrarTarefa("feedback", executarSequenciaFeedback, 5, 1, 1000);
+    registrarTarefa("ocupacao", atualizarEstadoOcupacao, 60, 2, 1000);   // Só consome a última amostra
+    registrarTarefa("ausencia", verificarDesligamentoPorAusencia, 100, 2, 1000);
+    tarefaDht = registrarTarefa("dht", atualizarDisplayTempUmi, 200, 3, 1000); // Só consome amostras novas
+    registrarTarefa("lcd", atualizarLcd, PERIODO_CONTINUO, 3, 1500); // Um byte no I2C por volta
+    tarefaVentoinha = registrarTarefa("ventoinha", controleAutomaticoVentoinha, PERIODO_EVENTO, 2, 1000);
+    tarefaEventos = registrarTarefa("eventos", descarregarEventos, 1000, 4, 1000); // Só programa páginas; a web apaga
+    tarefaEstatisticas = registrarTarefa("estatisticas", imprimirEstatisticasTarefas, 60000, 4, 1000);
 }
 
 // ==============================================================================
@@ -175,295 +867,2914 @@ void setup() {
 // ==============================================================================
 
 void loop() {
-    server.handleClient();                  // Processa requisições web
-    lerRfid();                              // Lê cartão RFID (controle de acesso)
-    atualizarEstadoOcupacao();              // Atualiza estado de ocupação da sala
-    atualizarDisplayTempUmi();              // Atualiza LCD com temp/umidade
-    controleAutomaticoVentoinha();          // Controla ventoinha automática
-    verificarDesligamentoPorAusencia();     // Desliga luz/ventoinha manual se sala vazia
+    executarEscalonador();                  // Executa as tarefas vencidas (ver setup())
 }
 
 // ==============================================================================
-// FUNÇÕES PRINCIPAIS DE LÓGICA
+// COMUNICAÇÃO ENTRE OS NÚCLEOS
 // ==============================================================================
 
 /**
- * @brief Desliga a luz e a ventoinha manual se a sala estiver vazia para economizar energia.
- * @note Esta função não afeta a ventoinha automática de temperatura.
+ * @brief Tarefa do servidor web, presa ao núcleo 0.
+ * @details Só acessa o pool de conexões, 'estadoWeb' e 'mensagemWeb'. Um cliente lento aqui
+ * não atrasa mais a leitura do RFID e do ultrassônico, que ficam no núcleo 1.
  */
-void verificarDesligamentoPorAusencia() {
-    // Se a sala NÃO está ocupada E (a luz está ligada OU a ventoinha manual está ligada)
-    if (!ocupacao && (iluminacaoState || ventilacaoState)) {
-        digitalWrite(PINO_LUZ, LOW);            // Desliga luz
-        iluminacaoState = false;                // Atualiza estado da luz
-        digitalWrite(PINO_VENTOINHA_MANUAL, LOW);// Desliga ventoinha manual
-        ventilacaoState = false;                // Atualiza estado da ventoinha manual
-        mensagemSistema = "Luz e ventoinha manual desligadas por ausência."; // Mensagem para web/LCD
-        Serial.println("AUTOMAÇÃO: Luz e ventoinha manual desligadas, sala vazia."); // Debug
-        delay(50);                              // Pequeno delay para evitar sobrescrita da mensagem
-    }
+void tarefaRede(void *parametro) {
+    for (;;) passoRede(10);                 // Espera até 10ms por atividade a cada volta
 }
 
 /**
- * @brief Lê o sensor RFID, verifica a autorização e controla a cancela.
+ * @brief Uma volta da tarefa de rede (o simulador de host a chama diretamente).
+ * @param esperaMaxMs Tempo máximo parado no select() de servirHttp().
  */
-void lerRfid(void) {
-    if (!rfid.PICC_IsNewCardPresent() || !rfid.PICC_ReadCardSerial()) return; // Se não há novo cartão, sai
+void passoRede(unsigned long esperaMaxMs) {
+    receberEstados();                       // Atualiza a cópia local antes de responder
+    receberResultadosLote();                // Conclui os POST /api/commands já aplicados
+    difundirEstado();                       // Empurra só o que mudou para os clientes SSE
+    avancarGravacaoTabela();                // Um passo da tabela de usuários em gravação, se houver
+    if (!gravacao.ativa) apagarProximoSetorEventos(); // Nunca dois setores apagados na mesma volta
+    bool passosPendentes = gravacao.etapa == ETAPA_APAGANDO_SLOT || gravacao.etapa == ETAPA_CALCULANDO_CRC;
+    bool aguardandoControle = false;        // O resultado de um lote chega pela fila, não pelo select()
+    for (const Conexao &c : conexoes) aguardandoControle |= c.estado == CONEXAO_AGUARDANDO_CONTROLE;
+    unsigned long esperaMs = passosPendentes ? 0 : aguardandoControle && esperaMaxMs > 1 ? 1 : esperaMaxMs;
+    servirHttp(esperaMs);                   // Atende as conexões
+}
 
-    bool autorizado = false;                    // Flag de autorização
-    const char *nomeUsuario = "";               // Nome do usuário
+/**
+ * @brief Web: consome os instantâneos publicados pelo controle e expira a mensagem do sistema.
+ * @details A mensagem faz parte da versão servida (página e JSON em cache), então fica
+ * visível para todos os clientes por 'validadeMensagemMs' em vez de sumir na primeira leitura.
+ */
+void receberEstados() {
+    EstadoSala estado;
+    while (filaEstados.desenfileirar(estado)) {
+        if (estado.mensagem[0] != '\0') {  // Guarda a mensagem até a página exibi-la
+            snprintf(mensagemWeb, sizeof(mensagemWeb), "%s", estado.mensagem);
+            mensagemParaDifundir = true;
+            geracaoMensagem++;
+            mensagemDesdeMs = millis();
+        }
+        estadoWeb = estado;
+    }
+    if (mensagemWeb[0] != '\0' && millis() - mensagemDesdeMs > validadeMensagemMs) {
+        mensagemWeb[0] = '\0';                  // Expirou: páginas em cache deixam de valer
+        geracaoMensagem++;
+    }
+}
 
-    // Verifica se UID lido está na lista de autorizados
-    for (int i = 0; i < totalUsuarios; i++) {
-        if (memcmp(rfid.uid.uidByte, usuariosAutorizados[i].uid, rfid.uid.size) == 0) {
-            autorizado = true;
-            nomeUsuario = usuariosAutorizados[i].nome;
-            break;
+/**
+ * @brief Web: envia aos clientes SSE só os campos que mudaram desde o último evento.
+ * @details Chamada a cada volta da tarefa de rede, logo depois de receberEstados(); como o
+ * controle publica a cada 50 ms, uma mudança chega ao navegador bem abaixo de 100 ms. Sem
+ * mudanças só sai um comentário de keep-alive a cada 'intervaloKeepAliveSseMs', que mantém
+ * vivas as conexões atrás de NAT e proxies. A mensagem pendente é enviada uma vez, mas
+ * continua valendo para a página clássica.
+ */
+void difundirEstado() {
+    static char evento[320];
+    int conectados = 0;
+    for (const Conexao &c : conexoes) {
+        if (c.estado == CONEXAO_EVENTOS) conectados++;
+    }
+    const char *mensagem = mensagemParaDifundir ? mensagemWeb : "";
+    size_t tamanho = 0;
+    if (conectados > 0) {
+        memcpy(evento, "data: ", 6);
+        size_t json = renderizarEstadoJson(evento + 6, sizeof(evento) - 8, estadoWeb, &estadoDifundido, mensagem);
+        if (json > 0) {
+            tamanho = 6 + json;
+            evento[tamanho++] = '\n';
+            evento[tamanho++] = '\n';
+        } else if (millis() - ultimoEnvioSseMs >= intervaloKeepAliveSseMs) {
+            tamanho = strlen(strcpy(evento, ":\n\n"));
         }
     }
+    estadoDifundido = estadoWeb;
+    mensagemParaDifundir = false;
+    if (tamanho == 0) return;
 
-    lcd.clear();                                // Limpa LCD
-    lcd.setCursor(0, 0);                        // Cursor início
+    for (Conexao &c : conexoes) {
+        if (c.estado == CONEXAO_EVENTOS) anexarSaida(c, evento, tamanho); // Cliente atrasado demais é fechado
+    }
+    ultimoEnvioSseMs = millis();
+}
 
-    if (autorizado) {                           // Se autorizado
-        lcd.print("Bem-vindo:");                // Mensagem LCD
-        lcd.setCursor(0, 1);
-        lcd.print(nomeUsuario);                 // Mostra nome do usuário
-        Serial.print(">> Usuario: ");
-        Serial.println(nomeUsuario);            // Debug
-        delay(1500);                            // Pausa para exibir nome
-        ServoPorta.detach();                    // Desanexa servo (proteção)
-        delay(100);
-        tone(PINO_BUZZER, 659, 150);
-        delay(200);
-        tone(PINO_BUZZER, 784, 150);
-        delay(200);
-        tone(PINO_BUZZER, 880, 150);
-        delay(200);
-        noTone(PINO_BUZZER);                    // Para buzzer
-        ServoPorta.attach(servo, 500, 2500);    // Reanexa servo
-        delay(250);
+/**
+ * @brief Web: enfileira um comando para o controle e redireciona o navegador.
+ */
+void enviarComando(Conexao &c, TipoComando tipo, bool ligar) {
+    Comando cmd = {tipo, ligar};
+    if (!enfileirarComando(cmd)) {          // Controle atrasado: avisa em vez de bloquear
+        strncpy(mensagemWeb, "Sistema ocupado, tente novamente.", sizeof(mensagemWeb) - 1);
+        mensagemParaDifundir = true;
+        geracaoMensagem++;
+        mensagemDesdeMs = millis();
+    }
+    redirectToRoot(c);
+}
+
+/**
+ * @brief Web: POST /api/commands. O corpo é uma lista curta de operações, por exemplo
+ * "luz=on,ventilacao=off" (separadas por ',', ';', '&' ou quebra de linha; valores on/off ou 1/0).
+ * @details A lista vira um único CMD_LOTE, que o controle aplica inteiro numa só chamada de
+ * processarComandos(). A conexão fica em CONEXAO_AGUARDANDO_CONTROLE até o ResultadoLote
+ * chegar, então a resposta é um JSON curto e não há redirecionamento nem página renderizada.
+ * Se o controle não responde em 'tempoLimiteConexaoMs', a resposta é 504 com "aplicado":null:
+ * o lote já está na fila e ainda pode ser aplicado, então o cliente deve consultar o estado.
+ */
+void handleComandos(Conexao &c) {
+    Comando cmd = {CMD_LOTE, false, 0, 0, 0};
+    const char *erro = interpretarLote(c.buffer, cmd);
+    if (erro != nullptr) {
+        char json[96];
+        snprintf(json, sizeof(json), "{\"aplicado\":false,\"erro\":\"%s\"}", erro);
+        responderJson(c, 400, json);
+        return;
+    }
+    cmd.lote = proximoLote++;
+    if (proximoLote == 0) proximoLote = 1;      // 0 = nenhum lote aguardado
+    if (!enfileirarComando(cmd)) {
+        responderJson(c, 503, "{\"aplicado\":false,\"erro\":\"controle ocupado\"}");
+        return;
+    }
+    c.lote = cmd.lote;
+    c.estado = CONEXAO_AGUARDANDO_CONTROLE;
+    c.ultimoMs = millis();
+}
 
-        lcd.clear();
-        lcd.setCursor(0, 0);
+/**
+ * @brief Web: interpreta a lista de operações de um lote (o texto é alterado).
+ * @return nullptr se válida, ou a descrição do erro. Uma saída repetida vale pela última operação.
+ */
+const char *interpretarLote(char *texto, Comando &cmd) {
+    char *contexto = nullptr;
+    for (char *item = strtok_r(texto, ",;&\r\n ", &contexto); item != nullptr;
+         item = strtok_r(nullptr, ",;&\r\n ", &contexto)) {
+        char *valor = strchr(item, '=');
+        if (valor == nullptr) return "operacao sem '='";
+        *valor++ = '\0';
+        byte alvo;
+        if (strcmp(item, "luz") == 0) alvo = ALVO_LUZ;
+        else if (strcmp(item, "ventilacao") == 0) alvo = ALVO_VENTILACAO;
+        else return "saida desconhecida";
+        bool ligar;
+        if (strcmp(valor, "on") == 0 || strcmp(valor, "1") == 0) ligar = true;
+        else if (strcmp(valor, "off") == 0 || strcmp(valor, "0") == 0) ligar = false;
+        else return "valor deve ser on/off";
+        cmd.alvos |= alvo;
+        cmd.valores = ligar ? (cmd.valores | alvo) : (cmd.valores & ~alvo);
+    }
+    return cmd.alvos != 0 ? nullptr : "lista vazia";
+}
 
-        if (!portaAberta) {                     // Se porta está fechada
-            ServoPorta.writeMicroseconds(posicaoAberta); // Abre porta
-            delay(100);
-            portaAberta = true;                 // Atualiza estado
-            memcpy(ultimoUID, rfid.uid.uidByte, 4); // Salva UID
-            lcd.print("Porta: ABERTA");         // Mensagem LCD
-            Serial.println(">> Porta ABERTA."); // Debug
-            ServoPorta.detach();                // Desanexa servo (proteção)
-            delay(600);
-            tone(PINO_BUZZER, 1000, 150);       // Buzzer: nota aguda
-            delay(200);
-            tone(PINO_BUZZER, 1500, 150);       // Buzzer: nota mais aguda
-            delay(200);
-            noTone(PINO_BUZZER);                // Para buzzer
-            ServoPorta.attach(servo, 500, 2500); // Reanexa servo
-            delay(250);
-
-        } else if (memcmp(rfid.uid.uidByte, ultimoUID, 4) == 0) { // Mesmo usuário fecha
-            ServoPorta.writeMicroseconds(posicaoFechada); // Fecha porta
-            portaAberta = false;                // Atualiza estado
-            lcd.print("Porta: FECHADA");        // Mensagem LCD
-            Serial.println(">> Porta FECHADA.");// Debug
-        } else {                                // Outro usuário tenta fechar
-            lcd.print("Ja aberta por");
-            lcd.setCursor(0, 1);
-            lcd.print("outro usuario");
-            Serial.println(">> Outro usuario tentou fechar a porta.");
-            ServoPorta.detach();                // Desanexa servo (proteção)
-            delay(100);
-            tone(PINO_BUZZER, 750, 200); // Aviso sonoro mediano de 200ms
-            delay(200);
-            tone(PINO_BUZZER, 750, 200); // Aviso sonoro mediano de 200ms
-            delay(200);
-            noTone(PINO_BUZZER);                // Para buzzer
-            ServoPorta.attach(servo, 500, 2500); // Reanexa servo
-            delay(250);
-        }
-    } else {                                    // Se não autorizado
-        lcd.print("Acesso NEGADO");             // Mensagem LCD
-        lcd.setCursor(0, 1);
-        lcd.print("Cartao invalido");
-        Serial.println(">> Acesso Negado.");    // Debug
-        delay(100);
-
-        ServoPorta.detach();                    // Desanexa servo
-        delay(100);
-        for (int i = 0; i < 2; i++) {           // Buzzer: 2 bipes graves
-            tone(PINO_BUZZER, 300, 250);
-            delay(250);
+/**
+ * @brief Web: entrega cada ResultadoLote à conexão que o aguarda (se ela ainda existir).
+ */
+void receberResultadosLote() {
+    ResultadoLote r;
+    while (filaResultados.desenfileirar(r)) {
+        for (Conexao &c : conexoes) {
+            if (c.estado != CONEXAO_AGUARDANDO_CONTROLE || c.lote != r.lote) continue;
+            char json[160];
+            if (r.aplicado) {
+                snprintf(json, sizeof(json), "{\"aplicado\":true,\"versao\":%lu,\"luz\":%s,\"ventilacao\":%s}",
+                         (unsigned long)r.versao, r.iluminacao ? "true" : "false", r.ventilacao ? "true" : "false");
+            } else {
+                snprintf(json, sizeof(json), "{\"aplicado\":false,\"erro\":\"sala vazia\",\"rejeitados\":[%s%s%s]}",
+                         (r.rejeitados & ALVO_LUZ) ? "\"luz\"" : "",
+                         (r.rejeitados & ALVO_LUZ) && (r.rejeitados & ALVO_VENTILACAO) ? "," : "",
+                         (r.rejeitados & ALVO_VENTILACAO) ? "\"ventilacao\"" : "");
+            }
+            responderJson(c, r.aplicado ? 200 : 409, json);
+            break;
         }
-        noTone(PINO_BUZZER);                    // Para buzzer
-        ServoPorta.attach(servo, 500, 2500);    // Reanexa servo
-        delay(250);
     }
+}
 
-    delay(1500);                                // Pausa para feedback
-    rfid.PICC_HaltA();                          // Finaliza comunicação com cartão
-    rfid.PCD_StopCrypto1();                     // Finaliza criptografia
-    millisAnterior = millis();                  // Atualiza tempo para leitura temp/umi
+/**
+ * @brief Web: carimba o comando com o instante atual e o põe na fila do controle.
+ * @details Handlers nunca acionam saídas: só o controle, no núcleo 1, escreve nos GPIOs e
+ * altera o estado da sala, na mesma volta que verificarDesligamentoPorAusencia().
+ */
+bool enfileirarComando(Comando cmd) {
+    cmd.enfileiradoUs = micros();
+    if (filaComandos.enfileirar(cmd)) return true;
+    comandosDescartados++;
+    return false;
 }
 
 /**
- * @brief Lê o sensor ultrassônico, atualiza 'ocupacao' e gerencia a luz automática.
- * @details A luz só acende automaticamente se não tiver sido desligada manualmente
- * enquanto a sala estava ocupada. A flag é resetada quando a sala fica vazia.
+ * @brief Controle: aplica os comandos recebidos da web.
+ * @details Esvazia a fila uma vez por volta do loop (no máximo o que já estava nela, então
+ * um produtor rápido não prende o controle) e publica o estado uma vez no fim.
  */
-void atualizarEstadoOcupacao() {
-    long distancia = ultrasonic1.read();
-    bool presencaAtual = (distancia > 0 && distancia <= DISTANCIA_PRESENCA_CM);
-    ocupacao = presencaAtual;
+void processarComandos() {
+    uint32_t geracao = geracaoTabelaGravada.load(std::memory_order_acquire);
+    if (geracao != geracaoTabelaVerificada.load(std::memory_order_relaxed)) { // Web gravou uma imagem nova
+        abrirTabelaFlash(false);                // A web já conferiu o CRC antes de gravar o cabeçalho
+        geracaoTabelaVerificada.store(geracao, std::memory_order_release);
+    }
 
-    if (presencaAtual) {
-        if (tempoInicioPresenca == 0) {
-            tempoInicioPresenca = millis();
-        }
-        // ALTERADO: Adicionado a verificação '!luzDesligadaManualmente'
-        // A luz só liga automaticamente se a flag de desligamento manual não estiver ativa.
-        if ((millis() - tempoInicioPresenca >= tempoMinimoPresenca) && !iluminacaoState && !luzDesligadaManualmente) {
-            Serial.println("AUTOMAÇÃO: Presença detectada. Ligando a luz.");
-            controleLuz(true); // A própria função controleLuz(true) vai resetar a flag.
-        }
-    } else { // Se a sala está vazia
-        tempoInicioPresenca = 0;
-        // NOVO: Reseta a flag quando a sala fica vazia.
-        // Isso permite que a luz acenda automaticamente na próxima vez que alguém entrar.
-        luzDesligadaManualmente = false;
+    Comando cmd;
+    bool aplicou = false;
+    for (size_t i = 0; i < CAPACIDADE_FILA_COMANDOS && filaComandos.desenfileirar(cmd); i++) {
+        if (cmd.tipo == CMD_LUZ) controleLuz(cmd.ligar);
+        else if (cmd.tipo == CMD_VENTILACAO) controleVentilacao(cmd.ligar);
+        else if (cmd.tipo == CMD_LOTE) aplicarLote(cmd);
+        registrarLatenciaComando(cmd);
+        aplicou = true;
     }
+    if (aplicou) publicarEstado();          // Resposta rápida aos comandos
 }
 
+/**
+ * @brief Controle: conta o tempo entre o enfileiramento na web e o fim do acionamento.
+ */
+void registrarLatenciaComando(const Comando &cmd) {
+    uint32_t latencia = micros() - cmd.enfileiradoUs;
+    int faixa = 0;
+    while (faixa < FAIXAS_LATENCIA_COMANDO - 1 && latencia > LIMITES_LATENCIA_COMANDO_US[faixa]) faixa++;
+    latenciaComando[cmd.tipo][faixa]++;
+    somaLatenciaComandoUs[cmd.tipo] += latencia;
+    if (latencia > latenciaComandoMaxUs) latenciaComandoMaxUs = latencia;
+}
 
 /**
- * @brief Lê o sensor DHT11 e atualiza o display LCD. Usa um timer não bloqueante.
+ * @brief Controle: aplica um lote inteiro ou nada.
+ * @details Usa as mesmas regras de controleLuz() e controleVentilacao(): ligar exige sala
+ * ocupada. Se alguma operação violar a regra, nenhuma saída muda e o resultado lista as
+ * rejeitadas. Como tudo acontece nesta chamada, nenhum outro comando ou tarefa do loop vê
+ * o lote pela metade.
  */
-void atualizarDisplayTempUmi() {
-    if (millis() - millisAnterior < intervaloLeituraTemp) return; // Só executa se passou o intervalo
-    millisAnterior = millis();                  // Atualiza tempo da última leitura
-    float umidade = dht.readHumidity();         // Lê umidade
-    float temp = dht.readTemperature();         // Lê temperatura
-    if (isnan(umidade) || isnan(temp)) {        // Se leitura inválida
-        Serial.println(F("Falha ao ler dados do sensor DHT!"));
-        lcd.clear();
-        lcd.setCursor(0, 0);
-        lcd.print("ERRO SENSOR");
-        delay(1000);
-        return;
+void aplicarLote(const Comando &cmd) {
+    ResultadoLote r = {cmd.lote, false, 0, 0, false, false};
+    if (!ocupacao) r.rejeitados = cmd.alvos & cmd.valores; // Ligar com a sala vazia
+    if (r.rejeitados == 0) {
+        if (cmd.alvos & ALVO_LUZ) controleLuz(cmd.valores & ALVO_LUZ);
+        if (cmd.alvos & ALVO_VENTILACAO) controleVentilacao(cmd.valores & ALVO_VENTILACAO);
+        mensagemSistema = "Comandos em lote aplicados.";
+        r.aplicado = true;
     }
-    temperaturaAtual = (int)temp;               // Atualiza variável global de temperatura
-    lcd.clear();
-    lcd.setCursor(0, 0); lcd.print("Umi: "); lcd.print(umidade, 1); lcd.print("%"); // Mostra umidade
-    lcd.setCursor(0, 1); lcd.print("Temp: "); lcd.print(temperaturaAtual); lcd.print((char)223); lcd.print("C"); // Mostra temp
+    r.versao = versaoEstado;
+    r.iluminacao = iluminacaoState;
+    r.ventilacao = ventilacaoState;
+    filaResultados.enfileirar(r);               // Nunca enche: no máximo um lote por conexão do pool
 }
 
 /**
- * @brief Controla a ventoinha automática com base na temperatura.
+ * @brief Controle: envia o estado atual para a web quando muda (ou periodicamente).
+ * @details Quem altera o estado publicado incrementa 'versaoEstado'; sem mudança de versão
+ * só há o reenvio periódico. A mensagem do sistema só é limpa depois de entrar na fila.
  */
-void controleAutomaticoVentoinha() {
-    if (temperaturaAtual >= tempacionamento && !ventilacaoAutomaticaState) { // Se temp alta e ventoinha desligada
-        digitalWrite(PINO_VENTOINHA_AUTO, HIGH); // Liga ventoinha automática
-        ventilacaoAutomaticaState = true;       // Atualiza estado
-        mensagemSistema = "Ventoinha LIGADA automaticamente por temperatura alta.";
-        Serial.println("Ventoinha AUTOMÁTICA LIGADA.");
-    } else if (temperaturaAtual < tempdesligamento && ventilacaoAutomaticaState) { // Se temp baixa e ventoinha ligada
-        digitalWrite(PINO_VENTOINHA_AUTO, LOW); // Desliga ventoinha automática
-        ventilacaoAutomaticaState = false;      // Atualiza estado
-        mensagemSistema = "Ventoinha DESLIGADA automaticamente.";
-        Serial.println("Ventoinha AUTOMÁTICA DESLIGADA.");
-    }
+void publicarEstado() {
+    bool mudou = versaoEstado != ultimoEstadoPublicado.versao;
+    if (!mudou && millis() - ultimaPublicacaoMs < intervaloPublicacaoMs) return;
+    EstadoSala estado;
+    memset(&estado, 0, sizeof(estado));
+    estado.versao = versaoEstado;
+    estado.temperatura = temperaturaAtual;
+    estado.umidade = umidadeAtual;
+    estado.ocupacao = ocupacao;
+    estado.iluminacao = iluminacaoState;
+    estado.ventilacao = ventilacaoState;
+    estado.ventilacaoAutomatica = ventilacaoAutomaticaState;
+    estado.portaAberta = portaAberta;
+    strncpy(estado.mensagem, mensagemSistema.c_str(), sizeof(estado.mensagem) - 1);
+    estado.contadorLuz = saidaLuz;
+    estado.contadorVentilacao = saidaVentilacao;
+    estado.contadorVentilacaoAuto = saidaVentilacaoAuto;
+    if (!filaEstados.enfileirar(estado)) return; // Web atrasada: tenta na próxima vez
+    ultimoEstadoPublicado = estado;
+    ultimaPublicacaoMs = millis();
+    mensagemSistema = "";                   // Mensagem entregue
 }
 
 // ==============================================================================
-// FUNÇÕES DE CONTROLE (ACIONADAS PELO SERVIDOR WEB)
+// ESCALONADOR COOPERATIVO DE TAREFAS
 // ==============================================================================
 
 /**
- * @brief Controla a iluminação, gerenciando a flag de controle manual.
- * @param ligar Booleano que define se a ação é para ligar (true) ou desligar (false).
+ * @brief Registra uma tarefa no escalonador.
+ * @param nome Nome usado nos relatórios.
+ * @param funcao Função executada pela tarefa.
+ * @param periodoMs Período em ms, PERIODO_CONTINUO ou PERIODO_EVENTO.
+ * @param prioridade 0 = mais prioritária; tarefas de prioridade 0 nunca são adiadas.
+ * @param orcamentoUs Duração máxima esperada; execuções mais longas são contadas como estouro.
+ * @return Identificador da tarefa, ou -1 se o escalonador estiver cheio.
  */
-void controleLuz(bool ligar) {
-    if (ligar) {                                // Se for para ligar
-        if (ocupacao) {                         // Só liga se sala ocupada
-            digitalWrite(PINO_LUZ, HIGH);       // Liga luz
-            iluminacaoState = true;             // Atualiza estado
-            luzDesligadaManualmente = false;    // NOVO: Reseta a flag ao ligar manualmente.
-            mensagemSistema = "Luz ligada com sucesso.";
-        } else {
-            mensagemSistema = "⚠️ N&atilde;o &eacute; poss&iacute;vel ligar a luz: sala est&aacute; vazia.";
+int registrarTarefa(const char *nome, void (*funcao)(), unsigned long periodoMs, byte prioridade, unsigned long orcamentoUs) {
+    if (totalTarefas >= MAX_TAREFAS) return -1;
+    int id = totalTarefas++;
+    Tarefa &t = tarefas[id];
+    memset(&t, 0, sizeof(t));
+    t.nome = nome;
+    t.funcao = funcao;
+    t.periodoUs = (periodoMs == PERIODO_EVENTO) ? PERIODO_EVENTO : periodoMs * 1000UL;
+    t.prioridade = prioridade;
+    t.orcamentoUs = orcamentoUs;
+    t.proximaUs = micros();
+
+    int pos = id;                               // Inserção ordenada por prioridade (estável)
+    while (pos > 0 && tarefas[ordemTarefas[pos - 1]].prioridade > prioridade) {
+        ordemTarefas[pos] = ordemTarefas[pos - 1];
+        pos--;
+    }
+    ordemTarefas[pos] = id;
+    return id;
+}
+
+/**
+ * @brief Pede que uma tarefa por evento seja executada na próxima volta do loop.
+ */
+void sinalizarTarefa(int id) {
+    if (id >= 0 && id < totalTarefas) tarefas[id].sinalizada = true;
+}
+
+/**
+ * @brief Adia a próxima execução de uma tarefa periódica.
+ */
+void reagendarTarefa(int id, unsigned long atrasoMs) {
+    if (id >= 0 && id < totalTarefas) tarefas[id].proximaUs = micros() + atrasoMs * 1000UL;
+}
+
+/**
+ * @brief Executa, por ordem de prioridade, as tarefas vencidas e registra suas estatísticas.
+ * @details Depois que a volta consome ORCAMENTO_VOLTA_US, as tarefas restantes de
+ * prioridade maior que 0 ficam para a próxima volta, para não atrasar o servidor HTTP.
+ */
+void executarEscalonador() {
+    unsigned long inicioVolta = micros();
+    for (int i = 0; i < totalTarefas; i++) {
+        Tarefa &t = tarefas[ordemTarefas[i]];
+        unsigned long agora = micros();
+
+        if (t.periodoUs == PERIODO_EVENTO) {
+            if (!t.sinalizada) continue;
+        } else if ((long)(agora - t.proximaUs) < 0) {
+            continue;                           // Ainda não venceu
         }
-    } else {                                    // Se for para desligar
-        digitalWrite(PINO_LUZ, LOW);            // Desliga luz
-        iluminacaoState = false;                // Atualiza estado
-        if (ocupacao) {                         // NOVO: Se desligou com a sala ocupada...
-            luzDesligadaManualmente = true;     // ...ativa a flag para bloquear o acendimento automático.
+        if (t.prioridade > 0 && agora - inicioVolta >= ORCAMENTO_VOLTA_US) break; // Volta esgotada
+
+        if (t.periodoUs != PERIODO_EVENTO && t.periodoUs != PERIODO_CONTINUO) {
+            if (agora - t.proximaUs > t.periodoUs) t.prazosPerdidos++; // Perdeu um período inteiro
+            t.proximaUs += t.periodoUs;
+            if ((long)(agora - t.proximaUs) >= 0) t.proximaUs = agora + t.periodoUs; // Não tenta recuperar atrasos
         }
-        mensagemSistema = "Luz desligada.";
+        t.sinalizada = false;
+
+        t.funcao();
+
+        unsigned long duracao = micros() - agora;
+        t.execucoes++;
+        t.ultimoUs = duracao;
+        if (duracao > t.maximoUs) t.maximoUs = duracao;
+        if (duracao > t.orcamentoUs) t.estourosOrcamento++;
+        int faixa = 0;
+        while (faixa < FAIXAS_HISTOGRAMA - 1 && (duracao >> (faixa + 1)) != 0) faixa++;
+        t.histograma[faixa]++;
     }
-    redirectToRoot();                           // Redireciona para página principal
+    uint32_t duracaoVolta = micros() - inicioVolta;
+    voltasLoop++;
+    uint32_t coleta = coletasVoltaMax.load(std::memory_order_relaxed);
+    if (coleta != coletaVoltaVista || duracaoVolta > voltaMaxUs.load(std::memory_order_relaxed)) {
+        voltaMaxUs.store(duracaoVolta, std::memory_order_relaxed); // Só o controle escreve o máximo
+    }
+    coletaVoltaVista = coleta;                  // Coleta nova: esta volta abre a janela seguinte
 }
 
+/**
+ * @brief Estima o percentil 99 da duração de uma tarefa a partir do histograma.
+ * @return Limite superior (us) da faixa que contém o p99.
+ */
+unsigned long percentil99Us(const Tarefa &t) {
+    if (t.execucoes == 0) return 0;
+    unsigned long alvo = t.execucoes - t.execucoes / 100; // Execuções até o p99
+    unsigned long acumulado = 0;
+    for (int faixa = 0; faixa < FAIXAS_HISTOGRAMA; faixa++) {
+        acumulado += t.histograma[faixa];
+        if (acumulado >= alvo) return 2UL << faixa;
+    }
+    return t.maximoUs;
+}
 
 /**
- * @brief Controla a ventilação manual, verificando a ocupação da sala.
- * @param ligar Booleano que define se a ação é para ligar (true) ou desligar (false).
+ * @brief Imprime no Serial as estatísticas de execução de cada tarefa e os contadores do RFID.
+ * @details Uma linha por volta, e só quando ela cabe na FIFO da UART: o relatório inteiro
+ * (~1 KB a 115200 baud) travaria o loop por ~90 ms no Serial bloqueante. Enquanto houver
+ * linhas a tarefa se reagenda para a volta seguinte; no fim volta ao período normal.
  */
-void controleVentilacao(bool ligar) {
-    if (ligar) {                                // Se for para ligar
-        if (ocupacao) {                         // Só liga se sala ocupada
-            digitalWrite(PINO_VENTOINHA_MANUAL, HIGH); // Liga ventoinha manual
-            ventilacaoState = true;             // Atualiza estado
-            mensagemSistema = "Ventilacao manual ligada com sucesso.";
-        } else {
-            mensagemSistema = "⚠️ N&atilde;o &eacute; poss&iacute;vel ligar a ventoinha: sala est&aacute; vazia.";
-        }
-    } else {                                    // Se for para desligar
-        digitalWrite(PINO_VENTOINHA_MANUAL, LOW); // Desliga ventoinha manual
-        ventilacaoState = false;                // Atualiza estado
-        mensagemSistema = "Ventilacao manual desligada.";
+void imprimirEstatisticasTarefas() {
+    char texto[FIFO_SERIAL_BYTES];
+    int tamanho = formatarLinhaRelatorio(linhaRelatorio, texto, sizeof(texto));
+    if (tamanho == 0) {                         // Relatório completo: o próximo sai depois de um período
+        linhaRelatorio = 0;
+        return;
+    }
+    int livre = Serial.availableForWrite();
+    if (livre >= tamanho || livre >= FIFO_SERIAL_BYTES) { // Cabe (ou a FIFO está vazia): não bloqueia
+        Serial.write((const uint8_t *)texto, tamanho);
+        linhaRelatorio++;
     }
-    redirectToRoot();                           // Redireciona para página principal
+    reagendarTarefa(tarefaEstatisticas, 0);
+}
+
+/**
+ * @brief Formata uma linha do relatório de estatísticas.
+ * @return Bytes escritos em 'texto', ou 0 se 'linha' passou da última.
+ */
+int formatarLinhaRelatorio(int linha, char *texto, size_t tamanho) {
+    int n = 0;
+    if (linha == 0) return snprintf(texto, tamanho, "TAREFA        EXEC      ULT(us)  MAX(us)  P99(us)  PRAZO  ORCAM\n");
+    linha--;
+    if (linha < totalTarefas) {
+        const Tarefa &t = tarefas[ordemTarefas[linha]];
+        n = snprintf(texto, tamanho, "%-12s %8lu %8lu %8lu %8lu %6lu %6lu\n", t.nome, t.execucoes, t.ultimoUs,
+                     t.maximoUs, percentil99Us(t), t.prazosPerdidos, t.estourosOrcamento);
+        return n < (int)tamanho ? n : (int)tamanho - 1;
+    }
+    linha -= totalTarefas;
+    if (linha < 2 * totalLeitores) {            // Duas linhas por leitor
+        const LeitorRFID &l = leitores[linha / 2];
+        if (linha % 2 == 0) {
+            n = snprintf(texto, tamanho, "RFID %-8s consultas %lu, IRQs %lu, cartoes %lu, repetidas %lu\n", l.nome,
+                         l.consultas.ler(), l.interrupcoes, l.cartoes.ler(), l.suprimidas.ler());
+        } else {
+            n = snprintf(texto, tamanho, "RFID %-8s consulta max %lu us, intervalo max %lu ms\n", l.nome,
+                         l.consultaMaxUs, l.intervaloMaxMs);
+        }
+        return n < (int)tamanho ? n : (int)tamanho - 1;
+    }
+    linha -= 2 * totalLeitores;
+    unsigned long comandos = 0;
+    unsigned long naoMembros = rejeitadosBloom + falsosPositivosBloom; // Cartões não cadastrados
+    switch (linha) {
+    case 0:
+        n = snprintf(texto, tamanho, "HTTP: %lu conexoes aceitas, %lu expiradas\n", conexoesAceitas.ler(),
+                     conexoesExpiradas.ler());
+        break;
+    case 1:
+        n = snprintf(texto, tamanho, "HTTP: respostas %lu montadas, %lu do cache, %lu 304\n", respostasRenderizadas.ler(),
+                     respostasDoCache.ler(), respostasNaoModificadas.ler());
+        break;
+    case 2:
+        n = snprintf(texto, tamanho, "Ocupacao: distancia filtrada %u cm, %lu trocas, %lu suprimidas pelo filtro\n",
+                     (unsigned)distanciaFiltradaCm.load(std::memory_order_relaxed), (unsigned long)trocasOcupacao,
+                     (unsigned long)trocasSuprimidas);
+        break;
+    case 3:
+        for (int t = 0; t < TIPOS_COMANDO; t++) {
+            for (int f = 0; f < FAIXAS_LATENCIA_COMANDO; f++) comandos += latenciaComando[t][f];
+        }
+        n = snprintf(texto, tamanho, "Comandos: %lu aplicados, %lu descartados (fila cheia), latencia max %lu us\n",
+                     comandos, (unsigned long)comandosDescartados, (unsigned long)latenciaComandoMaxUs);
+        break;
+    case 4:
+        n = snprintf(texto, tamanho, "Bloom: %lu consultas, %lu rejeitadas, %lu falsos positivos (%.1f%%)\n",
+                     consultasBloom.ler(), rejeitadosBloom.ler(), falsosPositivosBloom.ler(),
+                     naoMembros ? 100.0 * falsosPositivosBloom / naoMembros : 0.0);
+        break;
+    default:
+        return 0;
+    }
+    return n < (int)tamanho ? n : (int)tamanho - 1;
+}
+
+// ==============================================================================
+// FUNÇÕES PRINCIPAIS DE LÓGICA
+// ==============================================================================
+
+/**
+ * @brief Desliga a luz e a ventoinha manual se a sala estiver vazia para economizar energia.
+ * @note Esta função não afeta a ventoinha automática de temperatura.
+ */
+void verificarDesligamentoPorAusencia() {
+    // Se a sala NÃO está ocupada E (a luz está ligada OU a ventoinha manual está ligada)
+    if (!ocupacao && (iluminacaoState || ventilacaoState)) {
+        acionarSaida(PINO_LUZ, saidaLuz, false); // Desliga luz
+        iluminacaoState = false;                // Atualiza estado da luz
+        acionarSaida(PINO_VENTOINHA_MANUAL, saidaVentilacao, false); // Desliga ventoinha manual
+        ventilacaoState = false;                // Atualiza estado da ventoinha manual
+        mensagemSistema = "Luz e ventoinha manual desligadas por ausência."; // Mensagem para web/LCD
+        versaoEstado++;
+        Serial.println("AUTOMAÇÃO: Luz e ventoinha manual desligadas, sala vazia."); // Debug
+        publicarEstado();                       // Publica já, antes que outra mensagem a sobrescreva
+    }
+}
+
+/**
+ * @brief Atende um leitor RFID por chamada (rodízio), verifica a autorização e controla a cancela.
+ * @details O cartão é detectado pela linha IRQ: sem interrupção pendente o leitor só recebe
+ * um novo REQA a cada 'intervaloReqaMs' (seis escritas SPI, nenhuma leitura), em vez do
+ * PICC_IsNewCardPresent() completo a cada volta. A RxIEn fica mascarada da resposta até o
+ * próximo REQA, então os quadros da leitura não marcam o leitor de novo. O rodízio avança sempre, então nenhum leitor
+ * fica sem ser atendido. Durante um feedback só o leitor que o disparou fica parado: os
+ * outros continuam consultados, e um cartão lido neles fica pendente (um por leitor) até o
+ * feedback terminar, porque LCD, buzzer e servo são um só. Fora isso a decisão é tomada na
+ * hora; o feedback é montado como um roteiro de passos temporizados que
+ * executarSequenciaFeedback() percorre sem bloquear.
+ */
+void lerRfid(void) {
+    bool emFeedback = feedbackEmAndamento();
+    if (!emFeedback) {                          // Cartões que esperaram o feedback, na ordem do rodízio
+        for (int i = 0; i < totalLeitores; i++) {
+            LeitorRFID &l = leitores[(proximoLeitor + i) % totalLeitores];
+            if (!l.temPendente) continue;
+            l.temPendente = false;
+            decidirAcesso((proximoLeitor + i) % totalLeitores, l.pendente);
+            return;
+        }
+    }
+    int indiceLeitor = proximoLeitor;
+    proximoLeitor = (proximoLeitor + 1) % totalLeitores;
+    LeitorRFID &leitor = leitores[indiceLeitor];
+    MFRC522 &rfid = leitor.rfid;
+    if (emFeedback && indiceLeitor == leitorFeedback) return; // Cartão ainda diante do LCD/buzzer
+    if (leitor.temPendente) return;             // Já tem um cartão esperando a vez
+
+    unsigned long agoraMs = millis();
+    bool respondeu = leitor.cartaoNoCampo;
+    if (!respondeu && agoraMs - leitor.ultimoReqaMs < intervaloReqaMs) return; // Nada a fazer: sem SPI
+
+    if (leitor.consultas > 0 && agoraMs - leitor.ultimaConsultaMs > leitor.intervaloMaxMs) {
+        leitor.intervaloMaxMs = agoraMs - leitor.ultimaConsultaMs;
+    }
+    leitor.ultimaConsultaMs = agoraMs;
+    leitor.consultas++;
+    unsigned long inicioUs = micros();
+    bool novoCartao = false;
+    if (respondeu) {                            // Um cartão respondeu ao último REQA
+        rfid.PCD_WriteRegister(MFRC522::ComIEnReg, 0x80); // Só IRqInv: a leitura não sinaliza a IRQ
+        leitor.cartaoNoCampo = false;
+        leitor.interrupcoes++;
+        novoCartao = rfid.PICC_ReadCardSerial();
+    }
+    if (!novoCartao) armarReqa(leitor);         // Sem cartão (ou resposta com erro): novo REQA
+    unsigned long duracaoUs = micros() - inicioUs;
+    if (duracaoUs > leitor.consultaMaxUs) leitor.consultaMaxUs = duracaoUs;
+    if (!novoCartao) return;                    // Se não há novo cartão, sai
+
+    ChaveUID chave = criarChaveUID(rfid.uid.uidByte, rfid.uid.size);
+    if (leituraRepetida(leitor, chave)) {       // Cartão parado no leitor: nenhum efeito colateral
+        pararCartao(leitor);
+        return;
+    }
+    leitor.cartoes++;
+    pararCartao(leitor);                        // Finaliza comunicação com cartão (REQA na próxima visita)
+    rfid.PCD_StopCrypto1();                     // Finaliza criptografia
+    if (emFeedback) {                           // Decide quando o feedback em andamento terminar
+        leitor.pendente = chave;
+        leitor.temPendente = true;
+        return;
+    }
+    decidirAcesso(indiceLeitor, chave);
+}
+
+/**
+ * @brief Verifica a autorização de um cartão lido, atualiza a porta e monta o feedback.
+ */
+void decidirAcesso(int indiceLeitor, const ChaveUID &chave) {
+    LeitorRFID &leitor = leitores[indiceLeitor];
+    char uidTexto[2 * TAMANHO_MAX_UID + 1];
+    formatarChave(chave, uidTexto);
+    Serial.printf(">> Leitor %s, UID: %s\n", leitor.nome, uidTexto); // Debug
+
+    // Verifica se UID lido está na lista de autorizados
+    byte horario = HORARIO_SEMPRE;
+    const char *encontrado = buscarUsuario(chave, horario);
+    bool foraDoHorario = (encontrado != nullptr && !dentroDoHorario(horario));
+    bool autorizado = (encontrado != nullptr && !foraDoHorario); // Flag de autorização
+    static char nomeUsuario[sizeof(RegistroUsuario::nome)]; // Cópia: a tabela pode ser trocada durante o feedback
+    strncpy(nomeUsuario, autorizado ? encontrado : "", sizeof(nomeUsuario) - 1);
+
+    iniciarSequencia();                         // Monta o feedback, executado depois pelo loop()
+    chaveFeedback = chave;
+    leitorFeedback = indiceLeitor;
+
+    if (autorizado) {                           // Se autorizado
+        Serial.print(">> Usuario: ");
+        Serial.println(nomeUsuario);            // Debug
+        adicionarTexto("Bem-vindo:", nomeUsuario, 1500); // Mostra nome do usuário
+        adicionarPasso(PASSO_SOLTA_SERVO, 0, 0, 100);    // Desanexa servo (proteção)
+        adicionarPasso(PASSO_TOM, 659, 150, 200);
+        adicionarPasso(PASSO_TOM, 784, 150, 200);
+        adicionarPasso(PASSO_TOM, 880, 150, 200);
+        adicionarPasso(PASSO_SILENCIO, 0, 0, 0);         // Para buzzer
+        adicionarPasso(PASSO_PRENDE_SERVO, 0, 0, 250);   // Reanexa servo
+
+        if (!portaAberta) {                     // Se porta está fechada
+            portaAberta = true;                 // Atualiza estado
+            versaoEstado++;
+            ultimoUID = chave;                  // Salva UID
+            registrarEvento(EVENTO_ABERTURA, chave);
+            Serial.println(">> Porta ABERTA."); // Debug
+            adicionarPasso(PASSO_POSICIONA_SERVO, posicaoAberta, 0, 100); // Abre porta
+            adicionarTexto("Porta: ABERTA", "", 0);
+            adicionarPasso(PASSO_SOLTA_SERVO, 0, 0, 600);
+            adicionarPasso(PASSO_TOM, 1000, 150, 200); // Buzzer: nota aguda
+            adicionarPasso(PASSO_TOM, 1500, 150, 200); // Buzzer: nota mais aguda
+            adicionarPasso(PASSO_SILENCIO, 0, 0, 0);
+            adicionarPasso(PASSO_PRENDE_SERVO, 0, 0, 250);
+
+        } else if (chavesIguais(chave, ultimoUID)) { // Mesmo usuário fecha
+            portaAberta = false;                // Atualiza estado
+            versaoEstado++;
+            registrarEvento(EVENTO_FECHAMENTO, chave);
+            Serial.println(">> Porta FECHADA.");// Debug
+            adicionarPasso(PASSO_POSICIONA_SERVO, posicaoFechada, 0, 0); // Fecha porta
+            adicionarTexto("Porta: FECHADA", "", 0);
+        } else {                                // Outro usuário tenta fechar
+            Serial.println(">> Outro usuario tentou fechar a porta.");
+            registrarEvento(EVENTO_JA_ABERTA, chave);
+            adicionarTexto("Ja aberta por", "outro usuario", 0);
+            adicionarPasso(PASSO_SOLTA_SERVO, 0, 0, 100);
+            adicionarPasso(PASSO_TOM, 750, 200, 200); // Aviso sonoro mediano de 200ms
+            adicionarPasso(PASSO_TOM, 750, 200, 200);
+            adicionarPasso(PASSO_SILENCIO, 0, 0, 0);
+            adicionarPasso(PASSO_PRENDE_SERVO, 0, 0, 250);
+        }
+    } else {                                    // Se não autorizado
+        Serial.println(foraDoHorario ? ">> Acesso Negado (fora do horario)." : ">> Acesso Negado."); // Debug
+        registrarEvento(foraDoHorario ? EVENTO_FORA_HORARIO : EVENTO_NEGADO, chave);
+        adicionarTexto("Acesso NEGADO", foraDoHorario ? "Fora do horario" : "Cartao invalido", 100);
+        adicionarPasso(PASSO_SOLTA_SERVO, 0, 0, 100);
+        adicionarPasso(PASSO_TOM, 300, 250, 250); // Buzzer: 2 bipes graves
+        adicionarPasso(PASSO_TOM, 300, 250, 250);
+        adicionarPasso(PASSO_SILENCIO, 0, 0, 0);
+        adicionarPasso(PASSO_PRENDE_SERVO, 0, 0, 250);
+    }
+
+    adicionarPausa(1500);                       // Pausa para feedback antes de liberar o leitor
+    adicionarPasso(PASSO_FIM, 0, 0, 0);
+}
+
+/**
+ * @brief Empacota o UID lido numa ChaveUID (bytes não usados zerados).
+ */
+ChaveUID criarChaveUID(const byte *uid, byte tamanho) {
+    ChaveUID chave = {};
+    if (tamanho > TAMANHO_MAX_UID) tamanho = TAMANHO_MAX_UID;
+    chave.uid.tamanho = tamanho;
+    memcpy(chave.uid.bytes, uid, tamanho);
+    return chave;
+}
+
+/**
+ * @brief Inicia os leitores descritos em 'pinosLeitores' (até MAX_LEITORES_RFID).
+ * @details Todos os SS vão a nível alto antes do primeiro acesso ao barramento. A tabela de
+ * ligações é um global, como 'portaHttp', para que os testes de host montem leitores
+ * simulados em outros pinos antes do setup(); o período da tarefa "rfid" segue 'totalLeitores'
+ * e, sem nenhum leitor, a tarefa nem é registrada.
+ */
+void iniciarLeitoresRfid() {
+    totalLeitores = quantidadeLeitores < MAX_LEITORES_RFID ? quantidadeLeitores : MAX_LEITORES_RFID;
+    for (int i = 0; i < totalLeitores; i++) {
+        pinMode(pinosLeitores[i].pinoSS, OUTPUT);
+        digitalWrite(pinosLeitores[i].pinoSS, HIGH);
+    }
+    for (int i = 0; i < totalLeitores; i++) {
+        LeitorRFID &l = leitores[i];
+        l.pinoSS = pinosLeitores[i].pinoSS;
+        l.pinoIRQ = pinosLeitores[i].pinoIRQ;
+        l.nome = pinosLeitores[i].nome;
+        l.rfid.PCD_Init(l.pinoSS, PINO_RFID_RST);
+        iniciarLeitorIRQ(l);                // Detecção de cartão pela linha IRQ
+    }
+}
+
+/**
+ * @brief Configura o MFRC522 para sinalizar pela linha IRQ quando um cartão responde.
+ * @details Só a interrupção de recepção (RxIEn) é habilitada, com a linha invertida (ativa em
+ * nível baixo) e em push-pull, dispensando resistor de pull-up nos pinos 34/35.
+ */
+void iniciarLeitorIRQ(LeitorRFID &leitor) {
+    pinMode(leitor.pinoIRQ, INPUT);
+    leitor.rfid.PCD_WriteRegister(MFRC522::ComIEnReg, 0x80); // IRqInv; armarReqa() liga a RxIEn
+    leitor.rfid.PCD_WriteRegister(MFRC522::DivIEnReg, 0x80); // IRQPushPull
+    leitor.cartaoNoCampo = false;
+    attachInterruptArg(digitalPinToInterrupt(leitor.pinoIRQ), isrRfid, &leitor, FALLING);
+    armarReqa(leitor);
+}
+
+/**
+ * @brief Transmite um REQA de 7 bits; se um cartão estiver no campo, a resposta (ATQA) aciona a IRQ.
+ * @details O MFRC522 não repete o REQA sozinho: um cartão que entra no campo só responde ao
+ * próximo REQA, daí o rearme periódico. As interrupções e a marca do leitor são limpas antes
+ * de religar a RxIEn, então só a resposta a este REQA pode marcá-lo.
+ */
+void armarReqa(LeitorRFID &leitor) {
+    MFRC522 &rfid = leitor.rfid;
+    rfid.PCD_WriteRegister(MFRC522::ComIrqReg, 0x7F);        // Limpa todas as interrupções
+    rfid.PCD_WriteRegister(MFRC522::FIFOLevelReg, 0x80);     // Descarta o que sobrou na FIFO
+    leitor.cartaoNoCampo = false;
+    rfid.PCD_WriteRegister(MFRC522::ComIEnReg, 0xA0);        // IRqInv | RxIEn
+    rfid.PCD_WriteRegister(MFRC522::FIFODataReg, MFRC522::PICC_CMD_REQA);
+    rfid.PCD_WriteRegister(MFRC522::CommandReg, MFRC522::PCD_Transceive);
+    rfid.PCD_WriteRegister(MFRC522::BitFramingReg, 0x87);    // StartSend, 7 bits no último byte
+    leitor.ultimoReqaMs = millis();
+}
+
+/**
+ * @brief Transmite o HLTA (com o CRC_A já calculado) e volta sem esperar resposta.
+ * @details PICC_HaltA() espera o timeout de 25 ms do MFRC522, porque o HLTA nunca tem
+ * resposta. Aqui o quadro só é posto no ar; a RxIEn continua mascarada e o próximo REQA sai
+ * na próxima visita ao leitor, depois de 'intervaloReqaMs'.
+ */
+void pararCartao(LeitorRFID &leitor) {
+    MFRC522 &rfid = leitor.rfid;
+    rfid.PCD_WriteRegister(MFRC522::CommandReg, MFRC522::PCD_Idle);
+    rfid.PCD_WriteRegister(MFRC522::ComIrqReg, 0x7F);
+    rfid.PCD_WriteRegister(MFRC522::FIFOLevelReg, 0x80);
+    const byte quadro[] = {MFRC522::PICC_CMD_HLTA, 0x00, 0x57, 0xCD}; // HLTA + CRC_A
+    for (byte b : quadro) rfid.PCD_WriteRegister(MFRC522::FIFODataReg, b);
+    rfid.PCD_WriteRegister(MFRC522::CommandReg, MFRC522::PCD_Transceive);
+    rfid.PCD_WriteRegister(MFRC522::BitFramingReg, 0x80);    // StartSend, 8 bits
+    leitor.ultimoReqaMs = millis();
+}
+
+/**
+ * @brief Interrupção da linha IRQ: apenas marca o leitor; o SPI fica para lerRfid().
+ */
+void IRAM_ATTR isrRfid(void *arg) {
+    static_cast<LeitorRFID *>(arg)->cartaoNoCampo = true;
+}
+
+/**
+ * @brief Verifica se o cartão foi lido há menos de 'janelaRepeticaoMs' (ainda no campo).
+ * @details Cada leitor tem sua própria tabela. Repetições renovam a janela e só
+ * incrementam 'suprimidas'. Um cartão novo ocupa a entrada mais antiga da tabela.
+ */
+bool leituraRepetida(LeitorRFID &leitor, const ChaveUID &chave) {
+    unsigned long agora = millis();
+    for (int i = 0; i < MAX_LEITURAS_RECENTES; i++) {
+        LeituraRecente &l = leitor.recentes[i];
+        if (!chavesIguais(l.chave, chave)) continue;
+        bool repetida = (agora - l.ultimoMs < janelaRepeticaoMs);
+        l.ultimoMs = agora;
+        if (repetida) leitor.suprimidas++;
+        return repetida;
+    }
+    renovarLeituraRecente(leitor, chave);
+    return false;
+}
+
+/**
+ * @brief Reinicia a janela de um cartão, inserindo-o no lugar da entrada mais antiga se preciso.
+ */
+void renovarLeituraRecente(LeitorRFID &leitor, const ChaveUID &chave) {
+    LeituraRecente *recentes = leitor.recentes;
+    unsigned long agora = millis();
+    int alvo = 0;
+    for (int i = 0; i < MAX_LEITURAS_RECENTES; i++) {
+        if (chavesIguais(recentes[i].chave, chave)) {
+            alvo = i;
+            break;
+        }
+        if (agora - recentes[i].ultimoMs > agora - recentes[alvo].ultimoMs) alvo = i;
+    }
+    recentes[alvo].chave = chave;
+    recentes[alvo].ultimoMs = agora;
+}
+
+/**
+ * @brief Compara duas chaves palavra a palavra (o tamanho faz parte da primeira palavra).
+ */
+bool chavesIguais(const ChaveUID &a, const ChaveUID &b) {
+    return ((a.palavras[0] ^ b.palavras[0]) | (a.palavras[1] ^ b.palavras[1]) | (a.palavras[2] ^ b.palavras[2])) == 0;
+}
+
+/**
+ * @brief Espalha a chave (combina as 3 palavras e aplica o finalizador do MurmurHash3).
+ */
+uint32_t hashChave(const ChaveUID &chave) {
+    uint32_t h = chave.palavras[0] ^ (chave.palavras[1] * 0x9E3779B1) ^ (chave.palavras[2] * 0x85EBCA77);
+    h ^= h >> 16;
+    h *= 0x85EBCA6B;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35;
+    h ^= h >> 16;
+    return h;
+}
+
+/**
+ * @brief Escreve o UID em hexadecimal; 'saida' precisa de 2 * TAMANHO_MAX_UID + 1 bytes.
+ */
+void formatarChave(const ChaveUID &chave, char *saida) {
+    static const char hex[] = "0123456789ABCDEF";
+    for (byte i = 0; i < chave.uid.tamanho; i++) {
+        *saida++ = hex[chave.uid.bytes[i] >> 4];
+        *saida++ = hex[chave.uid.bytes[i] & 0x0F];
+    }
+    *saida = '\0';
+}
+
+/**
+ * @brief Monta o índice hash (sondagem linear) sobre usuariosAutorizados[], sem heap.
+ */
+void construirIndiceUID() {
+    for (int i = 0; i < CAPACIDADE_INDICE_UID; i++) indiceUID[i] = POSICAO_VAZIA;
+    limparBloom();
+    for (int i = 0; i < totalUsuarios; i++) {
+        adicionarBloom(usuariosAutorizados[i].chave);
+        uint32_t pos = hashChave(usuariosAutorizados[i].chave) & (CAPACIDADE_INDICE_UID - 1);
+        while (indiceUID[pos] != POSICAO_VAZIA) pos = (pos + 1) & (CAPACIDADE_INDICE_UID - 1);
+        indiceUID[pos] = i;
+    }
+}
+
+/**
+ * @brief Busca um usuário autorizado pelo UID em tempo constante (esperado).
+ * @details Usa a tabela mapeada da flash quando existe; senão, a lista compilada.
+ * @param horario Recebe o horário de acesso do usuário encontrado.
+ * @return Nome do usuário, ou nullptr se o UID não estiver cadastrado.
+ */
+const char *buscarUsuario(const ChaveUID &chave, byte &horario) {
+    consultasBloom++;
+    if (!talvezNoBloom(chave)) {                // Maioria dos cartões desconhecidos para aqui
+        rejeitadosBloom++;
+        return nullptr;
+    }
+    const char *nome = nullptr;
+    if (imagemUsuarios != nullptr) {
+        const RegistroUsuario *registro = buscarUsuarioFlash(chave);
+        if (registro != nullptr) {
+            nome = registro->nome;
+            horario = registro->horario;
+        }
+    } else {
+        uint32_t pos = hashChave(chave) & (CAPACIDADE_INDICE_UID - 1);
+        while (indiceUID[pos] != POSICAO_VAZIA) { // Ocupação <= 50%: poucas sondagens
+            const Usuario &u = usuariosAutorizados[indiceUID[pos]];
+            if (chavesIguais(chave, u.chave)) {
+                nome = u.nome;
+                horario = u.horario;
+                break;
+            }
+            pos = (pos + 1) & (CAPACIDADE_INDICE_UID - 1);
+        }
+    }
+    if (nome == nullptr) falsosPositivosBloom++;
+    return nome;
+}
+
+/**
+ * @brief Compila regrasHorarios[] em mapas de 7 x 96 bits (um bit por quarto de hora).
+ */
+void compilarHorarios() {
+    memset(mapasHorarios, 0, sizeof(mapasHorarios));
+    for (const RegraHorario &r : regrasHorarios) {
+        if (r.horario >= MAX_HORARIOS) continue;
+        for (int dia = 0; dia < 7; dia++) {
+            if (!(r.dias & (1 << dia))) continue;
+            for (int q = r.inicioQuarto; q < r.fimQuarto && q < QUARTOS_POR_DIA; q++) {
+                mapasHorarios[r.horario][dia][q >> 3] |= 1 << (q & 7);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Verifica se o horário libera o acesso agora (um teste de bit).
+ * @details Sem hora sincronizada por SNTP, só HORARIO_SEMPRE é liberado.
+ */
+bool dentroDoHorario(byte horario) {
+    if (horario == HORARIO_SEMPRE) return true;
+    if (horario >= MAX_HORARIOS) return false;
+    time_t agora = time(nullptr);
+    if (agora < EPOCH_MINIMO_SNTP) return false; // Relógio ainda não sincronizado
+    struct tm local;
+    localtime_r(&agora, &local);
+    int q = local.tm_hour * 4 + local.tm_min / 15;
+    return mapasHorarios[horario][local.tm_wday][q >> 3] & (1 << (q & 7));
+}
+
+/**
+ * @brief Zera o filtro de Bloom (antes de reconstruí-lo para uma nova tabela).
+ */
+void limparBloom() {
+    memset(filtroBloom, 0, sizeof(filtroBloom));
+}
+
+/**
+ * @brief Marca uma chave no filtro (hash duplo: h1 + i*h2).
+ */
+void adicionarBloom(const ChaveUID &chave) {
+    uint32_t h1 = hashChave(chave);
+    uint32_t h2 = ((h1 >> 17) | (h1 << 15)) * 0x9E3779B1 | 1;
+    for (int i = 0; i < HASHES_BLOOM; i++) {
+        uint32_t bit = (h1 + i * h2) & (BITS_BLOOM - 1);
+        filtroBloom[bit >> 5] |= 1UL << (bit & 31);
+    }
+}
+
+/**
+ * @brief Testa uma chave no filtro.
+ * @return false se a chave certamente não está cadastrada; true se talvez esteja.
+ */
+bool talvezNoBloom(const ChaveUID &chave) {
+    uint32_t h1 = hashChave(chave);
+    uint32_t h2 = ((h1 >> 17) | (h1 << 15)) * 0x9E3779B1 | 1;
+    for (int i = 0; i < HASHES_BLOOM; i++) {
+        uint32_t bit = (h1 + i * h2) & (BITS_BLOOM - 1);
+        if ((filtroBloom[bit >> 5] & (1UL << (bit & 31))) == 0) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Reinicia a sequência de feedback para que um novo roteiro seja montado.
+ */
+void iniciarSequencia() {
+    totalPassos = 0;
+    passoAtual = 0;
+    proximoPassoMs = millis();                  // Primeiro passo executa na próxima volta do loop
+}
+
+/**
+ * @brief Acrescenta um passo ao roteiro de feedback.
+ * @param acao Ação a executar.
+ * @param valor Frequência do tom (Hz) ou posição do servo (us), conforme a ação.
+ * @param duracao Duração do tom (ms).
+ * @param espera Tempo até o próximo passo (ms).
+ * @return Ponteiro para o passo criado, ou nullptr se o roteiro estiver cheio.
+ */
+PassoFeedback *adicionarPasso(AcaoPasso acao, int valor, unsigned int duracao, unsigned int espera) {
+    if (totalPassos >= MAX_PASSOS_FEEDBACK) return nullptr; // Roteiro cheio: descarta o passo
+    PassoFeedback &p = sequenciaFeedback[totalPassos++];
+    p.acao = acao;
+    p.valor = valor;
+    p.duracao = duracao;
+    p.linha1 = "";
+    p.linha2 = "";
+    p.espera = espera;
+    return &p;
+}
+
+/**
+ * @brief Acrescenta um passo que limpa o LCD e escreve duas linhas.
+ */
+void adicionarTexto(const char *linha1, const char *linha2, unsigned int espera) {
+    PassoFeedback *p = adicionarPasso(PASSO_LCD, 0, 0, espera);
+    if (p == nullptr) return;
+    p->linha1 = linha1;
+    p->linha2 = linha2;
+}
+
+/**
+ * @brief Estende a espera do último passo do roteiro (equivalente a um delay()).
+ */
+void adicionarPausa(unsigned int espera) {
+    if (totalPassos > 0) sequenciaFeedback[totalPassos - 1].espera += espera;
+}
+
+/**
+ * @brief Indica se há uma sequência de feedback (LCD/buzzer/servo) em andamento.
+ */
+bool feedbackEmAndamento() {
+    return passoAtual < totalPassos;
+}
+
+/**
+ * @brief Executa no máximo um passo da sequência de feedback por volta do loop.
+ * @details Substitui os delay() que antes travavam o loop por vários segundos a cada
+ * leitura de cartão. Cada passo agenda o seguinte através de 'proximoPassoMs'.
+ */
+void executarSequenciaFeedback() {
+    if (!feedbackEmAndamento()) return;         // Nada a fazer
+    if ((long)(millis() - proximoPassoMs) < 0) return; // Ainda não é hora do próximo passo
+
+    const PassoFeedback &p = sequenciaFeedback[passoAtual++];
+    switch (p.acao) {
+    case PASSO_LCD:                             // Só o quadro em RAM; atualizarLcd() desenha
+        escreverLcd(0, p.linha1);
+        escreverLcd(1, p.linha2);
+        break;
+    case PASSO_TOM:
+        tone(PINO_BUZZER, p.valor, p.duracao);
+        break;
+    case PASSO_SILENCIO:
+        noTone(PINO_BUZZER);                    // Para buzzer
+        break;
+    case PASSO_SOLTA_SERVO:
+        ServoPorta.detach();                    // Desanexa servo (proteção)
+        break;
+    case PASSO_PRENDE_SERVO:
+        ServoPorta.attach(servo, 500, 2500);    // Reanexa servo
+        break;
+    case PASSO_POSICIONA_SERVO:
+        ServoPorta.writeMicroseconds(p.valor);
+        break;
+    case PASSO_FIM:
+        break;
+    }
+    proximoPassoMs += p.espera;                 // Agenda relativo ao passo anterior (sem deriva)
+    if ((long)(millis() - proximoPassoMs) > 0) proximoPassoMs = millis(); // Loop atrasado: não acumula passos
+
+    if (!feedbackEmAndamento()) {
+        reagendarTarefa(tarefaDht, intervaloLeituraTemp); // Mantém o feedback no LCD antes da temp/umi
+        renovarLeituraRecente(leitores[leitorFeedback], chaveFeedback); // A janela anti-repetição conta a partir do fim do feedback
+    }
+}
+
+/**
+ * @brief Filtra a última distância do ultrassônico, atualiza 'ocupacao' e gerencia a luz automática.
+ * @details A medição é feita em segundo plano (timer + interrupção), então esta função
+ * custa microssegundos. Cada amostra nova passa pela mediana móvel e pela EMA, e a ocupação
+ * usa histerese: entra com a distância filtrada até DISTANCIA_PRESENCA_CM e só sai acima de
+ * DISTANCIA_AUSENCIA_CM. Um zero ou um máximo isolado não derruba mais a luz nem a ventoinha.
+ * A luz só acende automaticamente se não tiver sido desligada manualmente
+ * enquanto a sala estava ocupada. A flag é resetada quando a sala fica vazia.
+ */
+void atualizarEstadoOcupacao() {
+    uint32_t amostra = amostraUltrassom.load(std::memory_order_acquire); // Última amostra publicada
+    uint16_t sequencia = amostra >> 16;
+    if (sequencia != ultimaSequenciaUltrassom) { // Só filtra amostras novas (a tarefa roda a cada 60ms)
+        ultimaSequenciaUltrassom = sequencia;
+        uint16_t distancia = amostra & 0xFFFF;
+        if (distancia == 0) distancia = DISTANCIA_SEM_ECO_CM;
+        bool brutaAnterior = presencaBruta;
+        presencaBruta = distancia <= DISTANCIA_PRESENCA_CM;
+        uint16_t filtrada = filtrarDistancia(filtroUltrassom, distancia);
+        distanciaFiltradaCm.store(filtrada, std::memory_order_relaxed);
+        bool presencaFiltrada = ocupacao ? filtrada <= DISTANCIA_AUSENCIA_CM : filtrada <= DISTANCIA_PRESENCA_CM;
+        if (presencaFiltrada != ocupacao) {
+            versaoEstado++;
+            trocasOcupacao++;
+        } else if (presencaBruta != brutaAnterior) {
+            trocasSuprimidas++;                 // O critério antigo teria trocado aqui
+        }
+        ocupacao = presencaFiltrada;
+    }
+    bool presencaAtual = ocupacao;
+
+    if (presencaAtual) {
+        if (tempoInicioPresenca == 0) {
+            tempoInicioPresenca = millis();
+        }
+        // ALTERADO: Adicionado a verificação '!luzDesligadaManualmente'
+        // A luz só liga automaticamente se a flag de desligamento manual não estiver ativa.
+        if ((millis() - tempoInicioPresenca >= tempoMinimoPresenca) && !iluminacaoState && !luzDesligadaManualmente) {
+            Serial.println("AUTOMAÇÃO: Presença detectada. Ligando a luz.");
+            controleLuz(true); // A própria função controleLuz(true) vai resetar a flag.
+        }
+    } else { // Se a sala está vazia
+        tempoInicioPresenca = 0;
+        // NOVO: Reseta a flag quando a sala fica vazia.
+        // Isso permite que a luz acenda automaticamente na próxima vez que alguém entrar.
+        luzDesligadaManualmente = false;
+    }
+}
+
+/**
+ * @brief Acrescenta uma amostra ao filtro e devolve a distância filtrada (cm).
+ * @details A janela fica duplicada: em anel, para saber qual amostra sai, e ordenada, para
+ * a mediana ser só o elemento do meio. A amostra que sai é achada por busca binária e a
+ * nova entra deslocando no máximo JANELA_ULTRASSOM - 1 posições: O(N), que com N = 7 custa
+ * menos que qualquer estrutura mais esperta.
+ * A EMA (alfa = 1/4, em ponto fixo) suaviza a mediana sem ponto flutuante.
+ */
+uint16_t filtrarDistancia(FiltroDistancia &filtro, uint16_t distanciaCm) {
+    int n = filtro.preenchidas;
+    int pos;
+    if (n == JANELA_ULTRASSOM) {                // Janela cheia: remove a amostra mais antiga
+        uint16_t saindo = filtro.janela[filtro.proxima];
+        int baixo = 0, alto = n - 1;
+        while (baixo < alto) {                  // Primeira posição com valor >= 'saindo'
+            int meio = (baixo + alto) / 2;
+            if (filtro.ordenadas[meio] < saindo) baixo = meio + 1;
+            else alto = meio;
+        }
+        pos = baixo;
+        n--;
+    } else {
+        pos = n;
+        filtro.preenchidas++;
+    }
+    while (pos > 0 && filtro.ordenadas[pos - 1] > distanciaCm) { // Reabre a vaga na posição certa
+        filtro.ordenadas[pos] = filtro.ordenadas[pos - 1];
+        pos--;
+    }
+    while (pos < n && filtro.ordenadas[pos + 1] < distanciaCm) {
+        filtro.ordenadas[pos] = filtro.ordenadas[pos + 1];
+        pos++;
+    }
+    filtro.ordenadas[pos] = distanciaCm;
+    filtro.janela[filtro.proxima] = distanciaCm;
+    filtro.proxima = (filtro.proxima + 1) % JANELA_ULTRASSOM;
+
+    int32_t mediana = filtro.ordenadas[filtro.preenchidas / 2];
+    if (filtro.preenchidas == 1) filtro.mediaX16 = mediana * 16; // Primeira amostra: sem histórico
+    else filtro.mediaX16 += (mediana * 16 - filtro.mediaX16) / 4;
+    return (filtro.mediaX16 + 8) / 16;
+}
+
+
+// ==============================================================================
+// BANCO DE USUÁRIOS EM FLASH (IMAGENS A/B)
+// ==============================================================================
+
+/**
+ * @brief Abre a partição de usuários e mapeia a imagem válida de maior geração.
+ * @details Executada no setup() e, depois, só pelo controle (núcleo 1) quando a web
+ * avisa que gravou uma imagem nova. Sem imagem válida, usa a lista compilada.
+ * @param conferirCrc false = confia no conteúdo (a web o conferiu antes de gravar o cabeçalho)
+ * e não relê os slots no controle.
+ */
+void abrirTabelaFlash(bool conferirCrc) {
+    if (particaoUsuarios == nullptr) {
+        particaoUsuarios = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, SUBTIPO_PARTICAO_USUARIOS, "usuarios");
+        if (particaoUsuarios == nullptr) {
+            Serial.println(F("Particao 'usuarios' ausente: usando lista compilada."));
+            return;
+        }
+    }
+
+    int melhor = -1;
+    CabecalhoTabela cabecalhos[2];
+    for (int slot = 0; slot < 2; slot++) {
+        if (!lerCabecalhoValido(slot, cabecalhos[slot], conferirCrc)) continue;
+        if (melhor < 0 || cabecalhos[slot].geracao > cabecalhos[melhor].geracao) melhor = slot;
+    }
+    if (melhor < 0 || melhor == slotTabelaEmUso.load()) return; // Nada novo para mapear
+
+    const void *ponteiro = nullptr;
+    spi_flash_mmap_handle_t mapa;
+    if (esp_partition_mmap(particaoUsuarios, melhor * TAMANHO_SLOT_TABELA, TAMANHO_SLOT_TABELA,
+                           SPI_FLASH_MMAP_DATA, &ponteiro, &mapa) != ESP_OK) {
+        Serial.println(F("Falha ao mapear a tabela de usuarios."));
+        return;
+    }
+    if (imagemUsuarios != nullptr) spi_flash_munmap(mapaUsuarios); // Troca: só o controle faz buscas
+    imagemUsuarios = (const uint8_t *)ponteiro;
+    mapaUsuarios = mapa;
+    cabecalhoAtivo = cabecalhos[melhor];
+    slotTabelaEmUso.store(melhor);
+
+    const RegistroUsuario *registros = (const RegistroUsuario *)(imagemUsuarios + sizeof(CabecalhoTabela) +
+                                                                 cabecalhoAtivo.capacidadeIndice * sizeof(uint16_t));
+    limparBloom();                              // Filtro acompanha a tabela nova
+    for (uint32_t i = 0; i < cabecalhoAtivo.quantidade; i++) adicionarBloom(registros[i].chave);
+    Serial.printf("Tabela de usuarios: slot %d, geracao %u, %u usuarios.\n", melhor,
+                  (unsigned)cabecalhoAtivo.geracao, (unsigned)cabecalhoAtivo.quantidade);
+}
+
+/**
+ * @brief Lê e valida o cabeçalho de um slot (mágico, limites e, se pedido, CRC do conteúdo).
+ */
+bool lerCabecalhoValido(int slot, CabecalhoTabela &cabecalho, bool conferirCrc) {
+    uint32_t base = slot * TAMANHO_SLOT_TABELA;
+    if (esp_partition_read(particaoUsuarios, base, &cabecalho, sizeof(cabecalho)) != ESP_OK) return false;
+    if (cabecalho.magico != MAGICO_TABELA_USUARIOS) return false;
+    uint32_t cap = cabecalho.capacidadeIndice;
+    if (cap < 2 || (cap & (cap - 1)) != 0 || cap > CAPACIDADE_INDICE_FLASH) return false;
+    if (cabecalho.quantidade >= cap || cabecalho.quantidade > CAPACIDADE_USUARIOS_FLASH) return false;
+    return !conferirCrc || crcConteudoTabela(base, cabecalho) == cabecalho.crc;
+}
+
+/**
+ * @brief Calcula o CRC32 do índice e dos registros de um slot.
+ */
+uint32_t crcConteudoTabela(uint32_t base, const CabecalhoTabela &cabecalho) {
+    uint32_t crc = 0;
+    if (!acumularCrcFlash(base + sizeof(CabecalhoTabela), tamanhoConteudoTabela(cabecalho), crc)) return ~cabecalho.crc;
+    return crc;
+}
+
+/**
+ * @brief Acumula em 'crc' o CRC32 de um trecho da partição de usuários, lendo a flash em blocos.
+ * @return false se a leitura falhou.
+ */
+bool acumularCrcFlash(uint32_t offset, uint32_t tamanho, uint32_t &crc) {
+    uint8_t bloco[256];
+    while (tamanho > 0) {
+        uint32_t n = tamanho < sizeof(bloco) ? tamanho : sizeof(bloco);
+        if (esp_partition_read(particaoUsuarios, offset, bloco, n) != ESP_OK) return false;
+        crc = esp_rom_crc32_le(crc, bloco, n);
+        offset += n;
+        tamanho -= n;
+    }
+    return true;
+}
+
+/**
+ * @brief Bytes de índice + registros descritos por um cabeçalho.
+ */
+uint32_t tamanhoConteudoTabela(const CabecalhoTabela &cabecalho) {
+    return cabecalho.capacidadeIndice * sizeof(uint16_t) + cabecalho.quantidade * sizeof(RegistroUsuario);
+}
+
+/**
+ * @brief Busca o UID direto na imagem mapeada em memória, sem copiar para a RAM.
+ * @return Registro do usuário (na flash), ou nullptr se não cadastrado.
+ */
+const RegistroUsuario *buscarUsuarioFlash(const ChaveUID &chave) {
+    const uint16_t *indice = (const uint16_t *)(imagemUsuarios + sizeof(CabecalhoTabela));
+    const RegistroUsuario *registros = (const RegistroUsuario *)(indice + cabecalhoAtivo.capacidadeIndice);
+    uint32_t mascara = cabecalhoAtivo.capacidadeIndice - 1;
+    uint32_t pos = hashChave(chave) & mascara;
+    for (uint32_t n = 0; n < cabecalhoAtivo.capacidadeIndice; n++) {
+        uint16_t i = indice[pos];
+        if (i == POSICAO_LIVRE_FLASH) return nullptr;
+        if (i < cabecalhoAtivo.quantidade && chavesIguais(chave, registros[i].chave)) return &registros[i];
+        pos = (pos + 1) & mascara;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Web: escolhe o slot inativo e prepara a gravação de uma nova imagem.
+ * @details Recusa se o controle ainda não trocou para a última imagem gravada. O destino é
+ * o slot que o controle não está usando; só os cabeçalhos são lidos (sem reler o conteúdo).
+ */
+bool iniciarGravacaoTabela() {
+    gravacao.ativa = false;
+    if (particaoUsuarios == nullptr) return false;
+    if (geracaoTabelaGravada.load() != geracaoTabelaVerificada.load(std::memory_order_acquire)) return false; // Troca pendente
+    CabecalhoTabela cab[2];
+    bool valido[2] = {lerCabecalhoValido(0, cab[0], false), lerCabecalhoValido(1, cab[1], false)};
+    int emUso = slotTabelaEmUso.load();
+    int destino = emUso >= 0 ? 1 - emUso : !valido[0] ? 0 : !valido[1] ? 1 : (cab[0].geracao <= cab[1].geracao ? 0 : 1);
+
+    uint32_t maiorGeracao = 0;
+    for (int slot = 0; slot < 2; slot++) {
+        if (valido[slot] && cab[slot].geracao > maiorGeracao) maiorGeracao = cab[slot].geracao;
+    }
+    memset(&gravacao, 0, sizeof(gravacao));
+    gravacao.base = destino * TAMANHO_SLOT_TABELA;
+    gravacao.geracao = maiorGeracao + 1;
+    gravacao.ativa = true;
+    return true;
+}
+
+/**
+ * @brief Web: garante que os setores até 'fim' (relativo ao slot) estejam apagados.
+ * @details Apaga um setor por vez, conforme a gravação avança, para espalhar as pausas
+ * de cache que a flash impõe aos dois núcleos.
+ */
+bool apagarSlotAte(uint32_t fim) {
+    while (gravacao.apagadoAte < fim) {
+        if (gravacao.apagadoAte >= TAMANHO_SLOT_TABELA) return false;
+        if (esp_partition_erase_range(particaoUsuarios, gravacao.base + gravacao.apagadoAte, TAMANHO_SETOR_FLASH) != ESP_OK) return false;
+        gravacao.apagadoAte += TAMANHO_SETOR_FLASH;
+    }
+    return true;
+}
+
+/**
+ * @brief Web: recebe um trecho de uma imagem binária pronta (upload em /usuarios/imagem).
+ * @details O cabeçalho fica na RAM e só é gravado em concluirGravacaoTabela(); o resto é
+ * gravado direto no slot inativo, na ordem em que chega.
+ */
+bool receberTrechoImagem(const uint8_t *dados, size_t tamanho) {
+    if (!gravacao.ativa) return false;
+    while (tamanho > 0 && gravacao.recebidos < sizeof(CabecalhoTabela)) { // Cabeçalho: só na RAM
+        ((uint8_t *)&gravacao.cabecalho)[gravacao.recebidos++] = *dados++;
+        tamanho--;
+    }
+    if (tamanho == 0) return true;
+    uint32_t fim = gravacao.recebidos + tamanho;
+    if (fim > TAMANHO_SLOT_TABELA || !apagarSlotAte(fim) ||
+        esp_partition_write(particaoUsuarios, gravacao.base + gravacao.recebidos, dados, tamanho) != ESP_OK) {
+        gravacao.ativa = false;
+        return false;
+    }
+    gravacao.recebidos = fim;
+    return true;
+}
+
+/**
+ * @brief Web: confere o cabeçalho e o tamanho da imagem recebida (o CRC vem depois, em passos).
+ */
+bool conferirImagemRecebida() {
+    CabecalhoTabela &cab = gravacao.cabecalho;
+    uint32_t cap = cab.capacidadeIndice;
+    if (!gravacao.ativa || cab.magico != MAGICO_TABELA_USUARIOS || cap < 2 || (cap & (cap - 1)) != 0 ||
+        cap > CAPACIDADE_INDICE_FLASH || cab.quantidade >= cap || cab.quantidade > CAPACIDADE_USUARIOS_FLASH ||
+        gravacao.recebidos != sizeof(CabecalhoTabela) + tamanhoConteudoTabela(cab)) {
+        gravacao.ativa = false;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Web: compara o CRC calculado com o do arquivo e grava o cabeçalho por último (ponto de troca).
+ * @details Enquanto o cabeçalho não é gravado, o slot novo é inválido e as buscas
+ * continuam na imagem anterior: nunca se vê uma tabela pela metade.
+ */
+bool concluirGravacaoTabela() {
+    bool valida = gravacao.ativa && gravacao.etapa == ETAPA_CRC_PRONTO && gravacao.crc == gravacao.cabecalho.crc;
+    gravacao.ativa = false;
+    gravacao.etapa = ETAPA_RECEBENDO;
+    return valida && gravarCabecalhoTabela();
+}
+
+/**
+ * @brief Web: começa o CRC do conteúdo gravado; avancarGravacaoTabela() o calcula em passos.
+ */
+void iniciarCrcTabela() {
+    gravacao.crc = 0;
+    gravacao.crcAte = 0;
+    gravacao.etapa = ETAPA_CALCULANDO_CRC;
+}
+
+/**
+ * @brief Web: um passo do trabalho longo da gravação (um setor apagado ou um bloco do CRC).
+ * @details Chamado a cada volta da tarefa de rede, para que apagar e conferir os ~144 KB do
+ * conteúdo não segurem as outras conexões. Enquanto há passos, a conexão do upload espera em
+ * CONEXAO_AGUARDANDO_TABELA; no fim ela recebe o corpo guardado (slot apagado, numa volta sem
+ * apagamento) ou é chamada de novo para responder (CRC pronto).
+ */
+void avancarGravacaoTabela() {
+    bool terminou;
+    if (gravacao.etapa == ETAPA_APAGANDO_SLOT) {
+        uint32_t fimConteudo = sizeof(CabecalhoTabela) +
+                               gravacao.cabecalho.capacidadeIndice * sizeof(uint16_t) +
+                               CAPACIDADE_USUARIOS_FLASH * sizeof(RegistroUsuario);
+        terminou = gravacao.apagadoAte >= fimConteudo;
+        if (!terminou && !apagarSlotAte(gravacao.apagadoAte + 1)) { // Um setor por passo
+            gravacao.ativa = false;
+            terminou = true;
+        }
+        if (terminou) gravacao.etapa = ETAPA_RECEBENDO;
+    } else if (gravacao.etapa == ETAPA_CALCULANDO_CRC) {
+        uint32_t restante = tamanhoConteudoTabela(gravacao.cabecalho) - gravacao.crcAte;
+        uint32_t n = restante < PASSO_CRC_TABELA ? restante : PASSO_CRC_TABELA;
+        if (!acumularCrcFlash(gravacao.base + sizeof(CabecalhoTabela) + gravacao.crcAte, n, gravacao.crc)) {
+            gravacao.ativa = false;
+        }
+        gravacao.crcAte += n;
+        terminou = !gravacao.ativa || gravacao.crcAte == tamanhoConteudoTabela(gravacao.cabecalho);
+        if (terminou) gravacao.etapa = ETAPA_CRC_PRONTO;
+    } else {
+        return;
+    }
+
+    Conexao *c = conexaoUpload;
+    if (c == nullptr || c->estado != CONEXAO_AGUARDANDO_TABELA) return;
+    c->ultimoMs = millis();                     // Progresso conta como atividade da conexão
+    if (!terminou) return;
+    if (gravacao.etapa == ETAPA_CRC_PRONTO) {
+        c->rota->atender(*c);
+        return;
+    }
+    c->estado = CONEXAO_LENDO_CORPO;            // Slot apagado: entrega o que chegou junto do cabeçalho
+    size_t guardados = c->usados;
+    c->usados = 0;
+    receberCorpoConexao(*c, (const uint8_t *)c->buffer, guardados);
+}
+
+/**
+ * @brief Web: grava o cabeçalho da imagem pronta e avisa o controle para trocar de slot.
+ * @details O aviso é a geração publicada num atômico que o controle consulta a cada volta,
+ * não um comando da fila: com a fila cheia o aviso se perderia e a imagem nova, já válida
+ * na flash, só seria mapeada no próximo boot.
+ */
+bool gravarCabecalhoTabela() {
+    CabecalhoTabela &cab = gravacao.cabecalho;
+    cab.geracao = gravacao.geracao;             // Geração é decidida aqui, não pelo arquivo
+    if (!apagarSlotAte(sizeof(CabecalhoTabela)) ||
+        esp_partition_write(particaoUsuarios, gravacao.base, &cab, sizeof(cab)) != ESP_OK) return false;
+
+    geracaoTabelaGravada.store(cab.geracao, std::memory_order_release); // Controle remapeia na próxima volta
+    return true;
+}
+
+/**
+ * @brief Web: prepara a construção incremental de uma imagem (importação de CSV).
+ * @details O índice tem capacidade máxima e, com a área dos registros, é apagado (0xFFFF =
+ * livre) por avancarGravacaoTabela(), um setor por passo, antes do corpo: as linhas só gravam.
+ * Os registros são gravados na ordem em que chegam, logo depois do índice.
+ */
+bool iniciarConstrucaoTabela() {
+    if (!iniciarGravacaoTabela()) return false;
+    gravacao.cabecalho.magico = MAGICO_TABELA_USUARIOS;
+    gravacao.cabecalho.capacidadeIndice = CAPACIDADE_INDICE_FLASH;
+    gravacao.cabecalho.quantidade = 0;
+    gravacao.etapa = ETAPA_APAGANDO_SLOT;
+    return true;
+}
+
+/**
+ * @brief Web: insere um usuário na imagem em construção (índice e registro direto na flash).
+ * @return RESULTADO_INSERIDO, RESULTADO_DUPLICADO, RESULTADO_CHEIA ou RESULTADO_FALHA (erro de
+ * flash ou índice ainda não apagado).
+ */
+ResultadoInsercao adicionarUsuarioTabela(const ChaveUID &chave, byte horario, const char *nome) {
+    CabecalhoTabela &cab = gravacao.cabecalho;
+    if (!gravacao.ativa || gravacao.etapa != ETAPA_RECEBENDO) return RESULTADO_FALHA;
+    if (cab.quantidade >= CAPACIDADE_USUARIOS_FLASH) return RESULTADO_CHEIA;
+    uint32_t inicioIndice = gravacao.base + sizeof(CabecalhoTabela);
+    uint32_t inicioRegistros = sizeof(CabecalhoTabela) + cab.capacidadeIndice * sizeof(uint16_t);
+    uint32_t mascara = cab.capacidadeIndice - 1;
+    uint32_t pos = hashChave(chave) & mascara;
+    for (;;) {                                  // Ocupação <= 50%: sempre há posição livre
+        uint16_t i;
+        ChaveUID existente;
+        if (esp_partition_read(particaoUsuarios, inicioIndice + pos * sizeof(uint16_t), &i, sizeof(i)) != ESP_OK ||
+            (i != POSICAO_LIVRE_FLASH &&
+             esp_partition_read(particaoUsuarios, gravacao.base + inicioRegistros + i * sizeof(RegistroUsuario),
+                                &existente, sizeof(existente)) != ESP_OK)) {
+            gravacao.ativa = false;
+            return RESULTADO_FALHA;
+        }
+        if (i == POSICAO_LIVRE_FLASH) break;
+        if (chavesIguais(chave, existente)) return RESULTADO_DUPLICADO;
+        pos = (pos + 1) & mascara;
+    }
+
+    RegistroUsuario registro;
+    memset(&registro, 0, sizeof(registro));
+    registro.chave = chave;
+    registro.horario = horario;
+    strncpy(registro.nome, nome, sizeof(registro.nome) - 1);
+    uint32_t offsetRegistro = inicioRegistros + cab.quantidade * sizeof(RegistroUsuario);
+    uint16_t posicao = cab.quantidade;
+    if (!apagarSlotAte(offsetRegistro + sizeof(registro)) ||
+        esp_partition_write(particaoUsuarios, gravacao.base + offsetRegistro, &registro, sizeof(registro)) != ESP_OK ||
+        esp_partition_write(particaoUsuarios, inicioIndice + pos * sizeof(uint16_t), &posicao, sizeof(posicao)) != ESP_OK) {
+        gravacao.ativa = false;
+        return RESULTADO_FALHA;
+    }
+    cab.quantidade++;
+    return RESULTADO_INSERIDO;
+}
+
+/**
+ * @brief Web: publica a imagem construída com o CRC calculado em passos (cabeçalho por último).
+ */
+bool concluirConstrucaoTabela() {
+    bool valida = gravacao.ativa && gravacao.etapa == ETAPA_CRC_PRONTO &&
+                  gravacao.cabecalho.quantidade > 0; // Tabela vazia trancaria todos
+    gravacao.ativa = false;
+    gravacao.etapa = ETAPA_RECEBENDO;
+    gravacao.cabecalho.crc = gravacao.crc;
+    return valida && gravarCabecalhoTabela();
+}
+
+/**
+ * @brief Web: consome um trecho do CSV (uid_hex,nome,horario) sem copiar o corpo.
+ * @details Cada byte avança uma máquina de estados; só os campos da linha atual ficam
+ * em buffers fixos. Uma linha inicial que não seja UID hexadecimal (cabeçalho) é ignorada.
+ */
+void consumirTrechoCsv(const uint8_t *dados, size_t tamanho) {
+    LeitorCSV &l = leitorCsv;
+    for (size_t k = 0; k < tamanho; k++) {
+        char c = (char)dados[k];
+        if (c == '\r') continue;
+        if (c == '\n') {
+            concluirLinhaCsv();
+            continue;
+        }
+        l.linhaVazia = false;
+        if (c == ',') {
+            if (l.campo < 2) l.campo++;
+            else l.linhaInvalida = true;        // Colunas demais
+            continue;
+        }
+        if (l.campo == 0) {                     // UID em hexadecimal, dois dígitos por byte
+            int nibble = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 :
+                         (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+            if (c == ' ' || c == ':') continue;
+            if (nibble < 0 || l.digitosUid >= 2 * TAMANHO_MAX_UID) {
+                l.linhaInvalida = true;
+                continue;
+            }
+            l.uid[l.digitosUid / 2] = (l.uid[l.digitosUid / 2] << 4) | nibble;
+            l.digitosUid++;
+        } else if (l.campo == 1) {              // Nome (truncado no tamanho do registro)
+            if (l.tamanhoNome < sizeof(l.nome) - 1) l.nome[l.tamanhoNome++] = c;
+        } else {                                // Horário (número)
+            if (c < '0' || c > '9') {
+                if (c != ' ') l.linhaInvalida = true;
+                continue;
+            }
+            if (l.horario >= MAX_HORARIOS) continue; // Já inválido: para de acumular (sem estouro)
+            l.horario = l.horario * 10 + (c - '0');
+            if (l.horario >= MAX_HORARIOS) l.linhaInvalida = true;
+        }
+    }
+}
+
+/**
+ * @brief Web: fecha a linha atual do CSV, inserindo o usuário se ela for válida.
+ */
+void concluirLinhaCsv() {
+    LeitorCSV &l = leitorCsv;
+    if (!l.linhaVazia) {
+        l.linhas++;
+        byte bytesUid = l.digitosUid / 2;
+        bool uidValido = (l.digitosUid % 2 == 0) && (bytesUid == 4 || bytesUid == 7 || bytesUid == 10);
+        if (l.linhaInvalida || !uidValido) {
+            if (l.linhas > 1) l.rejeitados++;  // A primeira linha pode ser o cabeçalho
+        } else {
+            l.nome[l.tamanhoNome] = '\0';
+            ResultadoInsercao r = adicionarUsuarioTabela(criarChaveUID(l.uid, bytesUid), (byte)l.horario, l.nome);
+            if (r == RESULTADO_INSERIDO) l.importados++;
+            else if (r == RESULTADO_DUPLICADO) l.duplicados++;
+            else if (r == RESULTADO_CHEIA) l.excedentes++;
+            else l.rejeitados++;
+        }
+    }
+    uint32_t linhas = l.linhas, importados = l.importados, rejeitados = l.rejeitados, duplicados = l.duplicados;
+    uint32_t excedentes = l.excedentes;
+    memset(&l, 0, sizeof(l));                   // Prepara a próxima linha, preservando os contadores
+    l.linhaVazia = true;
+    l.linhas = linhas;
+    l.importados = importados;
+    l.rejeitados = rejeitados;
+    l.duplicados = duplicados;
+    l.excedentes = excedentes;
+}
+
+/**
+ * @brief Web: início de /usuarios/importar (corpo = o CSV, sem multipart).
+ */
+bool iniciarUploadCsv(Conexao &c) {
+    if (!autorizarAdministrador(c) || !reservarUpload(c)) return false;
+    memset(&leitorCsv, 0, sizeof(leitorCsv));
+    leitorCsv.linhaVazia = true;
+    resultadoUpload = iniciarConstrucaoTabela() ? nullptr : "Troca de tabela pendente ou particao ausente.";
+    if (resultadoUpload == nullptr) {           // O corpo espera o índice ser apagado
+        c.estado = CONEXAO_AGUARDANDO_TABELA;
+        c.ultimoMs = millis();
+    }
+    return true;
+}
+
+/**
+ * @brief Web: um trecho do CSV recebido.
+ */
+void receberUploadCsv(const uint8_t *dados, size_t tamanho) {
+    if (resultadoUpload == nullptr) consumirTrechoCsv(dados, tamanho);
+}
+
+/**
+ * @brief Web: conclui a importação de CSV e responde com os contadores de linhas.
+ * @details Chamada no fim do corpo e de novo quando o CRC, calculado em passos, fica pronto.
+ * Uma linha que não coube (capacidade) ou não foi gravada (flash) cancela a importação
+ * inteira: o cabeçalho não é gravado e a tabela atual continua valendo.
+ */
+void responderUploadCsv(Conexao &c) {
+    int codigo = 400;
+    if (resultadoUpload == nullptr && gravacao.etapa != ETAPA_CRC_PRONTO) { // Fim do corpo
+        concluirLinhaCsv();                     // Última linha sem '\n'
+        if (leitorCsv.excedentes > 0) {
+            resultadoUpload = "Usuarios alem da capacidade da tabela: nada foi importado.";
+            codigo = 413;
+        } else if (!gravacao.ativa) {
+            resultadoUpload = "Falha na flash: nada foi importado.";
+            codigo = 500;
+        } else if (leitorCsv.importados == 0) {
+            resultadoUpload = "Nenhum usuario importado.";
+        } else {
+            iniciarCrcTabela();
+            c.estado = CONEXAO_AGUARDANDO_TABELA; // avancarGravacaoTabela() chama de novo no fim
+            c.ultimoMs = millis();
+            return;
+        }
+        gravacao.ativa = false;
+        gravacao.etapa = ETAPA_RECEBENDO;
+    }
+    if (resultadoUpload == nullptr) {
+        bool publicou = concluirConstrucaoTabela();
+        resultadoUpload = publicou ? "OK" : "Falha na flash: nada foi importado.";
+        codigo = publicou ? 200 : 500;
+    }
+    conexaoUpload = nullptr;
+    char resposta[192];
+    snprintf(resposta, sizeof(resposta),
+             "%s\nLinhas: %u, importados: %u, duplicados: %u, rejeitados: %u, excedentes: %u\n", resultadoUpload,
+             (unsigned)leitorCsv.linhas, (unsigned)leitorCsv.importados, (unsigned)leitorCsv.duplicados,
+             (unsigned)leitorCsv.rejeitados, (unsigned)leitorCsv.excedentes);
+    responderTexto(c, codigo, resposta);
+    resultadoUpload = nullptr;
+}
+
+/**
+ * @brief Web: início de /usuarios/imagem (corpo = a imagem binária, sem multipart).
+ */
+bool iniciarUploadImagem(Conexao &c) {
+    if (!autorizarAdministrador(c) || !reservarUpload(c)) return false;
+    resultadoUpload = iniciarGravacaoTabela() ? nullptr : "Troca de tabela pendente ou particao ausente.";
+    return true;
+}
+
+/**
+ * @brief Web: um trecho da imagem recebido.
+ */
+void receberUploadImagem(const uint8_t *dados, size_t tamanho) {
+    if (resultadoUpload == nullptr && !receberTrechoImagem(dados, tamanho)) {
+        resultadoUpload = "Falha ao gravar a imagem.";
+    }
+}
+
+/**
+ * @brief Web: conclui a gravação da tabela e responde.
+ * @details Chamada no fim do corpo e de novo quando o CRC, calculado em passos, fica pronto.
+ */
+void responderUploadImagem(Conexao &c) {
+    if (resultadoUpload == nullptr && gravacao.etapa != ETAPA_CRC_PRONTO) { // Fim do corpo
+        if (conferirImagemRecebida()) {
+            iniciarCrcTabela();
+            c.estado = CONEXAO_AGUARDANDO_TABELA; // avancarGravacaoTabela() chama de novo no fim
+            c.ultimoMs = millis();
+            return;
+        }
+        resultadoUpload = "Imagem invalida (cabecalho ou tamanho).";
+    }
+    if (resultadoUpload == nullptr) {
+        resultadoUpload = concluirGravacaoTabela() ? "OK" : "Imagem invalida (CRC) ou falha na flash.";
+    }
+    conexaoUpload = nullptr;
+    bool ok = strcmp(resultadoUpload, "OK") == 0;
+    responderTexto(c, ok ? 200 : 400, resultadoUpload);
+    resultadoUpload = nullptr;
+}
+
+// ==============================================================================
+// REGISTRO DE EVENTOS DE ACESSO (RTC + FLASH)
+// ==============================================================================
+
+/**
+ * @brief Valida o anel na RTC, conta o boot e encontra a posição de escrita no log da flash.
+ * @details Depois de um reset por software o anel e seus índices são mantidos; após
+ * ligar a placa o conteúdo da RTC é lixo e o anel é zerado. Na flash, a posição de
+ * escrita é a primeira página apagada que vem depois de uma página gravada. O contador
+ * de boots segue na RTC e, ao ligar, continua do último evento gravado na flash. Parado
+ * no início de um setor, o setor em uso é o anterior: o da posição de escrita ainda será
+ * apagado pela tarefa de rede.
+ */
+void iniciarLogEventos() {
+    bool anelValido = anelEventos.magico == MAGICO_ANEL_EVENTOS &&
+                      anelEventos.escrita.load() - anelEventos.lida.load() <= CAPACIDADE_ANEL_EVENTOS;
+    if (anelValido) {
+        anelEventos.boots++;
+    } else {
+        anelEventos.escrita.store(0);
+        anelEventos.lida.store(0);
+        anelEventos.boots = 0;
+        anelEventos.magico = MAGICO_ANEL_EVENTOS;
+    }
+
+    particaoEventos = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, SUBTIPO_PARTICAO_EVENTOS, "eventos");
+    if (particaoEventos == nullptr) {
+        Serial.println(F("Particao 'eventos' ausente: eventos ficam so na RTC."));
+        return;
+    }
+    uint32_t paginas = particaoEventos->size / TAMANHO_PAGINA_FLASH;
+    bool anteriorGravada = paginaGravada(paginas - 1);
+    offsetLogEventos = 0;
+    for (uint32_t p = 0; p < paginas; p++) {
+        bool gravada = paginaGravada(p);
+        if (!gravada && anteriorGravada) {
+            offsetLogEventos = p * TAMANHO_PAGINA_FLASH;
+            break;
+        }
+        anteriorGravada = gravada;
+    }
+
+    uint32_t ultimaPagina = (offsetLogEventos + particaoEventos->size - TAMANHO_PAGINA_FLASH) % particaoEventos->size;
+    EventoAcesso ultimo;
+    if (!anelValido && paginaGravada(ultimaPagina / TAMANHO_PAGINA_FLASH) &&
+        esp_partition_read(particaoEventos, ultimaPagina + TAMANHO_PAGINA_FLASH - sizeof(ultimo), &ultimo,
+                           sizeof(ultimo)) == ESP_OK) {
+        anelEventos.boots = ultimo.boot + 1;
+    }
+    uint32_t setor = offsetLogEventos - offsetLogEventos % TAMANHO_SETOR_FLASH;
+    if (setor == offsetLogEventos) setor = (setor + particaoEventos->size - TAMANHO_SETOR_FLASH) % particaoEventos->size;
+    setorEventosApagado.store(SETOR_EVENTOS_NENHUM, std::memory_order_relaxed);
+    setorEventosEmUso.store(setor, std::memory_order_release);
+}
+
+/**
+ * @brief Indica se a página do log na flash já recebeu eventos (primeira palavra != 0xFFFFFFFF).
+ */
+bool paginaGravada(uint32_t pagina) {
+    uint32_t palavra = 0xFFFFFFFF;
+    esp_partition_read(particaoEventos, pagina * TAMANHO_PAGINA_FLASH, &palavra, sizeof(palavra));
+    return palavra != 0xFFFFFFFF;
+}
+
+/**
+ * @brief Acrescenta um evento ao anel na RTC (produtor único: o controle).
+ * @details Custa uma leitura do relógio, uma cópia de 16 bytes e um store; se o anel
+ * estiver cheio o evento é descartado e contado, sem bloquear. Antes do SNTP, o instante
+ * é o millis() e o par (boot, instante) ainda ordena os eventos.
+ */
+void registrarEvento(TipoEvento tipo, const ChaveUID &chave) {
+    eventosPorTipo[tipo]++;
+    uint32_t escrita = anelEventos.escrita.load(std::memory_order_relaxed);
+    if (escrita - anelEventos.lida.load(std::memory_order_acquire) >= CAPACIDADE_ANEL_EVENTOS) {
+        eventosDescartados++;
+        return;
+    }
+    EventoAcesso &e = anelEventos.eventos[escrita % CAPACIDADE_ANEL_EVENTOS];
+    time_t agora = time(nullptr);
+    e.sincronizado = agora >= EPOCH_MINIMO_SNTP;
+    e.instante = e.sincronizado ? (uint32_t)agora : millis();
+    e.boot = anelEventos.boots;                 // Campo de 4 bits: guarda o boot mod 16
+    e.tipo = tipo;
+    e.tamanhoUid = chave.uid.tamanho;
+    memcpy(e.uid, chave.uid.bytes, TAMANHO_MAX_UID);
+    anelEventos.escrita.store(escrita + 1, std::memory_order_release);
+}
+
+/**
+ * @brief Grava na flash uma página (16 eventos) pendente do anel; havendo mais, volta logo.
+ * @details Só grava páginas completas: cada página é programada uma única vez e cada setor
+ * só é apagado quando o log dá a volta, o que limita o desgaste. O apagamento (dezenas de
+ * ms) não acontece aqui: ao entrar num setor o controle espera a tarefa de rede tê-lo
+ * apagado, e enquanto isso os eventos continuam na RTC, onde sobrevivem a resets por software.
+ */
+void descarregarEventos() {
+    if (particaoEventos == nullptr) return;
+    uint32_t lida = anelEventos.lida.load(std::memory_order_relaxed);
+    if (anelEventos.escrita.load(std::memory_order_acquire) - lida < EVENTOS_POR_PAGINA) return;
+    if (offsetLogEventos % TAMANHO_SETOR_FLASH == 0) { // Entrando num setor: só depois de a web apagá-lo
+        if (setorEventosApagado.load(std::memory_order_acquire) != offsetLogEventos) return;
+        setorEventosEmUso.store(offsetLogEventos, std::memory_order_release); // A web passa ao seguinte
+    }
+    EventoAcesso pagina[EVENTOS_POR_PAGINA];
+    for (uint32_t i = 0; i < EVENTOS_POR_PAGINA; i++) {
+        pagina[i] = anelEventos.eventos[(lida + i) % CAPACIDADE_ANEL_EVENTOS];
+    }
+    if (esp_partition_write(particaoEventos, offsetLogEventos, pagina, sizeof(pagina)) != ESP_OK) return;
+    offsetLogEventos = (offsetLogEventos + TAMANHO_PAGINA_FLASH) % particaoEventos->size;
+    lida += EVENTOS_POR_PAGINA;
+    anelEventos.lida.store(lida, std::memory_order_release);
+    paginasEventosGravadas++;
+    if (anelEventos.escrita.load(std::memory_order_acquire) - lida >= EVENTOS_POR_PAGINA) {
+        reagendarTarefa(tarefaEventos, 0);      // Outra página na próxima volta, não nesta
+    }
+}
+
+/**
+ * @brief Web: apaga o setor do log que vem depois do que o controle está usando.
+ * @details Ele guarda os eventos mais antigos, que assim somem um setor antes de o log dar a
+ * volta. Um apagamento por chamada, e só quando o controle passou a usar o setor anterior.
+ */
+void apagarProximoSetorEventos() {
+    if (particaoEventos == nullptr) return;
+    uint32_t emUso = setorEventosEmUso.load(std::memory_order_acquire);
+    uint32_t proximo = (emUso + TAMANHO_SETOR_FLASH) % particaoEventos->size;
+    if (setorEventosApagado.load(std::memory_order_relaxed) == proximo) return;
+    if (esp_partition_erase_range(particaoEventos, proximo, TAMANHO_SETOR_FLASH) != ESP_OK) return;
+    setorEventosApagado.store(proximo, std::memory_order_release); // O controle pode entrar nele
+}
+
+// ==============================================================================
+// ULTRASSÔNICO POR INTERRUPÇÃO
+// ==============================================================================
+
+/**
+ * @brief Configura o HC-SR04: TRIG disparado por timer periódico, ECHO medido por interrupção.
+ */
+void iniciarUltrassom() {
+    pinMode(PINO_TRIG, OUTPUT);
+    digitalWrite(PINO_TRIG, LOW);
+    pinMode(PINO_ECHO, INPUT);
+    attachInterrupt(digitalPinToInterrupt(PINO_ECHO), isrEcho, CHANGE);
+
+    esp_timer_create_args_t args = {};
+    args.callback = dispararUltrassom;
+    args.name = "ultrassom";
+    esp_timer_create(&args, &timerUltrassom);
+    esp_timer_start_periodic(timerUltrassom, periodoUltrassomUs);
+}
+
+/**
+ * @brief Callback do timer: fecha a medição anterior e gera o pulso de 10us no TRIG.
+ * @details Se o eco anterior não terminou até aqui, nada refletiu: publica 0 (sem presença).
+ */
+void dispararUltrassom(void *arg) {
+    if (medicaoPendente.exchange(false, std::memory_order_acq_rel)) { // Sem eco dentro do ciclo
+        publicarDistancia(0);
+        ultrassomSemEco++;
+    }
+    inicioEchoUs.store(0, std::memory_order_relaxed);
+    disparoUltrassomUs.store((uint32_t)esp_timer_get_time(), std::memory_order_relaxed);
+    medicaoPendente.store(true, std::memory_order_release); // A ISR vê o disparo acima
+    digitalWrite(PINO_TRIG, HIGH);
+    delayMicroseconds(10);
+    digitalWrite(PINO_TRIG, LOW);
+}
+
+/**
+ * @brief Interrupção do ECHO: marca a subida e, na descida, converte a largura em distância.
+ * @details Na descida também conta a latência disparo -> fim do eco no histograma de /metrics.
+ */
+void IRAM_ATTR isrEcho() {
+    uint32_t agora = (uint32_t)esp_timer_get_time();
+    if (digitalRead(PINO_ECHO) == HIGH) {
+        inicioEchoUs.store(agora, std::memory_order_relaxed);
+        return;
+    }
+    uint32_t inicio = inicioEchoUs.load(std::memory_order_relaxed);
+    if (inicio != 0 && medicaoPendente.exchange(false, std::memory_order_acq_rel)) { // O timer não fechou o ciclo
+        publicarDistancia((agora - inicio) / US_POR_CM);
+        uint32_t latencia = agora - disparoUltrassomUs.load(std::memory_order_relaxed);
+        int faixa = 0;
+        while (faixa < FAIXAS_LATENCIA - 1 && latencia > LIMITES_LATENCIA_US[faixa]) faixa++;
+        latenciaUltrassom[faixa]++;
+        somaLatenciaUltrassomUs += latencia;
+    }
+}
+
+/**
+ * @brief Publica a distância no slot atômico, com um número de sequência nos 16 bits altos.
+ */
+void IRAM_ATTR publicarDistancia(uint32_t distanciaCm) {
+    if (distanciaCm > 0xFFFF) distanciaCm = 0xFFFF;
+    uint32_t anterior = amostraUltrassom.load(std::memory_order_relaxed);
+    uint32_t nova;
+    do {                                        // Timer (núcleo 0) e ISR (núcleo 1) publicam
+        nova = ((((anterior >> 16) + 1) & 0xFFFF) << 16) | distanciaCm;
+    } while (!amostraUltrassom.compare_exchange_weak(anterior, nova, std::memory_order_release,
+                                                     std::memory_order_relaxed));
+}
+
+// ==============================================================================
+// DHT11 EM SEGUNDO PLANO
+// ==============================================================================
+
+/**
+ * @brief Configura o DHT11 para leitura por timer e interrupção, sem travar o loop.
+ * @details A linha fica em dreno aberto: LOW puxa o barramento, HIGH solta para o pull-up.
+ * A interrupção é anexada aqui (núcleo 1) e só grava bordas durante a captura.
+ */
+void iniciarDht() {
+    pinMode(PINO_DHT, OUTPUT_OPEN_DRAIN);
+    digitalWrite(PINO_DHT, HIGH);               // Barramento solto
+    attachInterrupt(digitalPinToInterrupt(PINO_DHT), isrDht, FALLING);
+
+    esp_timer_create_args_t args = {};
+    args.callback = etapaLeituraDht;
+    args.name = "dht";
+    esp_timer_create(&args, &timerDht);
+    esp_timer_start_once(timerDht, atrasoMinimoDhtMs * 1000UL); // Sensor precisa de ~1s após ligar
+}
+
+/**
+ * @brief Callback do timer: pulso de início -> captura -> decodificação -> próxima leitura.
+ * @details Em caso de falha, tenta de novo com recuo exponencial (1s, 2s, 4s...) limitado
+ * a 'intervaloLeituraTemp', em vez do antigo delay(1000) no loop.
+ */
+void etapaLeituraDht(void *arg) {
+    switch (etapaDht) {
+    case DHT_OCIOSO:                            // Pede uma leitura: LOW por 20ms
+        digitalWrite(PINO_DHT, LOW);
+        etapaDht = DHT_PULSO_INICIO;
+        esp_timer_start_once(timerDht, duracaoPulsoDhtUs);
+        break;
+
+    case DHT_PULSO_INICIO:                      // Solta a linha e grava as bordas da resposta
+        totalBordasDht.store(0, std::memory_order_relaxed);
+        capturandoDht.store(true, std::memory_order_release);
+        digitalWrite(PINO_DHT, HIGH);
+        etapaDht = DHT_CAPTURANDO;
+        esp_timer_start_once(timerDht, janelaCapturaDhtUs);
+        break;
+
+    case DHT_CAPTURANDO: {                      // Quadro completo (ou timeout): decodifica
+        capturandoDht.store(false, std::memory_order_relaxed);
+        AmostraDHT amostra;
+        amostra.instanteMs = millis();
+        amostra.valida = decodificarDht(amostra.umidade, amostra.temperatura);
+        publicarAmostraDht(amostra);
+
+        unsigned long proximaMs = intervaloLeituraTemp;
+        if (amostra.valida) {
+            falhasSeguidasDht = 0;
+        } else {
+            falhasDht++;
+            proximaMs = atrasoMinimoDhtMs << (falhasSeguidasDht < 3 ? falhasSeguidasDht : 3);
+            if (proximaMs > (unsigned long)intervaloLeituraTemp) proximaMs = intervaloLeituraTemp;
+            falhasSeguidasDht++;
+        }
+        etapaDht = DHT_OCIOSO;
+        esp_timer_start_once(timerDht, proximaMs * 1000UL);
+        break;
+    }
+    }
+}
+
+/**
+ * @brief Interrupção de descida do DHT11: grava o instante de cada borda.
+ */
+void IRAM_ATTR isrDht() {
+    if (!capturandoDht.load(std::memory_order_acquire)) return;
+    int total = totalBordasDht.load(std::memory_order_relaxed);
+    if (total >= MAX_BORDAS_DHT) return;
+    bordasDhtUs[total] = esp_timer_get_time();
+    totalBordasDht.store(total + 1, std::memory_order_release); // Publica a borda para decodificarDht()
+}
+
+/**
+ * @brief Decodifica as bordas capturadas no quadro de 40 bits do DHT11.
+ * @details Cada bit começa numa descida; o intervalo até a descida seguinte é ~78us
+ * para 0 e ~120us para 1. As 41 últimas descidas delimitam os 40 bits.
+ * @return true se o quadro estiver completo e o checksum conferir.
+ */
+bool decodificarDht(float &umidade, float &temperatura) {
+    int total = totalBordasDht.load(std::memory_order_acquire);
+    if (total < 42) return false;               // Resposta + 40 bits não chegaram
+    int primeira = total - 41;
+
+    byte dados[5] = {0, 0, 0, 0, 0};
+    for (int i = 0; i < 40; i++) {
+        int64_t intervalo = bordasDhtUs[primeira + i + 1] - bordasDhtUs[primeira + i];
+        dados[i / 8] <<= 1;
+        if (intervalo > (int64_t)limiarBitDhtUs) dados[i / 8] |= 1;
+    }
+    if ((byte)(dados[0] + dados[1] + dados[2] + dados[3]) != dados[4]) return false; // Checksum
+
+    umidade = dados[0] + dados[1] * 0.1f;
+    temperatura = dados[2];
+    if (dados[3] & 0x80) temperatura = -1 - temperatura; // Bit de sinal do DHT11
+    temperatura += (dados[3] & 0x0F) * 0.1f;
+    return true;
+}
+
+/**
+ * @brief Publica uma amostra (escritor único: o timer do DHT11).
+ * @details A amostra é copiada em palavras atômicas: o leitor do seqlock pode copiar durante
+ * a escrita, e só a versão decide se a cópia vale. Cada palavra é gravada com release (fica
+ * depois da versão ímpar) e lida com acquire (fica antes da releitura da versão), sem fences,
+ * que o ThreadSanitizer não entende.
+ */
+void publicarAmostraDht(const AmostraDHT &amostra) {
+    uint32_t versao = versaoDht.load(std::memory_order_relaxed);
+    versaoDht.store(versao + 1, std::memory_order_relaxed); // Ímpar: escrita em andamento
+    uint32_t palavras[PALAVRAS_AMOSTRA_DHT] = {};
+    memcpy(palavras, &amostra, sizeof(amostra));
+    for (int i = 0; i < PALAVRAS_AMOSTRA_DHT; i++) amostraDht[i].store(palavras[i], std::memory_order_release);
+    versaoDht.store(versao + 2, std::memory_order_release);
+}
+
+/**
+ * @brief Copia a amostra mais recente sem travar o escritor.
+ * @param versao Recebe a versão lida (0 = nenhuma amostra ainda).
+ * @return false se o escritor estava no meio de uma publicação (tente de novo depois).
+ */
+bool lerAmostraDht(AmostraDHT &amostra, uint32_t &versao) {
+    uint32_t antes = versaoDht.load(std::memory_order_acquire);
+    if (antes & 1) return false;
+    uint32_t palavras[PALAVRAS_AMOSTRA_DHT];
+    for (int i = 0; i < PALAVRAS_AMOSTRA_DHT; i++) palavras[i] = amostraDht[i].load(std::memory_order_acquire);
+    memcpy(&amostra, palavras, sizeof(amostra));
+    if (versaoDht.load(std::memory_order_relaxed) != antes) return false;
+    versao = antes;
+    return true;
+}
+
+/**
+ * @brief Mostra no LCD a última amostra do DHT11 e atualiza a temperatura.
+ * @details Executada pelo escalonador; só faz algo quando há amostra nova. Quando a
+ * temperatura muda, sinaliza a tarefa da ventoinha automática.
+ */
+void atualizarDisplayTempUmi() {
+    if (feedbackEmAndamento()) return;          // Não sobrescreve o feedback de acesso no LCD
+    AmostraDHT amostra;
+    uint32_t versao;
+    if (!lerAmostraDht(amostra, versao) || versao == versaoDhtExibida) return; // Nada novo
+    versaoDhtExibida = versao;
+    float umidade = amostra.umidade;
+    float temp = amostra.temperatura;
+    if (!amostra.valida) {                      // Se leitura inválida
+        Serial.println(F("Falha ao ler dados do sensor DHT!"));
+        escreverLcd(0, "ERRO SENSOR");
+        escreverLcd(1, "");
+        return;
+    }
+    if ((int)temp != temperaturaAtual) sinalizarTarefa(tarefaVentoinha); // Reavalia a ventoinha
+    if ((int)temp != temperaturaAtual || (int)(umidade + 0.5f) != umidadeAtual) versaoEstado++;
+    temperaturaAtual = (int)temp;               // Atualiza variável global de temperatura
+    umidadeAtual = (int)(umidade + 0.5f);       // Umidade publicada para a web
+    char linha[LCD_COLUNAS + 1];
+    snprintf(linha, sizeof(linha), "Umi: %.1f%%", umidade); // Mostra umidade
+    escreverLcd(0, linha);
+    snprintf(linha, sizeof(linha), "Temp: %d%cC", temperaturaAtual, (char)223); // Mostra temp
+    escreverLcd(1, linha);
+}
+
+/**
+ * @brief Troca o texto de uma linha do quadro do LCD (completa com espaços).
+ */
+void escreverLcd(int linha, const char *texto) {
+    size_t tamanho = strnlen(texto, LCD_COLUNAS);
+    memcpy(telaLcd[linha], texto, tamanho);
+    memset(telaLcd[linha] + tamanho, ' ', LCD_COLUNAS - tamanho);
+}
+
+/**
+ * @brief Leva ao display um byte do que mudou no quadro: um caractere ou um posicionamento.
+ * @details A busca começa no cursor, então um trecho alterado sai em sequência, sem novo
+ * setCursor(). Uma linha inteira leva ~17 voltas; a volta nunca passa de ~1,3 ms de I2C.
+ */
+void atualizarLcd() {
+    const int celulas = LCD_LINHAS * LCD_COLUNAS;
+    int inicio = cursorLcd >= 0 ? cursorLcd : 0;
+    for (int i = 0; i < celulas; i++) {
+        int celula = (inicio + i) % celulas;
+        int linha = celula / LCD_COLUNAS, coluna = celula % LCD_COLUNAS;
+        if (telaLcd[linha][coluna] == telaExibida[linha][coluna]) continue;
+        if (celula != cursorLcd) {              // Posiciona agora; o caractere sai na próxima volta
+            lcd.setCursor(coluna, linha);
+            cursorLcd = celula;
+            return;
+        }
+        lcd.write((uint8_t)telaLcd[linha][coluna]);
+        telaExibida[linha][coluna] = telaLcd[linha][coluna];
+        cursorLcd = coluna + 1 < LCD_COLUNAS ? celula + 1 : -1; // O HD44780 não passa sozinho para a outra linha
+        return;
+    }
+}
+
+/**
+ * @brief Controla a ventoinha automática com base na temperatura.
+ */
+void controleAutomaticoVentoinha() {
+    if (temperaturaAtual >= tempacionamento && !ventilacaoAutomaticaState) { // Se temp alta e ventoinha desligada
+        acionarSaida(PINO_VENTOINHA_AUTO, saidaVentilacaoAuto, true); // Liga ventoinha automática
+        ventilacaoAutomaticaState = true;       // Atualiza estado
+        mensagemSistema = "Ventoinha LIGADA automaticamente por temperatura alta.";
+        versaoEstado++;
+        Serial.println("Ventoinha AUTOMÁTICA LIGADA.");
+    } else if (temperaturaAtual < tempdesligamento && ventilacaoAutomaticaState) { // Se temp baixa e ventoinha ligada
+        acionarSaida(PINO_VENTOINHA_AUTO, saidaVentilacaoAuto, false); // Desliga ventoinha automática
+        ventilacaoAutomaticaState = false;      // Atualiza estado
+        mensagemSistema = "Ventoinha DESLIGADA automaticamente.";
+        versaoEstado++;
+        Serial.println("Ventoinha AUTOMÁTICA DESLIGADA.");
+    }
+}
+
+// ==============================================================================
+// FUNÇÕES DE CONTROLE (COMANDOS VINDOS DO SERVIDOR WEB, EXECUTADOS NO NÚCLEO 1)
+// ==============================================================================
+
+/**
+ * @brief Controla a iluminação, gerenciando a flag de controle manual.
+ * @param ligar Booleano que define se a ação é para ligar (true) ou desligar (false).
+ */
+void controleLuz(bool ligar) {
+    versaoEstado++;                             // Sempre muda o estado ou a mensagem
+    if (ligar) {                                // Se for para ligar
+        if (ocupacao) {                         // Só liga se sala ocupada
+            acionarSaida(PINO_LUZ, saidaLuz, true); // Liga luz
+            iluminacaoState = true;             // Atualiza estado
+            luzDesligadaManualmente = false;    // NOVO: Reseta a flag ao ligar manualmente.
+            mensagemSistema = "Luz ligada com sucesso.";
+        } else {
+            mensagemSistema = "⚠️ N&atilde;o &eacute; poss&iacute;vel ligar a luz: sala est&aacute; vazia.";
+        }
+    } else {                                    // Se for para desligar
+        acionarSaida(PINO_LUZ, saidaLuz, false); // Desliga luz
+        iluminacaoState = false;                // Atualiza estado
+        if (ocupacao) {                         // NOVO: Se desligou com a sala ocupada...
+            luzDesligadaManualmente = true;     // ...ativa a flag para bloquear o acendimento automático.
+        }
+        mensagemSistema = "Luz desligada.";
+    }
+}
+
+
+/**
+ * @brief Controla a ventilação manual, verificando a ocupação da sala.
+ * @param ligar Booleano que define se a ação é para ligar (true) ou desligar (false).
+ */
+void controleVentilacao(bool ligar) {
+    versaoEstado++;                             // Sempre muda o estado ou a mensagem
+    if (ligar) {                                // Se for para ligar
+        if (ocupacao) {                         // Só liga se sala ocupada
+            acionarSaida(PINO_VENTOINHA_MANUAL, saidaVentilacao, true); // Liga ventoinha manual
+            ventilacaoState = true;             // Atualiza estado
+            mensagemSistema = "Ventilacao manual ligada com sucesso.";
+        } else {
+            mensagemSistema = "⚠️ N&atilde;o &eacute; poss&iacute;vel ligar a ventoinha: sala est&aacute; vazia.";
+        }
+    } else {                                    // Se for para desligar
+        acionarSaida(PINO_VENTOINHA_MANUAL, saidaVentilacao, false); // Desliga ventoinha manual
+        ventilacaoState = false;                // Atualiza estado
+        mensagemSistema = "Ventilacao manual desligada.";
+    }
+}
+
+/**
+ * @brief Aciona uma saída e contabiliza trocas de estado e tempo ligada.
+ * @details O tempo fica em segundos inteiros mais um resto em ms, para caber em 32 bits
+ * (leitura sem rasgar no outro núcleo) sem perder as frações entre acionamentos.
+ */
+void acionarSaida(byte pino, ContadorSaida &saida, bool ligar) {
+    digitalWrite(pino, ligar ? HIGH : LOW);
+    if (saida.ligada == ligar) return;
+    unsigned long agora = millis();
+    if (ligar) {
+        saida.ligadaDesdeMs = agora;
+    } else {
+        saida.restoMs += agora - saida.ligadaDesdeMs;
+        saida.ligadaSegundos += saida.restoMs / 1000;
+        saida.restoMs %= 1000;
+    }
+    saida.acionamentos++;
+    saida.ligada = ligar;
+}
+
+// ==============================================================================
+// SERVIDOR HTTP NÃO BLOQUEANTE
+// ==============================================================================
+
+// Rotas: método (nullptr = qualquer), caminho, resposta e, para uploads, início e trechos do corpo
+const Rota rotas[] = {
+    {nullptr, "/", handleDashboard},                 // Painel (estático, atualizado por /api/events)
+    {nullptr, "/classico", handleRoot},              // Página HTML completa, para navegadores sem JavaScript
+    {"GET", "/api/state", handleEstadoApi},          // Estado da sala em JSON
+    {"GET", "/api/events", handleEventos},           // Mudanças de estado por Server-Sent Events
+    {"GET", "/metrics", handleMetricas},             // Contadores para o Prometheus
+    {nullptr, "/luz/on", [](Conexao &c) { enviarComando(c, CMD_LUZ, true); }},               // Ligar luz
+    {nullptr, "/luz/off", [](Conexao &c) { enviarComando(c, CMD_LUZ, false); }},             // Desligar luz
+    {nullptr, "/ventilacao/on", [](Conexao &c) { enviarComando(c, CMD_VENTILACAO, true); }},   // Ligar ventoinha manual
+    {nullptr, "/ventilacao/off", [](Conexao &c) { enviarComando(c, CMD_VENTILACAO, false); }}, // Desligar ventoinha manual
+    {"POST", "/api/commands", handleComandos, nullptr, nullptr, 128}, // Lote de comandos, resposta JSON
+    {"POST", "/usuarios/imagem", responderUploadImagem, iniciarUploadImagem, receberUploadImagem}, // Nova tabela (A/B, token)
+    {"POST", "/usuarios/importar", responderUploadCsv, iniciarUploadCsv, receberUploadCsv},       // CSV: uid_hex,nome,horario (token)
+};
+const Rota rotaPadrao = {nullptr, nullptr, handleDashboard}; // Qualquer outra rota: painel
+
+/**
+ * @brief Abre o socket de escuta em 'portaHttp', em modo não bloqueante, e esvazia o pool.
+ */
+bool iniciarServidorHttp() {
+    for (Conexao &c : conexoes) {
+        c.soquete = -1;
+        c.estado = CONEXAO_LIVRE;
+    }
+    soqueteServidor = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (soqueteServidor < 0) return false;
+    int sim = 1;
+    setsockopt(soqueteServidor, SOL_SOCKET, SO_REUSEADDR, &sim, sizeof(sim));
+    sockaddr_in endereco = {};
+    endereco.sin_family = AF_INET;
+    endereco.sin_port = htons(portaHttp);
+    endereco.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(soqueteServidor, (sockaddr *)&endereco, sizeof(endereco)) < 0 || listen(soqueteServidor, MAX_CONEXOES) < 0) {
+        close(soqueteServidor);
+        soqueteServidor = -1;
+        return false;
+    }
+    fcntl(soqueteServidor, F_SETFL, O_NONBLOCK);
+    return true;
+}
+
+/**
+ * @brief Uma volta do servidor: espera atividade em qualquer socket e atende todas as conexões.
+ * @details Nenhuma chamada bloqueia: um cliente lento só ocupa a própria vaga até o tempo
+ * limite, e os demais continuam sendo atendidos. Com o pool cheio, o socket de escuta sai
+ * do select() e as conexões novas aguardam no backlog do TCP até uma vaga abrir. O select() também é o ponto em que a
+ * tarefa de rede cede o núcleo quando não há nada a fazer.
+ * @param esperaMaxMs Tempo máximo parado no select() (mantém receberEstados() em dia).
+ */
+void servirHttp(unsigned long esperaMaxMs) {
+    if (soqueteServidor < 0) {
+        vTaskDelay(pdMS_TO_TICKS(esperaMaxMs));
+        return;
+    }
+    fd_set leitura, escrita;
+    FD_ZERO(&leitura);
+    FD_ZERO(&escrita);
+    int maior = soqueteServidor;
+    bool vagaLivre = false;
+    for (Conexao &c : conexoes) {
+        if (c.estado == CONEXAO_LIVRE) {
+            vagaLivre = true;
+            continue;
+        }
+        if (c.estado == CONEXAO_AGUARDANDO_TABELA) continue; // O corpo fica no socket até a flash ficar pronta
+        bool pendente = c.estado == CONEXAO_EVENTOS && c.enviados < c.usados; // Fora do SSE, 'buffer' pode ser a requisição
+        if (c.estado == CONEXAO_ENVIANDO || pendente) FD_SET(c.soquete, &escrita);
+        if (c.estado != CONEXAO_ENVIANDO) FD_SET(c.soquete, &leitura); // SSE: detecta o fechamento
+        if (c.soquete > maior) maior = c.soquete;
+    }
+    if (vagaLivre) FD_SET(soqueteServidor, &leitura); // Pool cheio: novas conexões esperam no backlog
+    timeval espera = {0, (long)(esperaMaxMs * 1000)};
+    if (select(maior + 1, &leitura, &escrita, nullptr, &espera) < 0) return;
+
+    uint32_t inicioUs = micros();
+    if (FD_ISSET(soqueteServidor, &leitura)) aceitarConexoes();
+    for (Conexao &c : conexoes) {
+        if (c.estado == CONEXAO_LIVRE) continue;
+        if (FD_ISSET(c.soquete, &leitura)) lerConexao(c);
+        if (c.estado != CONEXAO_LIVRE && FD_ISSET(c.soquete, &escrita)) enviarPendente(c);
+        long paradoMs = (long)(millis() - c.ultimoMs); // Relido aqui: o handler pode ter acabado de atualizar ultimoMs
+        if (c.estado != CONEXAO_LIVRE && c.estado != CONEXAO_EVENTOS && paradoMs > (long)tempoLimiteConexaoMs) {
+            conexoesExpiradas++;
+            if (c.estado == CONEXAO_AGUARDANDO_CONTROLE) { // Controle parado: avisa em vez de só fechar
+                char json[96];                  // O lote continua na fila: o resultado é desconhecido, não falha
+                snprintf(json, sizeof(json), "{\"aplicado\":null,\"lote\":%u,\"erro\":\"sem resposta do controle\"}",
+                         (unsigned)c.lote);
+                responderJson(c, 504, json);
+            } else {
+                fecharConexao(c);
+            }
+        }
+    }
+    uint32_t duracaoUs = micros() - inicioUs;
+    servicoHttpTotalUs += duracaoUs;
+    if (duracaoUs > servicoHttpMaxUs) servicoHttpMaxUs = duracaoUs;
+}
+
+/**
+ * @brief Aceita conexões pendentes enquanto houver vaga no pool.
+ */
+void aceitarConexoes() {
+    for (Conexao &c : conexoes) {
+        if (c.estado != CONEXAO_LIVRE) continue;
+        int soquete = accept(soqueteServidor, nullptr, nullptr);
+        if (soquete < 0) return;                // EWOULDBLOCK: nada mais pendente
+        fcntl(soquete, F_SETFL, O_NONBLOCK);
+        c.soquete = soquete;
+        c.estado = CONEXAO_LENDO_CABECALHO;
+        c.abertaMs = c.ultimoMs = millis();
+        c.rota = nullptr;
+        c.corpoRestante = 0;
+        c.lote = 0;
+        c.usados = c.enviados = 0;
+        c.corpoExterno = nullptr;
+        c.corpoExternoTamanho = c.corpoExternoEnviado = 0;
+        conexoesAceitas++;
+    }
+}
+
+/**
+ * @brief Lê o que chegou no socket e avança a requisição (cabeçalho, depois corpo).
+ */
+void lerConexao(Conexao &c) {
+    if (c.estado == CONEXAO_LENDO_CABECALHO) {
+        int n = recv(c.soquete, c.buffer + c.usados, TAMANHO_BUFFER_CONEXAO - 1 - c.usados, 0);
+        if (n <= 0) {
+            if (n == 0 || (errno != EWOULDBLOCK && errno != EAGAIN)) fecharConexao(c);
+            return;
+        }
+        c.usados += n;
+        c.buffer[c.usados] = '\0';
+        c.ultimoMs = millis();
+        char *fim = strstr(c.buffer, "\r\n\r\n");
+        if (fim != nullptr) processarRequisicao(c, fim + 4 - c.buffer);
+        else if (c.usados >= TAMANHO_BUFFER_CONEXAO - 1) responderTexto(c, 431, "Cabecalho grande demais.");
+    } else if (c.estado == CONEXAO_LENDO_CORPO) {
+        bool acumular = c.rota->corpoMaximo > 0; // Corpo pequeno: continua depois do que já chegou
+        char *destino = acumular ? c.buffer + c.usados : c.buffer;
+        size_t maximo = c.corpoRestante < TAMANHO_BUFFER_CONEXAO ? c.corpoRestante : TAMANHO_BUFFER_CONEXAO;
+        int n = recv(c.soquete, destino, maximo, 0);
+        if (n <= 0) {
+            if (n == 0 || (errno != EWOULDBLOCK && errno != EAGAIN)) fecharConexao(c);
+            return;
+        }
+        c.ultimoMs = millis();
+        receberCorpoConexao(c, (const uint8_t *)destino, n);
+    } else {                                    // SSE ou lote aguardando: o cliente só pode fechar
+        char descarte[64];
+        int n = recv(c.soquete, descarte, sizeof(descarte), 0);
+        if (n == 0 || (n < 0 && errno != EWOULDBLOCK && errno != EAGAIN)) fecharConexao(c);
+    }
+}
+
+/**
+ * @brief Interpreta a linha de requisição, encontra a rota e a atende (ou começa a receber o corpo).
+ * @details Método e caminho são terminados em '\0' só durante a busca da rota. Os cabeçalhos continuam
+ * disponíveis por valorCabecalho() até a rota chamar responder(), que reutiliza o buffer.
+ */
+void processarRequisicao(Conexao &c, size_t tamanhoCabecalho) {
+    char *metodo = c.buffer;
+    char *caminho = strchr(metodo, ' ');
+    if (caminho == nullptr) {
+        responderTexto(c, 400, "Requisicao invalida.");
+        return;
+    }
+    *caminho++ = '\0';
+    size_t fimCaminho = strcspn(caminho, " ?\r");
+    char separador = caminho[fimCaminho];
+    caminho[fimCaminho] = '\0';
+
+    c.rota = &rotaPadrao;
+    for (const Rota &r : rotas) {
+        if (strcmp(r.caminho, caminho) == 0 && (r.metodo == nullptr || strcmp(r.metodo, metodo) == 0)) {
+            c.rota = &r;
+            break;
+        }
+    }
+    caminho[fimCaminho] = separador;            // Devolve o texto para valorCabecalho() percorrer as linhas
+    caminho[-1] = ' ';
+
+    if (c.rota->receberCorpo == nullptr && c.rota->corpoMaximo == 0) { // Corpo (se houver) é ignorado
+        c.rota->atender(c);
+        return;
+    }
+    const char *tamanho = valorCabecalho(c, "Content-Length");
+    c.corpoRestante = tamanho != nullptr ? strtoul(tamanho, nullptr, 10) : 0;
+    if (c.corpoRestante == 0) {
+        responderTexto(c, 411, "Envie o conteudo no corpo (Content-Length).");
+        return;
+    }
+    if (c.rota->corpoMaximo > 0 && c.corpoRestante > c.rota->corpoMaximo) {
+        responderTexto(c, 413, "Corpo grande demais.");
+        return;
+    }
+    if (c.rota->iniciarCorpo != nullptr && !c.rota->iniciarCorpo(c)) return; // A rota já respondeu com o erro
+    size_t jaRecebido = c.usados - tamanhoCabecalho;
+    if (jaRecebido > c.corpoRestante) jaRecebido = c.corpoRestante;
+    c.usados = 0;
+    if (c.estado == CONEXAO_AGUARDANDO_TABELA) { // Rota preparando a flash: guarda o que já chegou
+        memmove(c.buffer, c.buffer + tamanhoCabecalho, jaRecebido);
+        c.usados = jaRecebido;
+        return;
+    }
+    c.estado = CONEXAO_LENDO_CORPO;
+    if (c.rota->corpoMaximo > 0) memmove(c.buffer, c.buffer + tamanhoCabecalho, jaRecebido); // Corpo no início do buffer
+    receberCorpoConexao(c, (const uint8_t *)c.buffer + (c.rota->corpoMaximo > 0 ? 0 : tamanhoCabecalho), jaRecebido);
+}
+
+/**
+ * @brief Repassa um trecho do corpo à rota; no último trecho, pede a resposta.
+ * @details Rotas com 'corpoMaximo' não recebem trechos: o corpo se acumula em 'buffer' e
+ * chega terminado em '\0' a atender().
+ */
+void receberCorpoConexao(Conexao &c, const uint8_t *dados, size_t tamanho) {
+    if (c.rota->corpoMaximo > 0) c.usados += tamanho;
+    else if (tamanho > 0) c.rota->receberCorpo(dados, tamanho);
+    c.corpoRestante -= tamanho;
+    if (c.corpoRestante > 0) return;
+    if (c.rota->corpoMaximo > 0) c.buffer[c.usados] = '\0';
+    c.rota->atender(c);
+}
+
+/**
+ * @brief Procura um cabeçalho da requisição (sem diferenciar maiúsculas).
+ * @return Ponteiro para o valor (termina em '\r'), ou nullptr se ausente.
+ */
+const char *valorCabecalho(const Conexao &c, const char *nome) {
+    size_t tamanhoNome = strlen(nome);
+    const char *linha = strstr(c.buffer, "\r\n");
+    while (linha != nullptr && linha[2] != '\r' && linha[2] != '\0') {
+        linha += 2;
+        if (strncasecmp(linha, nome, tamanhoNome) == 0 && linha[tamanhoNome] == ':') {
+            const char *valor = linha + tamanhoNome + 1;
+            while (*valor == ' ') valor++;
+            return valor;
+        }
+        linha = strstr(linha, "\r\n");
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Monta cabeçalho e corpo no buffer da conexão e começa a enviar.
+ * @param extras Linhas de cabeçalho adicionais, cada uma terminada em "\r\n".
+ * @param semCopia true = 'corpo' continua válido até o fim do envio (flash ou buffer
+ * reservado) e é enviado direto, sem cópia.
+ */
+void responder(Conexao &c, int codigo, const char *tipo, const char *corpo, size_t tamanho,
+               const char *extras, bool semCopia) {
+    int n = snprintf(c.buffer, TAMANHO_BUFFER_CONEXAO,
+                     "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %u\r\nConnection: close\r\n%s\r\n",
+                     codigo, textoStatus(codigo), tipo, (unsigned)tamanho, extras);
+    c.usados = (n < (int)TAMANHO_BUFFER_CONEXAO) ? n : TAMANHO_BUFFER_CONEXAO;
+    c.enviados = 0;
+    if (semCopia) {
+        c.corpoExterno = corpo;
+        c.corpoExternoTamanho = tamanho;
+        c.corpoExternoEnviado = 0;
+    } else {
+        size_t copia = tamanho;
+        if (copia > TAMANHO_BUFFER_CONEXAO - c.usados) {  // Não deve acontecer; aumente o buffer se ocorrer
+            Serial.println(F("HTTP: resposta truncada"));
+            copia = TAMANHO_BUFFER_CONEXAO - c.usados;
+        }
+        memcpy(c.buffer + c.usados, corpo, copia);
+        c.usados += copia;
+    }
+    c.estado = CONEXAO_ENVIANDO;
+    c.ultimoMs = millis();
+    enviarPendente(c);
+}
+
+/**
+ * @brief Resposta em texto puro (mensagens de erro e resultados de upload).
+ */
+void responderTexto(Conexao &c, int codigo, const char *texto) {
+    responder(c, codigo, "text/plain", texto, strlen(texto));
+}
+
+/**
+ * @brief Resposta application/json curta (copiada para o buffer da conexão).
+ */
+void responderJson(Conexao &c, int codigo, const char *json) {
+    responder(c, codigo, "application/json", json, strlen(json));
+}
+
+/**
+ * @brief Envia o quanto o socket aceitar agora, sem bloquear.
+ * @details Resposta comum: fecha a conexão ao terminar. Canal SSE: esvazia o buffer e segue aberto.
+ * @return false se a conexão foi fechada.
+ */
+bool enviarPendente(Conexao &c) {
+    while (c.enviados < c.usados || (c.corpoExterno != nullptr && c.corpoExternoEnviado < c.corpoExternoTamanho)) {
+        bool doBuffer = c.enviados < c.usados;
+        const char *dados = doBuffer ? c.buffer + c.enviados : c.corpoExterno + c.corpoExternoEnviado;
+        size_t restante = doBuffer ? c.usados - c.enviados : c.corpoExternoTamanho - c.corpoExternoEnviado;
+        int n = send(c.soquete, dados, restante, 0);
+        if (n < 0) {
+            if (errno == EWOULDBLOCK || errno == EAGAIN) return true; // Buffer de envio cheio: segue no próximo select()
+            fecharConexao(c);
+            return false;
+        }
+        if (doBuffer) c.enviados += n;
+        else c.corpoExternoEnviado += n;
+        c.ultimoMs = millis();
+    }
+    if (c.estado == CONEXAO_ENVIANDO) {
+        fecharConexao(c);
+        return false;
+    }
+    c.usados = c.enviados = 0;                  // Canal SSE: buffer livre para o próximo evento
+    return true;
+}
+
+/**
+ * @brief Acrescenta dados à saída de um canal SSE e tenta enviá-los.
+ * @details Se o cliente está tão atrasado que o evento não cabe, a conexão é fechada; o
+ * navegador reconecta sozinho e recebe o estado completo.
+ * @return false se a conexão foi fechada.
+ */
+bool anexarSaida(Conexao &c, const char *dados, size_t tamanho) {
+    if (c.enviados > 0) {                       // Compacta o que ainda falta enviar
+        memmove(c.buffer, c.buffer + c.enviados, c.usados - c.enviados);
+        c.usados -= c.enviados;
+        c.enviados = 0;
+    }
+    if (c.usados + tamanho > TAMANHO_BUFFER_CONEXAO) {
+        fecharConexao(c);
+        return false;
+    }
+    memcpy(c.buffer + c.usados, dados, tamanho);
+    c.usados += tamanho;
+    return enviarPendente(c);
+}
+
+/**
+ * @brief Fecha o socket e libera a vaga; um upload interrompido é descartado.
+ */
+void fecharConexao(Conexao &c) {
+    if (conexaoUpload == &c) {
+        if (c.estado == CONEXAO_LENDO_CORPO || c.estado == CONEXAO_AGUARDANDO_TABELA) { // Cliente sumiu no meio
+            gravacao.ativa = false;
+            gravacao.etapa = ETAPA_RECEBENDO;
+            resultadoUpload = nullptr;
+        }
+        conexaoUpload = nullptr;
+    }
+    close(c.soquete);
+    c.soquete = -1;
+    c.estado = CONEXAO_LIVRE;
+}
+
+/**
+ * @brief Frase de status das respostas usadas pelo servidor.
+ */
+const char *textoStatus(int codigo) {
+    switch (codigo) {
+        case 200: return "OK";
+        case 302: return "Found";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 403: return "Forbidden";
+        case 409: return "Conflict";
+        case 411: return "Length Required";
+        case 413: return "Payload Too Large";
+        case 431: return "Request Header Fields Too Large";
+        case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
+        case 504: return "Gateway Timeout";
+        default:  return "";
+    }
+}
+
+/**
+ * @brief Garante um upload por vez: a tabela em construção e o parser de CSV são únicos.
+ * @return false (e responde 409) se outra conexão já está enviando um arquivo.
+ */
+bool reservarUpload(Conexao &c) {
+    if (conexaoUpload != nullptr) {
+        responderTexto(c, 409, "Outro upload em andamento.");
+        return false;
+    }
+    conexaoUpload = &c;
+    return true;
+}
+
+/**
+ * @brief Confere o token das rotas que trocam a tabela de usuários.
+ * @details Espera "Authorization: Bearer <tokenAdministrador>". A comparação percorre o
+ * token inteiro, sem parar no primeiro byte diferente. Não há token padrão: enquanto
+ * 'tokenAdministrador' tiver menos de TAMANHO_MIN_TOKEN caracteres, as rotas ficam fechadas.
+ * @return false (e responde 403 sem token configurado, 401 se ausente ou errado).
+ */
+bool autorizarAdministrador(Conexao &c) {
+    size_t tamanho = strlen(tokenAdministrador);
+    if (tamanho < TAMANHO_MIN_TOKEN) {
+        responder(c, 403, "text/plain", "Token de administrador nao configurado.", 39);
+        return false;
+    }
+    const char *valor = valorCabecalho(c, "Authorization");
+    bool autorizado = false;
+    if (valor != nullptr && strncmp(valor, "Bearer ", 7) == 0 && strcspn(valor + 7, "\r") == tamanho) {
+        byte diferenca = 0;
+        for (size_t i = 0; i < tamanho; i++) diferenca |= valor[7 + i] ^ tokenAdministrador[i];
+        autorizado = diferenca == 0;
+    }
+    if (!autorizado) responder(c, 401, "text/plain", "Token invalido.", 15, "WWW-Authenticate: Bearer\r\n");
+    return autorizado;
 }
 
 // ==============================================================================
 // FUNÇÕES DO SERVIDOR WEB (HANDLERS)
 // ==============================================================================
 
+// Modelo da página principal (fica na flash; só os campos variáveis são formatados)
+const char modeloPagina[] PROGMEM =
+    "<!DOCTYPE html><html><head><title>Controle de Sala</title><meta charset='UTF-8'><meta name='viewport' content='width=device-width, initial-scale=1'>"
+    "<noscript><meta http-equiv='refresh' content='10'></noscript>"
+    "<script>var n=0;if(window.EventSource)new EventSource('/api/events').onmessage=function(){if(n++)location.reload();};</script>"
+    "<style>html{font-family: Helvetica, Arial, sans-serif; display: inline-block; margin: 0px auto; text-align: center;} body{background-color: #f4f4f4; max-width: 600px; margin: 0 auto;} h1{color: #333;} h3{color: #555; border-top: 2px solid #ccc; padding-top: 15px; margin-top: 20px;} .button{background-color:#4CAF50;border:none;color:white;padding:14px 30px;text-decoration:none;font-size:22px;margin:2px;cursor:pointer;border-radius:8px;} .button2{background-color:#f44336;} p{font-size: 18px;} .status{font-weight: bold;} .msg{color:blue; font-weight:bold; background-color: #e0e0ff; padding: 10px; border-radius: 5px;}</style></head><body><h1>Controle da Sala - ESP32</h1>"
+    "%s"                                                                   // Mensagem do sistema (opcional)
+    "<p><b>Temperatura Atual:</b> %d&deg;C</p>"
+    "<p><b>Ocupa&ccedil;&atilde;o da Sala:</b> <span class='status'>%s</span></p>"
+    "<h3>Ilumina&ccedil;&atilde;o</h3>"
+    "<p>Estado: <span class='status'>%s</span></p>"
+    "%s"                                                                   // Botão da luz
+    "<h3>Ventila&ccedil;&atilde;o (Autom&aacute;tica)</h3>"
+    "<p>Aciona em: %d&deg;C</p>"
+    "<p>Estado: <span class='status'>%s</span></p>"
+    "<h3>Ventila&ccedil;&atilde;o (Manual)</h3>"
+    "<p>Estado: <span class='status'>%s</span></p>"
+    "%s"                                                                   // Botão da ventilação
+    "</body></html>";
+
+char paginaHtml[2048];                      // Web: página renderizada (sem alocação por requisição)
+
+/**
+ * @brief Expõe os contadores no formato de texto do Prometheus (versão 0.0.4).
+ * @details O texto é formatado no buffer estático 'metricas' e enviado sem cópia; enquanto
+ * um envio anterior ainda usa o buffer, a coleta concorrente recebe 503. Os contadores das
+ * saídas vêm do último instantâneo publicado ('estadoWeb'), então campos de um mesmo contador
+ * nunca se misturam entre duas publicações e um _total não volta. Os demais contadores do
+ * controle, do timer e das ISRs são ContadorCompartilhado (atômicos relaxados), nunca globais
+ * comuns do outro núcleo. A maior volta do loop() é lida de um atômico e quem a zera é o
+ * próprio controle, ao ver a coleta nova; o máximo da web é zerado aqui mesmo. Cada família
+ * sai inteira logo depois do seu HELP/TYPE.
+ */
+void handleMetricas(Conexao &c) {
+    for (const Conexao &outra : conexoes) {
+        if (outra.estado == CONEXAO_ENVIANDO && outra.corpoExterno == metricas) {
+            responder(c, 503, "text/plain", "", 0, "Retry-After: 1\r\n");
+            return;
+        }
+    }
+    uint32_t inicioUs = micros();
+    unsigned long agora = millis();
+    tamanhoMetricas = 0;
+
+    escreverMetrica("# HELP sala_uptime_segundos Tempo desde o boot.\n# TYPE sala_uptime_segundos gauge\n");
+    escreverMetrica("sala_uptime_segundos %lu\n", agora / 1000);
+    escreverMetrica("# HELP sala_loop_voltas_total Voltas do escalonador no loop().\n# TYPE sala_loop_voltas_total counter\n");
+    escreverMetrica("sala_loop_voltas_total %lu\n", (unsigned long)voltasLoop);
+    escreverMetrica("# HELP sala_loop_volta_max_segundos Maior volta do loop() desde a coleta anterior.\n# TYPE sala_loop_volta_max_segundos gauge\n");
+    escreverMetrica("sala_loop_volta_max_segundos %.6f\n", voltaMaxUs.load(std::memory_order_relaxed) / 1e6);
+    coletasVoltaMax.fetch_add(1, std::memory_order_relaxed); // O controle reabre a janela na próxima volta
+    escreverMetrica("# HELP sala_http_servico_segundos_total Tempo atendendo conexoes (sem a espera no select).\n# TYPE sala_http_servico_segundos_total counter\n");
+    escreverMetrica("sala_http_servico_segundos_total %.6f\n", servicoHttpTotalUs / 1e6);
+    escreverMetrica("# HELP sala_http_servico_max_segundos Maior volta do servidor HTTP desde a coleta anterior.\n# TYPE sala_http_servico_max_segundos gauge\n");
+    escreverMetrica("sala_http_servico_max_segundos %.6f\n", servicoHttpMaxUs / 1e6);
+    servicoHttpMaxUs = 0;
+    escreverMetrica("# HELP sala_http_conexoes_total Conexoes HTTP aceitas.\n# TYPE sala_http_conexoes_total counter\n");
+    escreverMetrica("sala_http_conexoes_total %lu\n", conexoesAceitas.ler());
+
+    escreverMetrica("# HELP sala_rfid_consultas_total Consultas SPI a cada leitor RFID.\n# TYPE sala_rfid_consultas_total counter\n");
+    for (int i = 0; i < totalLeitores; i++) {
+        escreverMetrica("sala_rfid_consultas_total{leitor=\"%s\"} %lu\n", leitores[i].nome, leitores[i].consultas.ler());
+    }
+    escreverMetrica("# HELP sala_rfid_cartoes_total Cartoes novos lidos por leitor.\n# TYPE sala_rfid_cartoes_total counter\n");
+    for (int i = 0; i < totalLeitores; i++) {
+        escreverMetrica("sala_rfid_cartoes_total{leitor=\"%s\"} %lu\n", leitores[i].nome, leitores[i].cartoes.ler());
+    }
+    escreverMetrica("# HELP sala_rfid_suprimidas_total Leituras do mesmo cartao dentro da janela anti-repeticao.\n"
+                    "# TYPE sala_rfid_suprimidas_total counter\n");
+    for (int i = 0; i < totalLeitores; i++) {
+        escreverMetrica("sala_rfid_suprimidas_total{leitor=\"%s\"} %lu\n", leitores[i].nome, leitores[i].suprimidas.ler());
+    }
+    escreverMetrica("# HELP sala_bloom_consultas_total UIDs testados no filtro de Bloom.\n# TYPE sala_bloom_consultas_total counter\n");
+    escreverMetrica("sala_bloom_consultas_total %lu\n", consultasBloom.ler());
+    escreverMetrica("# HELP sala_bloom_rejeitados_total UIDs descartados pelo filtro sem consultar o indice.\n"
+                    "# TYPE sala_bloom_rejeitados_total counter\n");
+    escreverMetrica("sala_bloom_rejeitados_total %lu\n", rejeitadosBloom.ler());
+    escreverMetrica("# HELP sala_bloom_falsos_positivos_total UIDs aceitos pelo filtro e ausentes do indice.\n"
+                    "# TYPE sala_bloom_falsos_positivos_total counter\n");
+    escreverMetrica("sala_bloom_falsos_positivos_total %lu\n", falsosPositivosBloom.ler());
+    static const char *const nomesEvento[EVENTO_FORA_HORARIO + 1] = {"abertura", "fechamento", "ja_aberta", "negado",
+                                                                     "fora_horario"};
+    escreverMetrica("# HELP sala_acessos_total Decisoes de acesso por resultado.\n# TYPE sala_acessos_total counter\n");
+    for (int i = 0; i <= EVENTO_FORA_HORARIO; i++) {
+        escreverMetrica("sala_acessos_total{resultado=\"%s\"} %lu\n", nomesEvento[i], (unsigned long)eventosPorTipo[i]);
+    }
+
+    escreverMetrica("# HELP sala_ultrassom_latencia_segundos Do pulso no TRIG ao fim do eco.\n# TYPE sala_ultrassom_latencia_segundos histogram\n");
+    uint32_t acumulado = 0;
+    for (int i = 0; i < FAIXAS_LATENCIA - 1; i++) {
+        acumulado += latenciaUltrassom[i];
+        escreverMetrica("sala_ultrassom_latencia_segundos_bucket{le=\"%g\"} %lu\n", LIMITES_LATENCIA_US[i] / 1e6, (unsigned long)acumulado);
+    }
+    acumulado += latenciaUltrassom[FAIXAS_LATENCIA - 1];
+    uint64_t soma = somaLatenciaUltrassomUs;
+    escreverMetrica("sala_ultrassom_latencia_segundos_bucket{le=\"+Inf\"} %lu\n", (unsigned long)acumulado);
+    escreverMetrica("sala_ultrassom_latencia_segundos_sum %.6f\n", soma / 1e6);
+    escreverMetrica("sala_ultrassom_latencia_segundos_count %lu\n", (unsigned long)acumulado);
+    escreverMetrica("# HELP sala_ultrassom_sem_eco_total Ciclos de medicao sem eco.\n# TYPE sala_ultrassom_sem_eco_total counter\n");
+    escreverMetrica("sala_ultrassom_sem_eco_total %lu\n", (unsigned long)ultrassomSemEco);
+    escreverMetrica("# HELP sala_ultrassom_distancia_filtrada_cm Saida da mediana movel + EMA.\n# TYPE sala_ultrassom_distancia_filtrada_cm gauge\n");
+    escreverMetrica("sala_ultrassom_distancia_filtrada_cm %u\n", (unsigned)distanciaFiltradaCm.load(std::memory_order_relaxed));
+    escreverMetrica("# HELP sala_ocupacao_trocas_total Mudancas de ocupacao depois do filtro.\n# TYPE sala_ocupacao_trocas_total counter\n");
+    escreverMetrica("sala_ocupacao_trocas_total %lu\n", (unsigned long)trocasOcupacao);
+    escreverMetrica("# HELP sala_ocupacao_trocas_suprimidas_total Mudancas da amostra bruta seguradas pelo filtro.\n# TYPE sala_ocupacao_trocas_suprimidas_total counter\n");
+    escreverMetrica("sala_ocupacao_trocas_suprimidas_total %lu\n", (unsigned long)trocasSuprimidas);
+    escreverMetrica("# HELP sala_dht_falhas_total Leituras invalidas do DHT11.\n# TYPE sala_dht_falhas_total counter\n");
+    escreverMetrica("sala_dht_falhas_total %lu\n", falhasDht.ler());
+
+    static const char *const nomesComando[TIPOS_COMANDO] = {"luz", "ventilacao", "lote"};
+    escreverMetrica("# HELP sala_comando_latencia_segundos Da entrada na fila (web) ao fim do acionamento (controle).\n"
+                    "# TYPE sala_comando_latencia_segundos histogram\n");
+    for (int t = 0; t < TIPOS_COMANDO; t++) {
+        uint32_t total = 0;
+        for (int i = 0; i < FAIXAS_LATENCIA_COMANDO; i++) {
+            total += latenciaComando[t][i];
+            if (i < FAIXAS_LATENCIA_COMANDO - 1) {
+                escreverMetrica("sala_comando_latencia_segundos_bucket{comando=\"%s\",le=\"%g\"} %lu\n", nomesComando[t],
+                                LIMITES_LATENCIA_COMANDO_US[i] / 1e6, (unsigned long)total);
+            }
+        }
+        uint64_t somaComando = somaLatenciaComandoUs[t];
+        escreverMetrica("sala_comando_latencia_segundos_bucket{comando=\"%s\",le=\"+Inf\"} %lu\n", nomesComando[t], (unsigned long)total);
+        escreverMetrica("sala_comando_latencia_segundos_sum{comando=\"%s\"} %.6f\n", nomesComando[t], somaComando / 1e6);
+        escreverMetrica("sala_comando_latencia_segundos_count{comando=\"%s\"} %lu\n", nomesComando[t], (unsigned long)total);
+    }
+    escreverMetrica("# HELP sala_comandos_descartados_total Comandos recusados com a fila cheia.\n# TYPE sala_comandos_descartados_total counter\n");
+    escreverMetrica("sala_comandos_descartados_total %lu\n", (unsigned long)comandosDescartados);
+
+    const char *const nomesSaida[] = {"luz", "ventilacao", "ventilacao_automatica"};
+    const ContadorSaida *const saidas[] = {&estadoWeb.contadorLuz, &estadoWeb.contadorVentilacao,
+                                           &estadoWeb.contadorVentilacaoAuto};
+    static double ligadaSegundosServida[3] = {}; // O trecho em curso estimado aqui pode passar do desligamento
+    escreverMetrica("# HELP sala_saida_ligada_segundos_total Tempo ligada de cada saida.\n# TYPE sala_saida_ligada_segundos_total counter\n");
+    for (int i = 0; i < 3; i++) {
+        double segundos = segundosLigada(*saidas[i], agora);
+        if (segundos < ligadaSegundosServida[i]) segundos = ligadaSegundosServida[i]; // Contador não volta
+        ligadaSegundosServida[i] = segundos;
+        escreverMetrica("sala_saida_ligada_segundos_total{saida=\"%s\"} %.3f\n", nomesSaida[i], segundos);
+    }
+    escreverMetrica("# HELP sala_saida_acionamentos_total Trocas de estado de cada saida.\n# TYPE sala_saida_acionamentos_total counter\n");
+    for (int i = 0; i < 3; i++) {
+        escreverMetrica("sala_saida_acionamentos_total{saida=\"%s\"} %lu\n", nomesSaida[i], (unsigned long)saidas[i]->acionamentos);
+    }
+
+    escreverMetrica("# HELP sala_heap_livre_bytes Heap livre.\n# TYPE sala_heap_livre_bytes gauge\n");
+    escreverMetrica("sala_heap_livre_bytes %lu\n", (unsigned long)ESP.getFreeHeap());
+    escreverMetrica("# HELP sala_heap_maior_bloco_bytes Maior bloco livre do heap.\n# TYPE sala_heap_maior_bloco_bytes gauge\n");
+    escreverMetrica("sala_heap_maior_bloco_bytes %lu\n", (unsigned long)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+    escreverMetrica("# HELP sala_metricas_formatacao_segundos Tempo para formatar esta resposta.\n# TYPE sala_metricas_formatacao_segundos gauge\n");
+    escreverMetrica("sala_metricas_formatacao_segundos %.6f\n", (micros() - inicioUs) / 1e6);
+
+    responder(c, 200, "text/plain; version=0.0.4", metricas, tamanhoMetricas, "", true);
+}
+
+/**
+ * @brief Acrescenta texto formatado a 'metricas' (o excesso é descartado).
+ */
+void escreverMetrica(const char *formato, ...) {
+    if (tamanhoMetricas >= sizeof(metricas) - 1) return;
+    va_list argumentos;
+    va_start(argumentos, formato);
+    int n = vsnprintf(metricas + tamanhoMetricas, sizeof(metricas) - tamanhoMetricas, formato, argumentos);
+    va_end(argumentos);
+    if (n < 0) return;
+    tamanhoMetricas += n;
+    if (tamanhoMetricas > sizeof(metricas) - 1) {
+        Serial.println(F("metrics: buffer cheio"));
+        tamanhoMetricas = sizeof(metricas) - 1;
+    }
+}
+
+/**
+ * @brief Tempo ligada de uma saída, incluindo o trecho ligado em curso.
+ */
+double segundosLigada(const ContadorSaida &saida, unsigned long agora) {
+    double segundos = saida.ligadaSegundos + saida.restoMs / 1000.0;
+    if (saida.ligada) segundos += (agora - saida.ligadaDesdeMs) / 1000.0;
+    return segundos;
+}
+
+/**
+ * @brief Monta a ETag da versão servida: boot, versão do controle e geração da mensagem.
+ */
+void montarEtag(char *saida, size_t capacidade) {
+    snprintf(saida, capacidade, "\"%08lx.%lu.%lu\"", (unsigned long)idInicializacao,
+             (unsigned long)estadoWeb.versao, (unsigned long)geracaoMensagem);
+}
+
+/**
+ * @brief Responde 304 (sem corpo) se o If-None-Match do cliente é a ETag atual.
+ * @return true se respondeu.
+ */
+bool responderSeNaoModificado(Conexao &c, const char *etag) {
+    const char *recebida = valorCabecalho(c, "If-None-Match");
+    size_t tamanho = strlen(etag);
+    if (recebida == nullptr || strncmp(recebida, etag, tamanho) != 0 || recebida[tamanho] != '\r') return false;
+    char extras[64];
+    snprintf(extras, sizeof(extras), "ETag: %s\r\n", etag);
+    responder(c, 304, "text/plain", "", 0, extras);
+    respostasNaoModificadas++;
+    return true;
+}
+
+/**
+ * @brief Gera e envia a página HTML clássica (completa, sem JavaScript) para o navegador.
+ * @details Roda no núcleo 0 e usa só a cópia local 'estadoWeb'. A página é formatada de uma
+ * vez no buffer estático 'paginaHtml' a partir do modelo em flash, sem nenhum String, e só
+ * quando a ETag muda; as demais requisições da mesma versão recebem o buffer pronto, ou 304.
+ */
+void handleRoot(Conexao &c) {
+    static char etagPagina[40] = "";            // Versão que está em 'paginaHtml'
+    static int tamanho = 0;
+    char etag[sizeof(etagPagina)];
+    montarEtag(etag, sizeof(etag));
+    if (responderSeNaoModificado(c, etag)) return;
+    char extras[sizeof(etag) + 40];             // ETag e Cache-Control
+    snprintf(extras, sizeof(extras), "ETag: %s\r\nCache-Control: no-cache\r\n", etag);
+    if (strcmp(etag, etagPagina) == 0) {
+        respostasDoCache++;
+        responder(c, 200, "text/html", paginaHtml, tamanho, extras);
+        return;
+    }
+
+    char blocoMensagem[sizeof(mensagemWeb) + 32] = "";
+    if (mensagemWeb[0] != '\0') {               // Se há mensagem do sistema
+        snprintf(blocoMensagem, sizeof(blocoMensagem), "<p class='msg'>%s</p>", mensagemWeb); // Mostra mensagem
+    }
+    tamanho = snprintf(paginaHtml, sizeof(paginaHtml), modeloPagina,
+        blocoMensagem,
+        estadoWeb.temperatura,
+        estadoWeb.ocupacao ? "OCUPADA" : "LIVRE",
+        estadoWeb.iluminacao ? "LIGADA" : "DESLIGADA",
+        estadoWeb.iluminacao ? "<a href='/luz/off'><button class='button button2'>Desligar</button></a>"
+                             : "<a href='/luz/on'><button class='button'>Ligar</button></a>",
+        tempacionamento,
+        estadoWeb.ventilacaoAutomatica ? "LIGADA" : "DESLIGADA",
+        estadoWeb.ventilacao ? "LIGADA" : "DESLIGADA",
+        estadoWeb.ventilacao ? "<a href='/ventilacao/off'><button class='button button2'>Desligar</button></a>"
+                             : "<a href='/ventilacao/on'><button class='button'>Ligar</button></a>");
+    if (tamanho >= (int)sizeof(paginaHtml)) {   // Não deve acontecer; aumente 'paginaHtml' se o modelo crescer
+        Serial.println(F("handleRoot: pagina truncada"));
+        tamanho = sizeof(paginaHtml) - 1;
+    }
+    strcpy(etagPagina, etag);
+    respostasRenderizadas++;
+    responder(c, 200, "text/html", paginaHtml, tamanho, extras); // Envia página HTML ao navegador
+}
+
+/**
+ * @brief Envia o painel estático, já comprimido com gzip, direto da flash.
+ * @details O conteúdo só muda com o firmware, então o navegador pode guardá-lo por um dia;
+ * a cada atualização só o JSON de /api/state trafega.
+ */
+void handleDashboard(Conexao &c) {
+    responder(c, 200, "text/html", (const char *)dashboardHtmlGz, dashboardHtmlGzTamanho,
+              "Content-Encoding: gzip\r\nCache-Control: public, max-age=86400\r\n", true);
+}
+
+/**
+ * @brief Responde com o estado da sala em JSON compacto (a partir de 'estadoWeb').
+ * @details Mesmo cache da página clássica: o JSON só é montado quando a ETag muda.
+ */
+void handleEstadoApi(Conexao &c) {
+    static char json[320];
+    static char etagJson[40] = "";              // Versão que está em 'json'
+    static size_t tamanho = 0;
+    char etag[sizeof(etagJson)];
+    montarEtag(etag, sizeof(etag));
+    if (responderSeNaoModificado(c, etag)) return;
+    if (strcmp(etag, etagJson) == 0) {
+        respostasDoCache++;
+    } else {
+        tamanho = renderizarEstadoJson(json, sizeof(json), estadoWeb, nullptr, mensagemWeb);
+        strcpy(etagJson, etag);
+        respostasRenderizadas++;
+    }
+    char extras[sizeof(etag) + 40];             // ETag e Cache-Control
+    snprintf(extras, sizeof(extras), "ETag: %s\r\nCache-Control: no-cache\r\n", etag);
+    responder(c, 200, "application/json", json, tamanho, extras);
+}
+
+/**
+ * @brief Abre um canal Server-Sent Events: envia o estado completo e mantém a conexão no pool.
+ * @details Com 'MAX_CLIENTES_SSE' canais abertos, o mais antigo é fechado (normalmente uma
+ * aba que já recarregou e ainda não teve o fechamento detectado).
+ */
+void handleEventos(Conexao &c) {
+    Conexao *maisAntiga = nullptr;
+    int abertas = 0;
+    for (Conexao &outra : conexoes) {
+        if (outra.estado != CONEXAO_EVENTOS) continue;
+        abertas++;
+        if (maisAntiga == nullptr || outra.abertaMs < maisAntiga->abertaMs) maisAntiga = &outra;
+    }
+    if (abertas >= MAX_CLIENTES_SSE) fecharConexao(*maisAntiga);
+
+    size_t tamanho = strlen(strcpy(c.buffer,
+        "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n"
+        "Connection: keep-alive\r\n\r\nretry: 3000\ndata: "));
+    tamanho += renderizarEstadoJson(c.buffer + tamanho, TAMANHO_BUFFER_CONEXAO - tamanho - 2, estadoWeb, nullptr, "");
+    c.buffer[tamanho++] = '\n';
+    c.buffer[tamanho++] = '\n';
+    c.usados = tamanho;
+    c.enviados = 0;
+    c.estado = CONEXAO_EVENTOS;
+    enviarPendente(c);
+}
+
+/**
+ * @brief Escreve o estado em JSON compacto.
+ * @param anterior nullptr = estado completo; senão, só os campos diferentes de '*anterior'.
+ * @param mensagem Mensagem do sistema; "" = omitida no modo de mudanças.
+ * @return Tamanho escrito, ou 0 se nada mudou (só no modo de mudanças).
+ */
+size_t renderizarEstadoJson(char *saida, size_t capacidade, const EstadoSala &estado,
+                            const EstadoSala *anterior, const char *mensagem) {
+    size_t n = 0;
+    char separador = '{';
+    auto campo = [&](const char *nome, int valor, int valorAnterior) {
+        if (anterior != nullptr && valor == valorAnterior) return;
+        if (n >= capacidade) return;
+        int escrito = snprintf(saida + n, capacidade - n, "%c\"%s\":%d", separador, nome, valor);
+        n = (escrito < 0) ? capacidade : n + escrito;
+        separador = ',';
+    };
+    const EstadoSala &antes = (anterior != nullptr) ? *anterior : estado;
+    campo("temperatura", estado.temperatura, antes.temperatura);
+    campo("umidade", estado.umidade, antes.umidade);
+    campo("ocupada", estado.ocupacao, antes.ocupacao);
+    campo("luz", estado.iluminacao, antes.iluminacao);
+    campo("ventilacao", estado.ventilacao, antes.ventilacao);
+    campo("ventilacaoAutomatica", estado.ventilacaoAutomatica, antes.ventilacaoAutomatica);
+    campo("porta", estado.portaAberta, antes.portaAberta);
+    if (anterior == nullptr) campo("acionamento", tempacionamento, 0);
+    if (anterior == nullptr || mensagem[0] != '\0') {
+        char escapada[2 * sizeof(mensagemWeb)];
+        escaparJson(mensagem, escapada, sizeof(escapada));
+        if (n < capacidade) {
+            int escrito = snprintf(saida + n, capacidade - n, "%c\"mensagem\":\"%s\"", separador, escapada);
+            n = (escrito < 0) ? capacidade : n + escrito;
+            separador = ',';
+        }
+    }
+    if (separador == '{') return 0;             // Nada mudou
+    if (n + 1 < capacidade) saida[n++] = '}';
+    if (n >= capacidade) n = capacidade - 1;    // Cortado (não deve acontecer com os buffers usados)
+    saida[n] = '\0';
+    return n;
+}
+
 /**
- * @brief Gera e envia a página HTML principal para o cliente (navegador).
+ * @brief Copia 'texto' para 'saida' escapando aspas, barras e caracteres de controle.
+ * @return Tamanho escrito (sem o terminador); o texto é cortado se não couber.
  */
-void handleRoot() {
-    String html = "<!DOCTYPE html><html><head><title>Controle de Sala</title><meta charset='UTF-8'><meta name='viewport' content='width=device-width, initial-scale=1'>";
-    html += "<meta http-equiv='refresh' content='10'>"; // Atualiza página a cada 10s
-    html += "<style>html{font-family: Helvetica, Arial, sans-serif; display: inline-block; margin: 0px auto; text-align: center;} body{background-color: #f4f4f4; max-width: 600px; margin: 0 auto;} h1{color: #333;} h3{color: #555; border-top: 2px solid #ccc; padding-top: 15px; margin-top: 20px;} .button{background-color:#4CAF50;border:none;color:white;padding:14px 30px;text-decoration:none;font-size:22px;margin:2px;cursor:pointer;border-radius:8px;} .button2{background-color:#f44336;} p{font-size: 18px;} .status{font-weight: bold;} .msg{color:blue; font-weight:bold; background-color: #e0e0ff; padding: 10px; border-radius: 5px;}</style></head><body><h1>Controle da Sala - ESP32</h1>";
-    if (mensagemSistema != "") {                // Se há mensagem do sistema
-        html += "<p class='msg'>" + mensagemSistema + "</p>"; // Mostra mensagem
-        mensagemSistema = "";                   // Limpa mensagem
+size_t escaparJson(const char *texto, char *saida, size_t capacidade) {
+    size_t n = 0;
+    for (; *texto != '\0'; texto++) {
+        char c = *texto;
+        if ((unsigned char)c < 0x20) c = ' ';   // Quebras de linha etc. viram espaço
+        size_t necessario = (c == '"' || c == '\\') ? 2 : 1;
+        if (n + necessario >= capacidade) break;
+        if (necessario == 2) saida[n++] = '\\';
+        saida[n++] = c;
     }
-    html += "<p><b>Temperatura Atual:</b> " + String(temperaturaAtual) + "&deg;C</p>"; // Mostra temp
-    html += "<p><b>Ocupa&ccedil;&atilde;o da Sala:</b> <span class='status'>" + String(ocupacao ? "OCUPADA" : "LIVRE") + "</span></p>"; // Ocupação
-    html += "<h3>Ilumina&ccedil;&atilde;o</h3>";
-    html += "<p>Estado: <span class='status'>" + String(iluminacaoState ? "LIGADA" : "DESLIGADA") + "</span></p>"; // Estado luz
-    if (iluminacaoState) html += "<a href='/luz/off'><button class='button button2'>Desligar</button></a>"; // Botão desligar
-    else html += "<a href='/luz/on'><button class='button'>Ligar</button></a>"; // Botão ligar
-    html += "<h3>Ventila&ccedil;&atilde;o (Autom&aacute;tica)</h3>";
-    html += "<p>Aciona em: " + String(tempacionamento) + "&deg;C</p>"; // Temp de acionamento
-    html += "<p>Estado: <span class='status'>" + String(ventilacaoAutomaticaState ? "LIGADA" : "DESLIGADA") + "</span></p>"; // Estado ventoinha auto
-    html += "<h3>Ventila&ccedil;&atilde;o (Manual)</h3>";
-    html += "<p>Estado: <span class='status'>" + String(ventilacaoState ? "LIGADA" : "DESLIGADA") + "</span></p>"; // Estado ventoinha manual
-    if (ventilacaoState) html += "<a href='/ventilacao/off'><button class='button button2'>Desligar</button></a>"; // Botão desligar
-    else html += "<a href='/ventilacao/on'><button class='button'>Ligar</button></a>"; // Botão ligar
-    html += "</body></html>";
-    server.send(200, "text/html", html);        // Envia página HTML ao navegador
+    saida[n] = '\0';
+    return n;
 }
 
 /**
- * @brief Redireciona o navegador do cliente para a página raiz ("/").
- * Usado após uma ação (clique de botão) para atualizar a página.
+ * @brief Redireciona o navegador do cliente para a página clássica.
+ * Usado após uma ação (clique de botão) para atualizar a página. O painel faz as ações
+ * com fetch() e não segue o redirecionamento.
  */
-void redirectToRoot() {
-    server.sendHeader("Location", "/");         // Header de redirecionamento
-    server.send(302, "text/plain", "");         // Resposta HTTP 302 (redirect)
+void redirectToRoot(Conexao &c) {
+    responder(c, 302, "text/plain", "", 0, "Location: /classico\r\n"); // Resposta HTTP 302 (redirect)
 }